@@ -0,0 +1,31 @@
+#include <utility>
+
+#include "Chunk.hpp"
+
+void Chunk::write(uint8_t byte, uint32_t line)
+{
+    code.emplace_back(byte);
+    lines.emplace_back(line);
+}
+
+uint32_t Chunk::addConstant(Value value)
+{
+    constants.emplace_back(std::move(value));
+    return constants.size() - 1;
+}
+
+uint32_t Chunk::addName(Token name)
+{
+    names.emplace_back(std::move(name));
+    return names.size() - 1;
+}
+
+uint32_t Chunk::addFunction(std::shared_ptr<FunctionProto> function)
+{
+    functions.emplace_back(std::move(function));
+    return functions.size() - 1;
+}
+
+FunctionProto::FunctionProto(std::string name) : name(std::move(name))
+{
+}
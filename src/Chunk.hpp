@@ -0,0 +1,89 @@
+#ifndef SURPHER_CHUNK_HPP
+#define SURPHER_CHUNK_HPP
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <cstdint>
+
+#include "Token.hpp"
+
+enum OpCode : uint8_t
+{
+    OP_CONSTANT = 0,
+    OP_NIL,
+    OP_TRUE,
+    OP_FALSE,
+    OP_POP,
+    OP_GET_LOCAL,
+    OP_SET_LOCAL,
+    OP_GET_UPVALUE,
+    OP_SET_UPVALUE,
+    OP_DEFINE_GLOBAL,
+    OP_GET_GLOBAL,
+    OP_SET_GLOBAL,
+    OP_GET_PROPERTY,
+    OP_SET_PROPERTY,
+    OP_EQUAL,
+    OP_NOT_EQUAL,
+    OP_GREATER,
+    OP_GREATER_EQUAL,
+    OP_LESS,
+    OP_LESS_EQUAL,
+    OP_ADD,
+    OP_SUBTRACT,
+    OP_MULTIPLY,
+    OP_DIVIDE,
+    OP_MODULO,
+    OP_LEFT_SHIFT,
+    OP_RIGHT_SHIFT,
+    OP_BIT_AND,
+    OP_BIT_OR,
+    OP_BIT_XOR,
+    OP_NOT,
+    OP_NEGATE,
+    OP_PRINT,
+    OP_JUMP,
+    OP_JUMP_IF_FALSE,
+    OP_LOOP,
+    OP_CALL,
+    OP_CLOSURE,
+    OP_CLOSE_UPVALUE,
+    OP_RETURN,
+    OP_ARRAY,
+    OP_ARRAY_ALLOC,
+    OP_ACCESS,
+    OP_ARRAY_SET,
+    OP_HALT
+};
+
+struct FunctionProto;
+
+struct Chunk
+{
+    std::vector<uint8_t> code;
+    std::vector<uint32_t> lines;
+    std::vector<Value> constants;
+    std::vector<Token> names;
+    std::vector<std::shared_ptr<FunctionProto>> functions;
+
+    void write(uint8_t byte, uint32_t line);
+
+    uint32_t addConstant(Value value);
+
+    uint32_t addName(Token name);
+
+    uint32_t addFunction(std::shared_ptr<FunctionProto> function);
+};
+
+struct FunctionProto
+{
+    std::string name;
+    uint32_t arity = 0;
+    uint32_t upvalue_count = 0;
+    Chunk chunk;
+
+    explicit FunctionProto(std::string name);
+};
+
+#endif // SURPHER_CHUNK_HPP
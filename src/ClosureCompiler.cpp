@@ -0,0 +1,1039 @@
+#include <cmath>
+#include <functional>
+#include <iostream>
+
+#include "ClosureCompiler.hpp"
+#include "Error.hpp"
+#include "NativeLoop.hpp"
+
+std::shared_ptr<Environment> &ClosureRuntime::environment(Interpreter &interpreter)
+{
+    return interpreter.environment;
+}
+
+ClosureRuntime::Completion &ClosureRuntime::completion(Interpreter &interpreter)
+{
+    return interpreter.completion;
+}
+
+Value &ClosureRuntime::returnValue(Interpreter &interpreter)
+{
+    return interpreter.return_value;
+}
+
+Value ClosureRuntime::evaluate(Interpreter &interpreter, const std::shared_ptr<Expr> &expr)
+{
+    return interpreter.evaluate(expr);
+}
+
+ClosureRuntime::Completion ClosureRuntime::execute(Interpreter &interpreter, const std::shared_ptr<Stmt> &stmt)
+{
+    return interpreter.execute(stmt);
+}
+
+void ClosureRuntime::defineVariable(Interpreter &interpreter, int32_t slot, const Token &name, Value value,
+                                    bool is_fixed)
+{
+    interpreter.defineVariable(slot, name, std::move(value), is_fixed);
+}
+
+void ClosureRuntime::checkNumberOperands(const Token &operator_token, const Value &operand)
+{
+    Interpreter::checkNumberOperands(operator_token, operand);
+}
+
+void ClosureRuntime::checkNumberOperands(const Token &operator_token, const Value &left, const Value &right)
+{
+    Interpreter::checkNumberOperands(operator_token, left, right);
+}
+
+Value ClosureRuntime::getMethod(Interpreter &interpreter, const Value &object, const std::shared_ptr<Get> &invoke,
+                                Ref<SurpherInstance> &receiver, SurpherFunction *&method)
+{
+    return interpreter.getMethod(object, invoke, receiver, method);
+}
+
+Value ClosureRuntime::call(Interpreter &interpreter, const Value &callee, const Ref<SurpherInstance> &receiver,
+                           SurpherFunction *method, const std::vector<Value> &arguments, const Token &paren)
+{
+    return interpreter.call(callee, receiver, method, arguments, paren);
+}
+
+Value ClosureRuntime::getElement(const Access &expr, const Value &arr_name, const Value &index)
+{
+    return Interpreter::getElement(expr, arr_name, index);
+}
+
+void ClosureRuntime::setElement(const ArraySet &expr, const Value &arr_name, const Value &index, const Value &value)
+{
+    Interpreter::setElement(expr, arr_name, index, value);
+}
+
+bool ClosureRuntime::runNative(Interpreter &interpreter, While &stmt)
+{
+    return interpreter.runNative(stmt);
+}
+
+namespace
+{
+    struct ExprCode : ClosureRuntime
+    {
+        virtual ~ExprCode() = default;
+
+        virtual Value evaluate(Interpreter &interpreter) = 0;
+
+        // for conditions; comparisons answer without making a Value
+        virtual bool test(Interpreter &interpreter)
+        {
+            return Interpreter::isTruthy(evaluate(interpreter));
+        }
+    };
+
+    using ExprPtr = std::unique_ptr<ExprCode>;
+    using StmtPtr = std::unique_ptr<StmtCode>;
+
+    struct Constant : ExprCode
+    {
+        const Value value;
+
+        explicit Constant(Value value) : value(std::move(value)) {}
+
+        Value evaluate(Interpreter &interpreter) override
+        {
+            return value;
+        }
+    };
+
+    struct LocalRead : ExprCode
+    {
+        const Resolution resolution;
+
+        explicit LocalRead(Resolution resolution) : resolution(resolution) {}
+
+        Value evaluate(Interpreter &interpreter) override
+        {
+            return environment(interpreter)->getAt(resolution.depth, resolution.slot);
+        }
+    };
+
+    struct GlobalRead : ExprCode
+    {
+        const uint32_t index;
+        const Token name;
+
+        GlobalRead(uint32_t index, Token name) : index(index), name(std::move(name)) {}
+
+        Value evaluate(Interpreter &interpreter) override
+        {
+            return interpreter.globals->getGlobal(index, name);
+        }
+    };
+
+    struct LocalWrite : ExprCode
+    {
+        const Resolution resolution;
+        const Token name;
+        const ExprPtr value;
+
+        LocalWrite(Resolution resolution, Token name, ExprPtr value)
+            : resolution(resolution), name(std::move(name)), value(std::move(value))
+        {
+        }
+
+        Value evaluate(Interpreter &interpreter) override
+        {
+            Value result(value->evaluate(interpreter));
+            environment(interpreter)->assignAt(resolution.depth, resolution.slot, name, result);
+            return result;
+        }
+    };
+
+    struct GlobalWrite : ExprCode
+    {
+        const uint32_t index;
+        const Token name;
+        const ExprPtr value;
+
+        GlobalWrite(uint32_t index, Token name, ExprPtr value)
+            : index(index), name(std::move(name)), value(std::move(value))
+        {
+        }
+
+        Value evaluate(Interpreter &interpreter) override
+        {
+            Value result(value->evaluate(interpreter));
+            interpreter.globals->assignGlobal(index, name, result);
+            return result;
+        }
+    };
+
+    struct BinaryCode : ExprCode
+    {
+        const Token op;
+        const ExprPtr left;
+        const ExprPtr right;
+
+        BinaryCode(Token op, ExprPtr left, ExprPtr right)
+            : op(std::move(op)), left(std::move(left)), right(std::move(right))
+        {
+        }
+    };
+
+    // an operator on two numbers, bound to its operation
+    template <typename Operation>
+    struct Arithmetic : BinaryCode
+    {
+        using BinaryCode::BinaryCode;
+
+        Value evaluate(Interpreter &interpreter) override
+        {
+            Value a(left->evaluate(interpreter)), b(right->evaluate(interpreter));
+            checkNumberOperands(op, a, b);
+            return Operation()(a.asNumber(), b.asNumber());
+        }
+    };
+
+    template <typename Operation>
+    struct Comparison : Arithmetic<Operation>
+    {
+        using Arithmetic<Operation>::Arithmetic;
+
+        bool test(Interpreter &interpreter) override
+        {
+            Value a(this->left->evaluate(interpreter)), b(this->right->evaluate(interpreter));
+            ClosureRuntime::checkNumberOperands(this->op, a, b);
+            return Operation()(a.asNumber(), b.asNumber());
+        }
+    };
+
+    // division and remainder refuse a zero denominator
+    template <typename Operation>
+    struct Division : BinaryCode
+    {
+        using BinaryCode::BinaryCode;
+
+        Value evaluate(Interpreter &interpreter) override
+        {
+            Value a(left->evaluate(interpreter)), b(right->evaluate(interpreter));
+            checkNumberOperands(op, a, b);
+            if (b.asNumber() == 0)
+                throw RuntimeError(op, "Denominator cannot be 0.");
+            return Operation()(a.asNumber(), b.asNumber());
+        }
+    };
+
+    struct Remainder
+    {
+        double operator()(double a, double b) const
+        {
+            return std::fmod(a, b);
+        }
+    };
+
+    // the integer operators work on the operands truncated to integers
+    template <typename Operation>
+    struct Integral
+    {
+        double operator()(double a, double b) const
+        {
+            return static_cast<double>(Operation()(static_cast<int64_t>(a), static_cast<int64_t>(b)));
+        }
+    };
+
+    struct ShiftLeft
+    {
+        int64_t operator()(int64_t a, int64_t b) const
+        {
+            return a << b;
+        }
+    };
+
+    struct ShiftRight
+    {
+        int64_t operator()(int64_t a, int64_t b) const
+        {
+            return a >> b;
+        }
+    };
+
+    struct Add : BinaryCode
+    {
+        using BinaryCode::BinaryCode;
+
+        Value evaluate(Interpreter &interpreter) override
+        {
+            Value a(left->evaluate(interpreter)), b(right->evaluate(interpreter));
+            if (a.isNumber() && b.isNumber())
+                return a.asNumber() + b.asNumber();
+            if (a.isString() || b.isString())
+                return Interpreter::stringify(a) + Interpreter::stringify(b);
+            checkNumberOperands(op, a, b);
+            return {};
+        }
+    };
+
+    template <bool is_equal>
+    struct Equality : BinaryCode
+    {
+        using BinaryCode::BinaryCode;
+
+        Value evaluate(Interpreter &interpreter) override
+        {
+            return test(interpreter);
+        }
+
+        bool test(Interpreter &interpreter) override
+        {
+            Value a(left->evaluate(interpreter)), b(right->evaluate(interpreter));
+            return Interpreter::isEqual(a, b) == is_equal;
+        }
+    };
+
+    struct Negate : ExprCode
+    {
+        const Token op;
+        const ExprPtr right;
+
+        Negate(Token op, ExprPtr right) : op(std::move(op)), right(std::move(right)) {}
+
+        Value evaluate(Interpreter &interpreter) override
+        {
+            Value operand(right->evaluate(interpreter));
+            checkNumberOperands(op, operand);
+            return -operand.asNumber();
+        }
+    };
+
+    struct Not : ExprCode
+    {
+        const ExprPtr right;
+
+        explicit Not(ExprPtr right) : right(std::move(right)) {}
+
+        Value evaluate(Interpreter &interpreter) override
+        {
+            return !right->test(interpreter);
+        }
+
+        bool test(Interpreter &interpreter) override
+        {
+            return !right->test(interpreter);
+        }
+    };
+
+    // `and` and `or` give back the operand that decided them
+    template <bool is_or>
+    struct ShortCircuit : ExprCode
+    {
+        const ExprPtr left;
+        const ExprPtr right;
+
+        ShortCircuit(ExprPtr left, ExprPtr right) : left(std::move(left)), right(std::move(right)) {}
+
+        Value evaluate(Interpreter &interpreter) override
+        {
+            Value decided(left->evaluate(interpreter));
+            if (Interpreter::isTruthy(decided) == is_or)
+                return decided;
+            return right->evaluate(interpreter);
+        }
+
+        bool test(Interpreter &interpreter) override
+        {
+            if (left->test(interpreter) == is_or)
+                return is_or;
+            return right->test(interpreter);
+        }
+    };
+
+    struct Conditional : ExprCode
+    {
+        const ExprPtr condition;
+        const ExprPtr true_branch;
+        const ExprPtr else_branch;
+
+        Conditional(ExprPtr condition, ExprPtr true_branch, ExprPtr else_branch)
+            : condition(std::move(condition)), true_branch(std::move(true_branch)),
+              else_branch(std::move(else_branch))
+        {
+        }
+
+        Value evaluate(Interpreter &interpreter) override
+        {
+            return condition->test(interpreter) ? true_branch->evaluate(interpreter)
+                                                : else_branch->evaluate(interpreter);
+        }
+    };
+
+    struct Sequence : ExprCode
+    {
+        const std::vector<ExprPtr> expressions;
+
+        explicit Sequence(std::vector<ExprPtr> expressions) : expressions(std::move(expressions)) {}
+
+        Value evaluate(Interpreter &interpreter) override
+        {
+            for (size_t i = 0; i + 1 < expressions.size(); i++)
+                expressions[i]->evaluate(interpreter);
+            return expressions.back()->evaluate(interpreter);
+        }
+    };
+
+    struct CallCode : ExprCode
+    {
+        // the object of a method call, or else the callee
+        const ExprPtr callee;
+        const std::shared_ptr<Get> invoke;
+        const std::vector<ExprPtr> arguments;
+        const Token paren;
+
+        CallCode(ExprPtr callee, std::shared_ptr<Get> invoke, std::vector<ExprPtr> arguments, Token paren)
+            : callee(std::move(callee)), invoke(std::move(invoke)), arguments(std::move(arguments)),
+              paren(std::move(paren))
+        {
+        }
+
+        Value evaluate(Interpreter &interpreter) override
+        {
+            Value function;
+            Ref<SurpherInstance> receiver;
+            SurpherFunction *method = nullptr;
+            if (invoke)
+                function = getMethod(interpreter, callee->evaluate(interpreter), invoke, receiver, method);
+            else
+                function = callee->evaluate(interpreter);
+
+            ArgumentWindow window(interpreter);
+            for (const auto &argument : arguments)
+                window.arguments.push_back(argument->evaluate(interpreter));
+
+            return call(interpreter, function, receiver, method, window.arguments, paren);
+        }
+    };
+
+    struct ElementRead : ExprCode
+    {
+        const std::shared_ptr<Access> expr;
+        const ExprPtr index;
+        const ExprPtr arr_name;
+
+        ElementRead(std::shared_ptr<Access> expr, ExprPtr index, ExprPtr arr_name)
+            : expr(std::move(expr)), index(std::move(index)), arr_name(std::move(arr_name))
+        {
+        }
+
+        Value evaluate(Interpreter &interpreter) override
+        {
+            Value position(index->evaluate(interpreter)), array(arr_name->evaluate(interpreter));
+            return getElement(*expr, array, position);
+        }
+    };
+
+    struct ElementWrite : ExprCode
+    {
+        const std::shared_ptr<ArraySet> expr;
+        const ExprPtr value;
+        const ExprPtr index;
+        const ExprPtr arr_name;
+
+        ElementWrite(std::shared_ptr<ArraySet> expr, ExprPtr value, ExprPtr index, ExprPtr arr_name)
+            : expr(std::move(expr)), value(std::move(value)), index(std::move(index)), arr_name(std::move(arr_name))
+        {
+        }
+
+        Value evaluate(Interpreter &interpreter) override
+        {
+            Value result(value->evaluate(interpreter));
+            Value position(index->evaluate(interpreter)), array(arr_name->evaluate(interpreter));
+            setElement(*expr, array, position, result);
+            return result;
+        }
+    };
+
+    // reads the loop's cached value, leaving the Interpreter to work it out the first time
+    struct InvariantRead : ExprCode
+    {
+        const std::shared_ptr<Invariant> expr;
+
+        explicit InvariantRead(std::shared_ptr<Invariant> expr) : expr(std::move(expr)) {}
+
+        Value evaluate(Interpreter &interpreter) override
+        {
+            const Value &cached(environment(interpreter)->getAt(expr->resolution.depth, expr->resolution.slot));
+            if (!cached.isNil())
+                return cached;
+            return ClosureRuntime::evaluate(interpreter, expr);
+        }
+    };
+
+    // an expression left to the Interpreter
+    struct Interpreted : ExprCode
+    {
+        const std::shared_ptr<Expr> expr;
+
+        explicit Interpreted(std::shared_ptr<Expr> expr) : expr(std::move(expr)) {}
+
+        Value evaluate(Interpreter &interpreter) override
+        {
+            return ClosureRuntime::evaluate(interpreter, expr);
+        }
+    };
+
+    struct ExpressionCode : StmtCode
+    {
+        const ExprPtr expression;
+
+        explicit ExpressionCode(ExprPtr expression) : expression(std::move(expression)) {}
+
+        Completion execute(Interpreter &interpreter) override
+        {
+            expression->evaluate(interpreter);
+            return Completion::NORMAL;
+        }
+    };
+
+    struct PrintCode : StmtCode
+    {
+        const ExprPtr expression;
+
+        explicit PrintCode(ExprPtr expression) : expression(std::move(expression)) {}
+
+        Completion execute(Interpreter &interpreter) override
+        {
+            std::cout << Interpreter::stringify(expression->evaluate(interpreter)) << std::endl;
+            return Completion::NORMAL;
+        }
+    };
+
+    struct VarCode : StmtCode
+    {
+        const std::shared_ptr<Var> stmt;
+        const std::vector<ExprPtr> initializers;
+
+        VarCode(std::shared_ptr<Var> stmt, std::vector<ExprPtr> initializers)
+            : stmt(std::move(stmt)), initializers(std::move(initializers))
+        {
+        }
+
+        Completion execute(Interpreter &interpreter) override
+        {
+            for (size_t i = 0; i < initializers.size(); i++)
+            {
+                const auto &var_init(stmt->var_inits[i]);
+                defineVariable(interpreter, stmt->slots[i], std::get<0>(var_init),
+                               initializers[i]->evaluate(interpreter), std::get<1>(var_init));
+            }
+            return Completion::NORMAL;
+        }
+    };
+
+    struct Statements : StmtCode
+    {
+        const std::vector<StmtPtr> statements;
+
+        explicit Statements(std::vector<StmtPtr> statements) : statements(std::move(statements)) {}
+
+        Completion execute(Interpreter &interpreter) override
+        {
+            for (const auto &statement : statements)
+            {
+                auto result(statement->execute(interpreter));
+                if (result != Completion::NORMAL)
+                    return result;
+            }
+            return Completion::NORMAL;
+        }
+
+        // like Interpreter::executeBlock
+        Completion executeIn(Interpreter &interpreter, const std::shared_ptr<Environment> &frame)
+        {
+            auto &current(environment(interpreter));
+            auto previous(current);
+            current = frame;
+            Completion result;
+            try
+            {
+                result = execute(interpreter);
+            }
+            catch (...)
+            {
+                environment(interpreter) = previous;
+                throw;
+            }
+            environment(interpreter) = previous;
+            return result;
+        }
+    };
+
+    struct BlockCode : StmtCode
+    {
+        const std::shared_ptr<Block> stmt;
+        const std::unique_ptr<Statements> body;
+
+        BlockCode(std::shared_ptr<Block> stmt, std::unique_ptr<Statements> body)
+            : stmt(std::move(stmt)), body(std::move(body))
+        {
+        }
+
+        Completion execute(Interpreter &interpreter) override
+        {
+            return body->executeIn(interpreter, interpreter.newFrame(environment(interpreter), stmt->slot_count,
+                                                                     stmt->escapes, stmt->boxed_slots));
+        }
+    };
+
+    struct IfCode : StmtCode
+    {
+        const ExprPtr condition;
+        const StmtPtr true_branch;
+        const StmtPtr else_branch;
+
+        IfCode(ExprPtr condition, StmtPtr true_branch, StmtPtr else_branch)
+            : condition(std::move(condition)), true_branch(std::move(true_branch)),
+              else_branch(std::move(else_branch))
+        {
+        }
+
+        Completion execute(Interpreter &interpreter) override
+        {
+            if (condition->test(interpreter))
+                return true_branch->execute(interpreter);
+            if (else_branch)
+                return else_branch->execute(interpreter);
+            return Completion::NORMAL;
+        }
+    };
+
+    // like Interpreter::visitWhileStmt; with a body scope, body holds the scope's statements
+    struct WhileCode : StmtCode
+    {
+        const std::shared_ptr<While> stmt;
+        const ExprPtr condition;
+        const std::unique_ptr<Statements> body;
+        const ExprPtr increment;
+
+        WhileCode(std::shared_ptr<While> stmt, ExprPtr condition, std::unique_ptr<Statements> body,
+                  ExprPtr increment)
+            : stmt(std::move(stmt)), condition(std::move(condition)), body(std::move(body)),
+              increment(std::move(increment))
+        {
+        }
+
+        Completion execute(Interpreter &interpreter) override
+        {
+            if (stmt->native && ClosureRuntime::runNative(interpreter, *stmt))
+                return completion(interpreter);
+
+            std::shared_ptr<Environment> body_environment;
+            if (stmt->body_scope)
+                body_environment = interpreter.newFrame(environment(interpreter), stmt->body_scope->slot_count, false, {});
+            for (uint32_t slot : stmt->invariant_slots)
+                environment(interpreter)->defineAt(slot, Value(), false);
+
+            while (condition->test(interpreter))
+            {
+                auto body_completion(body_environment ? body->executeIn(interpreter, body_environment)
+                                                      : body->execute(interpreter));
+                if (body_completion == Completion::BREAK)
+                {
+                    completion(interpreter) = Completion::NORMAL;
+                    break;
+                }
+                else if (body_completion == Completion::CONTINUE)
+                {
+                    completion(interpreter) = Completion::NORMAL;
+                }
+                else if (body_completion == Completion::RETURN)
+                {
+                    return Completion::RETURN;
+                }
+
+                if (increment)
+                    increment->evaluate(interpreter);
+
+                if (interpreter.jit && ++stmt->back_edges == NativeLoop::HOT_THRESHOLD &&
+                    (stmt->native = NativeLoop::compile(*stmt)) && ClosureRuntime::runNative(interpreter, *stmt))
+                    return completion(interpreter);
+            }
+            return Completion::NORMAL;
+        }
+    };
+
+    // break and continue, which leave the Interpreter's completion set like their visits do
+    template <Interpreter::Completion jump>
+    struct Jump : StmtCode
+    {
+        Completion execute(Interpreter &interpreter) override
+        {
+            return completion(interpreter) = jump;
+        }
+    };
+
+    struct ReturnCode : StmtCode
+    {
+        const ExprPtr value;
+
+        explicit ReturnCode(ExprPtr value) : value(std::move(value)) {}
+
+        Completion execute(Interpreter &interpreter) override
+        {
+            returnValue(interpreter) = value ? value->evaluate(interpreter) : Value();
+            return completion(interpreter) = Completion::RETURN;
+        }
+    };
+
+    // a statement left to the Interpreter
+    struct InterpretedStmt : StmtCode
+    {
+        const std::shared_ptr<Stmt> stmt;
+
+        explicit InterpretedStmt(std::shared_ptr<Stmt> stmt) : stmt(std::move(stmt)) {}
+
+        Completion execute(Interpreter &interpreter) override
+        {
+            return ClosureRuntime::execute(interpreter, stmt);
+        }
+    };
+
+    // Builds the closures for a tree. Each visit leaves its result in expr_code or stmt_code.
+    class CodeGenerator : public ExprVisitor, public StmtVisitor
+    {
+        ExprPtr expr_code;
+        StmtPtr stmt_code;
+
+        template <typename Code>
+        Value binary(const std::shared_ptr<Binary> &expr)
+        {
+            expr_code = std::make_unique<Code>(expr->op, compile(expr->left), compile(expr->right));
+            return {};
+        }
+
+        Value interpreted(const std::shared_ptr<Expr> &expr)
+        {
+            expr_code = std::make_unique<Interpreted>(expr);
+            return {};
+        }
+
+        Value interpreted(const std::shared_ptr<Stmt> &stmt)
+        {
+            stmt_code = std::make_unique<InterpretedStmt>(stmt);
+            return {};
+        }
+
+    public:
+        ExprPtr compile(const std::shared_ptr<Expr> &expr)
+        {
+            expr->accept(*this);
+            return std::move(expr_code);
+        }
+
+        StmtPtr compile(const std::shared_ptr<Stmt> &stmt)
+        {
+            stmt->accept(*this);
+            return std::move(stmt_code);
+        }
+
+        std::unique_ptr<Statements> compile(const std::list<std::shared_ptr<Stmt>> &statements)
+        {
+            std::vector<StmtPtr> code;
+            for (const auto &stmt : statements)
+                code.push_back(compile(stmt));
+            return std::make_unique<Statements>(std::move(code));
+        }
+
+        Value visitBinaryExpr(const std::shared_ptr<Binary> &expr) override
+        {
+            switch (expr->op.token_type)
+            {
+            case PLUS:
+                return binary<Add>(expr);
+            case MINUS:
+                return binary<Arithmetic<std::minus<double>>>(expr);
+            case STAR:
+                return binary<Arithmetic<std::multiplies<double>>>(expr);
+            case SLASH:
+                return binary<Division<std::divides<double>>>(expr);
+            case PERCENT:
+                return binary<Division<Remainder>>(expr);
+            case LEFT_SHIFT:
+                return binary<Arithmetic<Integral<ShiftLeft>>>(expr);
+            case RIGHT_SHIFT:
+                return binary<Arithmetic<Integral<ShiftRight>>>(expr);
+            case CARET:
+                return binary<Arithmetic<Integral<std::bit_xor<int64_t>>>>(expr);
+            case SINGLE_AMPERSAND:
+                return binary<Arithmetic<Integral<std::bit_and<int64_t>>>>(expr);
+            case SINGLE_BAR:
+                return binary<Arithmetic<Integral<std::bit_or<int64_t>>>>(expr);
+            case GREATER:
+                return binary<Comparison<std::greater<double>>>(expr);
+            case GREATER_EQUAL:
+                return binary<Comparison<std::greater_equal<double>>>(expr);
+            case LESS:
+                return binary<Comparison<std::less<double>>>(expr);
+            case LESS_EQUAL:
+                return binary<Comparison<std::less_equal<double>>>(expr);
+            case BANG_EQUAL:
+                return binary<Equality<false>>(expr);
+            case DOUBLE_EQUAL:
+                return binary<Equality<true>>(expr);
+            default:
+                return interpreted(std::static_pointer_cast<Expr>(expr));
+            }
+        }
+
+        Value visitGroupExpr(const std::shared_ptr<Group> &expr) override
+        {
+            expr_code = compile(expr->expr_in);
+            return {};
+        }
+
+        Value visitLiteralExpr(const std::shared_ptr<Literal> &expr) override
+        {
+            expr_code = std::make_unique<Constant>(expr->value);
+            return {};
+        }
+
+        Value visitUnaryExpr(const std::shared_ptr<Unary> &expr) override
+        {
+            if (expr->op.token_type == MINUS)
+                expr_code = std::make_unique<Negate>(expr->op, compile(expr->right));
+            else if (expr->op.token_type == BANG)
+                expr_code = std::make_unique<Not>(compile(expr->right));
+            else
+                interpreted(std::static_pointer_cast<Expr>(expr));
+            return {};
+        }
+
+        Value visitAssignExpr(const std::shared_ptr<Assign> &expr) override
+        {
+            if (expr->resolution.depth >= 0)
+                expr_code = std::make_unique<LocalWrite>(expr->resolution, expr->name, compile(expr->value));
+            else
+                expr_code = std::make_unique<GlobalWrite>(expr->resolution.slot, expr->name, compile(expr->value));
+            return {};
+        }
+
+        Value visitVariableExpr(const std::shared_ptr<Variable> &expr) override
+        {
+            if (expr->resolution.depth >= 0)
+                expr_code = std::make_unique<LocalRead>(expr->resolution);
+            else
+                expr_code = std::make_unique<GlobalRead>(expr->resolution.slot, expr->name);
+            return {};
+        }
+
+        Value visitLogicalExpr(const std::shared_ptr<Logical> &expr) override
+        {
+            if (expr->op.token_type == OR)
+                expr_code = std::make_unique<ShortCircuit<true>>(compile(expr->left), compile(expr->right));
+            else
+                expr_code = std::make_unique<ShortCircuit<false>>(compile(expr->left), compile(expr->right));
+            return {};
+        }
+
+        Value visitCallExpr(const std::shared_ptr<Call> &expr) override
+        {
+            std::vector<ExprPtr> arguments;
+            for (const auto &argument : expr->arguments)
+                arguments.push_back(compile(argument));
+            auto callee(compile(expr->invoke ? expr->invoke->object : expr->callee));
+            expr_code = std::make_unique<CallCode>(std::move(callee), expr->invoke, std::move(arguments), expr->paren);
+            return {};
+        }
+
+        Value visitLambdaExpr(const std::shared_ptr<Lambda> &expr) override
+        {
+            return interpreted(std::static_pointer_cast<Expr>(expr));
+        }
+
+        Value visitTernaryExpr(const std::shared_ptr<Ternary> &expr) override
+        {
+            auto condition(compile(expr->condition));
+            auto true_branch(compile(expr->true_branch));
+            expr_code = std::make_unique<Conditional>(std::move(condition), std::move(true_branch),
+                                                      compile(expr->else_branch));
+            return {};
+        }
+
+        Value visitGetExpr(const std::shared_ptr<Get> &expr) override
+        {
+            return interpreted(std::static_pointer_cast<Expr>(expr));
+        }
+
+        Value visitSetExpr(const std::shared_ptr<Set> &expr) override
+        {
+            return interpreted(std::static_pointer_cast<Expr>(expr));
+        }
+
+        Value visitThisExpr(const std::shared_ptr<This> &expr) override
+        {
+            return interpreted(std::static_pointer_cast<Expr>(expr));
+        }
+
+        Value visitSuperExpr(const std::shared_ptr<Super> &expr) override
+        {
+            return interpreted(std::static_pointer_cast<Expr>(expr));
+        }
+
+        Value visitArrayExpr(const std::shared_ptr<Array> &expr) override
+        {
+            return interpreted(std::static_pointer_cast<Expr>(expr));
+        }
+
+        Value visitAccessExpr(const std::shared_ptr<Access> &expr) override
+        {
+            auto index(compile(expr->index));
+            expr_code = std::make_unique<ElementRead>(expr, std::move(index), compile(expr->arr_name));
+            return {};
+        }
+
+        Value visitArraySetExpr(const std::shared_ptr<ArraySet> &expr) override
+        {
+            const auto &assignee(static_cast<const Access &>(*expr->assignee));
+            auto value(compile(expr->value));
+            auto index(compile(assignee.index));
+            expr_code = std::make_unique<ElementWrite>(expr, std::move(value), std::move(index),
+                                                       compile(assignee.arr_name));
+            return {};
+        }
+
+        Value visitCommaExpr(const std::shared_ptr<Comma> &expr) override
+        {
+            std::vector<ExprPtr> expressions;
+            for (const auto &expression : expr->expressions)
+                expressions.push_back(compile(expression));
+            expr_code = std::make_unique<Sequence>(std::move(expressions));
+            return {};
+        }
+
+        Value visitInvariantExpr(const std::shared_ptr<Invariant> &expr) override
+        {
+            expr_code = std::make_unique<InvariantRead>(expr);
+            return {};
+        }
+
+        Value visitBlockStmt(const std::shared_ptr<Block> &stmt) override
+        {
+            if (stmt->is_scoped)
+                stmt_code = std::make_unique<BlockCode>(stmt, compile(stmt->statements));
+            else
+                stmt_code = compile(stmt->statements);
+            return {};
+        }
+
+        Value visitExpressionStmt(const std::shared_ptr<Expression> &stmt) override
+        {
+            stmt_code = std::make_unique<ExpressionCode>(compile(stmt->expression));
+            return {};
+        }
+
+        Value visitPrintStmt(const std::shared_ptr<Print> &stmt) override
+        {
+            stmt_code = std::make_unique<PrintCode>(compile(stmt->expression));
+            return {};
+        }
+
+        Value visitVarStmt(const std::shared_ptr<Var> &stmt) override
+        {
+            std::vector<ExprPtr> initializers;
+            for (const auto &var_init : stmt->var_inits)
+                initializers.push_back(compile(std::get<2>(var_init)));
+            stmt_code = std::make_unique<VarCode>(stmt, std::move(initializers));
+            return {};
+        }
+
+        Value visitIfStmt(const std::shared_ptr<If> &stmt) override
+        {
+            auto condition(compile(stmt->condition));
+            auto true_branch(compile(stmt->true_branch));
+            stmt_code = std::make_unique<IfCode>(std::move(condition), std::move(true_branch),
+                                                 stmt->else_branch ? compile(stmt->else_branch) : nullptr);
+            return {};
+        }
+
+        Value visitWhileStmt(const std::shared_ptr<While> &stmt) override
+        {
+            auto condition(compile(stmt->condition));
+            auto body(stmt->body_scope ? compile(stmt->body_scope->statements)
+                                       : compile(std::list<std::shared_ptr<Stmt>>{stmt->body}));
+            stmt_code = std::make_unique<WhileCode>(stmt, std::move(condition), std::move(body),
+                                                    stmt->increment ? compile(stmt->increment) : nullptr);
+            return {};
+        }
+
+        Value visitBreakStmt(const std::shared_ptr<Break> &stmt) override
+        {
+            stmt_code = std::make_unique<Jump<Interpreter::Completion::BREAK>>();
+            return {};
+        }
+
+        Value visitContinueStmt(const std::shared_ptr<Continue> &stmt) override
+        {
+            stmt_code = std::make_unique<Jump<Interpreter::Completion::CONTINUE>>();
+            return {};
+        }
+
+        Value visitFunctionStmt(const std::shared_ptr<Function> &stmt) override
+        {
+            return interpreted(std::static_pointer_cast<Stmt>(stmt));
+        }
+
+        Value visitReturnStmt(const std::shared_ptr<Return> &stmt) override
+        {
+            stmt_code = std::make_unique<ReturnCode>(stmt->value ? compile(stmt->value) : nullptr);
+            return {};
+        }
+
+        Value visitClassStmt(const std::shared_ptr<Class> &stmt) override
+        {
+            return interpreted(std::static_pointer_cast<Stmt>(stmt));
+        }
+
+        Value visitImportStmt(const std::shared_ptr<Import> &stmt) override
+        {
+            return interpreted(std::static_pointer_cast<Stmt>(stmt));
+        }
+
+        Value visitNamespaceStmt(const std::shared_ptr<Namespace> &stmt) override
+        {
+            return interpreted(std::static_pointer_cast<Stmt>(stmt));
+        }
+
+        Value visitHaltStmt(const std::shared_ptr<Halt> &stmt) override
+        {
+            return interpreted(std::static_pointer_cast<Stmt>(stmt));
+        }
+
+        Value visitCompiledStmt(const std::shared_ptr<Compiled> &stmt) override
+        {
+            return interpreted(std::static_pointer_cast<Stmt>(stmt));
+        }
+    };
+
+    bool isCompiled(const std::list<std::shared_ptr<Stmt>> &statements)
+    {
+        return statements.size() == 1 && std::dynamic_pointer_cast<Compiled>(statements.front());
+    }
+}
+
+void ClosureCompiler::run(std::list<std::shared_ptr<Stmt>> &statements)
+{
+    OptimizationPass::run(statements);
+
+    // statements of the script stay apart, so a runtime error still ends only the one it occurs in
+    for (auto &stmt : statements)
+    {
+        if (!std::dynamic_pointer_cast<Compiled>(stmt))
+            stmt = std::make_shared<Compiled>(CodeGenerator().compile(stmt));
+    }
+}
+
+Value ClosureCompiler::visitFunctionStmt(const std::shared_ptr<Function> &stmt)
+{
+    // functions declared inside are compiled first, and are then declared by the Interpreter from inside the closures
+    OptimizationPass::visitFunctionStmt(stmt);
+    if (!stmt->body.empty() && !isCompiled(stmt->body))
+        stmt->body = {std::make_shared<Compiled>(CodeGenerator().compile(stmt->body))};
+    return {};
+}
@@ -0,0 +1,62 @@
+#ifndef SURPHER_CLOSURE_COMPILER_HPP
+#define SURPHER_CLOSURE_COMPILER_HPP
+
+#include "OptimizationPass.hpp"
+#include "Interpreter.hpp"
+
+// The parts of the Interpreter that compiled closures run on
+class ClosureRuntime
+{
+protected:
+    using Completion = Interpreter::Completion;
+    using ArgumentWindow = Interpreter::ArgumentWindow;
+
+    static std::shared_ptr<Environment> &environment(Interpreter &interpreter);
+
+    static Completion &completion(Interpreter &interpreter);
+
+    static Value &returnValue(Interpreter &interpreter);
+
+    static Value evaluate(Interpreter &interpreter, const std::shared_ptr<Expr> &expr);
+
+    static Completion execute(Interpreter &interpreter, const std::shared_ptr<Stmt> &stmt);
+
+    static void defineVariable(Interpreter &interpreter, int32_t slot, const Token &name, Value value, bool is_fixed);
+
+    static void checkNumberOperands(const Token &operator_token, const Value &operand);
+
+    static void checkNumberOperands(const Token &operator_token, const Value &left, const Value &right);
+
+    static Value getMethod(Interpreter &interpreter, const Value &object, const std::shared_ptr<Get> &invoke,
+                           Ref<SurpherInstance> &receiver, SurpherFunction *&method);
+
+    static Value call(Interpreter &interpreter, const Value &callee, const Ref<SurpherInstance> &receiver,
+                      SurpherFunction *method, const std::vector<Value> &arguments, const Token &paren);
+
+    static Value getElement(const Access &expr, const Value &arr_name, const Value &index);
+
+    static void setElement(const ArraySet &expr, const Value &arr_name, const Value &index, const Value &value);
+
+    static bool runNative(Interpreter &interpreter, While &stmt);
+};
+
+// a statement compiled to a closure: runs it and reports how it finished, like Interpreter::execute
+struct StmtCode : ClosureRuntime
+{
+    virtual ~StmtCode() = default;
+
+    virtual Completion execute(Interpreter &interpreter) = 0;
+};
+
+// Compiles each function body, and each statement of the script, into a tree of closures with their operands,
+// slots and operators bound, so running them needs no visits and no switch on the operator. Declarations and the
+// expressions that deal with objects are left for the Interpreter, reached from the closures around them.
+class ClosureCompiler : public OptimizationPass
+{
+public:
+    void run(std::list<std::shared_ptr<Stmt>> &statements) override;
+
+    Value visitFunctionStmt(const std::shared_ptr<Function> &stmt) override;
+};
+
+#endif // SURPHER_CLOSURE_COMPILER_HPP
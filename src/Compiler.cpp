@@ -0,0 +1,711 @@
+#include <utility>
+
+#include "Compiler.hpp"
+
+std::vector<std::shared_ptr<FunctionProto>> Compiler::compile(const std::list<std::shared_ptr<Stmt>> &statements)
+{
+    std::vector<std::shared_ptr<FunctionProto>> scripts;
+
+    // every top-level statement gets its own script so that a runtime error only aborts that statement,
+    // exactly like Interpreter::interpret
+    for (const auto &s : statements)
+    {
+        functions.push_back({std::make_shared<FunctionProto>("script")});
+        functions.back().locals.push_back({"", 0, false, true});
+
+        compile(s);
+        emitByte(OP_NIL);
+        emitByte(OP_RETURN);
+
+        scripts.emplace_back(functions.back().proto);
+        functions.pop_back();
+    }
+
+    return scripts;
+}
+
+void Compiler::compile(const std::shared_ptr<Expr> &expr)
+{
+    expr->accept(*this);
+}
+
+void Compiler::compile(const std::shared_ptr<Stmt> &stmt)
+{
+    stmt->accept(*this);
+}
+
+Chunk &Compiler::currentChunk()
+{
+    return functions.back().proto->chunk;
+}
+
+void Compiler::emitByte(uint8_t byte)
+{
+    currentChunk().write(byte, line);
+}
+
+void Compiler::emitBytes(uint8_t byte1, uint8_t byte2)
+{
+    emitByte(byte1);
+    emitByte(byte2);
+}
+
+void Compiler::emitShort(uint32_t value)
+{
+    if (value > UINT16_MAX)
+        throw UnsupportedError("Operand does not fit in 16 bits.");
+
+    emitBytes((value >> 8) & 0xff, value & 0xff);
+}
+
+uint32_t Compiler::makeConstant(const Value &value)
+{
+    uint32_t index(currentChunk().addConstant(value));
+    if (index > UINT16_MAX)
+        throw UnsupportedError("Too many constants in one chunk.");
+
+    return index;
+}
+
+uint32_t Compiler::makeName(const Token &name)
+{
+    uint32_t index(currentChunk().addName(name));
+    if (index > UINT16_MAX)
+        throw UnsupportedError("Too many names in one chunk.");
+
+    return index;
+}
+
+void Compiler::emitConstant(const Value &value)
+{
+    emitByte(OP_CONSTANT);
+    emitShort(makeConstant(value));
+}
+
+size_t Compiler::emitJump(OpCode op)
+{
+    emitByte(op);
+    emitBytes(0xff, 0xff);
+    return currentChunk().code.size() - 2;
+}
+
+void Compiler::patchJump(size_t offset)
+{
+    size_t jump(currentChunk().code.size() - offset - 2);
+    if (jump > UINT16_MAX)
+        throw UnsupportedError("Too much code to jump over.");
+
+    currentChunk().code[offset] = (jump >> 8) & 0xff;
+    currentChunk().code[offset + 1] = jump & 0xff;
+}
+
+void Compiler::emitLoop(size_t loop_start)
+{
+    emitByte(OP_LOOP);
+    emitShort(currentChunk().code.size() - loop_start + 2);
+}
+
+void Compiler::beginScope()
+{
+    functions.back().scope_depth++;
+}
+
+void Compiler::endScope()
+{
+    auto &function(functions.back());
+    function.scope_depth--;
+
+    discardLocals(function.scope_depth);
+    while (!function.locals.empty() && function.locals.back().depth > function.scope_depth)
+        function.locals.pop_back();
+}
+
+void Compiler::discardLocals(uint32_t depth)
+{
+    auto &locals(functions.back().locals);
+    for (auto local = locals.rbegin(); local != locals.rend() && local->depth > depth; local++)
+        emitByte(local->is_captured ? OP_CLOSE_UPVALUE : OP_POP);
+}
+
+void Compiler::addLocal(const Token &name, bool is_fixed)
+{
+    auto &function(functions.back());
+    if (function.locals.size() > UINT8_MAX)
+        throw UnsupportedError("Too many local variables in function.");
+
+    function.locals.push_back({name.lexeme, function.scope_depth, false, is_fixed});
+}
+
+void Compiler::defineVariable(const Token &name, bool is_fixed)
+{
+    if (functions.back().scope_depth > 0)
+    {
+        addLocal(name, is_fixed);
+        return;
+    }
+
+    emitByte(OP_DEFINE_GLOBAL);
+    emitShort(makeName(name));
+    emitByte(is_fixed);
+}
+
+int32_t Compiler::resolveLocal(FunctionState &function, const std::string &name)
+{
+    for (int32_t i = function.locals.size() - 1; i > 0; i--)
+    {
+        if (function.locals[i].name == name)
+            return i;
+    }
+
+    return -1;
+}
+
+int32_t Compiler::addUpvalue(FunctionState &function, uint8_t index, bool is_local, bool is_fixed)
+{
+    for (size_t i = 0; i < function.upvalues.size(); i++)
+    {
+        if (function.upvalues[i].index == index && function.upvalues[i].is_local == is_local)
+            return i;
+    }
+
+    if (function.upvalues.size() > UINT8_MAX)
+        throw UnsupportedError("Too many closure variables in function.");
+
+    function.upvalues.push_back({index, is_local, is_fixed});
+    function.proto->upvalue_count = function.upvalues.size();
+    return function.upvalues.size() - 1;
+}
+
+int32_t Compiler::resolveUpvalue(size_t function_index, const std::string &name)
+{
+    if (function_index == 0)
+        return -1;
+
+    auto &enclosing(functions[function_index - 1]);
+    int32_t local(resolveLocal(enclosing, name));
+    if (local != -1)
+    {
+        enclosing.locals[local].is_captured = true;
+        return addUpvalue(functions[function_index], local, true, enclosing.locals[local].is_fixed);
+    }
+
+    int32_t upvalue(resolveUpvalue(function_index - 1, name));
+    if (upvalue != -1)
+        return addUpvalue(functions[function_index], upvalue, false, enclosing.upvalues[upvalue].is_fixed);
+
+    return -1;
+}
+
+void Compiler::compileFunction(const Token &name, const std::vector<Token> &params,
+                               const std::list<std::shared_ptr<Stmt>> &body)
+{
+    functions.push_back({std::make_shared<FunctionProto>(name.lexeme)});
+    functions.back().locals.push_back({"", 0, false, true});
+    functions.back().proto->arity = params.size();
+
+    beginScope();
+    for (const auto &param : params)
+        addLocal(param, false);
+
+    for (const auto &s : body)
+        compile(s);
+
+    emitByte(OP_NIL);
+    emitByte(OP_RETURN);
+
+    auto function(std::move(functions.back()));
+    functions.pop_back();
+
+    emitByte(OP_CLOSURE);
+    uint32_t index(currentChunk().addFunction(function.proto));
+    if (index > UINT16_MAX)
+        throw UnsupportedError("Too many functions in one chunk.");
+    emitShort(index);
+    for (const auto &upvalue : function.upvalues)
+        emitBytes(upvalue.is_local, upvalue.index);
+}
+
+Value Compiler::visitBlockStmt(const std::shared_ptr<Block> &stmt)
+{
+    beginScope();
+    for (const auto &s : stmt->statements)
+        compile(s);
+    endScope();
+    return {};
+}
+
+Value Compiler::visitExpressionStmt(const std::shared_ptr<Expression> &stmt)
+{
+    compile(stmt->expression);
+    emitByte(OP_POP);
+    return {};
+}
+
+Value Compiler::visitPrintStmt(const std::shared_ptr<Print> &stmt)
+{
+    compile(stmt->expression);
+    emitByte(OP_PRINT);
+    return {};
+}
+
+Value Compiler::visitVarStmt(const std::shared_ptr<Var> &stmt)
+{
+    for (const auto &var_init : stmt->var_inits)
+    {
+        line = std::get<0>(var_init).line;
+        compile(std::get<2>(var_init));
+        defineVariable(std::get<0>(var_init), std::get<1>(var_init));
+    }
+
+    return {};
+}
+
+Value Compiler::visitIfStmt(const std::shared_ptr<If> &stmt)
+{
+    compile(stmt->condition);
+
+    size_t then_jump(emitJump(OP_JUMP_IF_FALSE));
+    emitByte(OP_POP);
+    compile(stmt->true_branch);
+
+    size_t else_jump(emitJump(OP_JUMP));
+    patchJump(then_jump);
+    emitByte(OP_POP);
+    if (stmt->else_branch)
+        compile(stmt->else_branch);
+
+    patchJump(else_jump);
+    return {};
+}
+
+Value Compiler::visitWhileStmt(const std::shared_ptr<While> &stmt)
+{
+    auto &function(functions.back());
+    size_t loop_start(currentChunk().code.size());
+    function.loops.push_back({loop_start, function.scope_depth, stmt->increment != nullptr, {}, {}});
+
+    compile(stmt->condition);
+    size_t exit_jump(emitJump(OP_JUMP_IF_FALSE));
+    emitByte(OP_POP);
+    compile(stmt->body);
+    if (stmt->increment)
+    {
+        for (size_t continue_jump : functions.back().loops.back().continue_jumps)
+            patchJump(continue_jump);
+        compile(stmt->increment);
+        emitByte(OP_POP);
+    }
+    emitLoop(loop_start);
+
+    patchJump(exit_jump);
+    emitByte(OP_POP);
+
+    for (size_t break_jump : functions.back().loops.back().break_jumps)
+        patchJump(break_jump);
+    functions.back().loops.pop_back();
+
+    return {};
+}
+
+Value Compiler::visitBreakStmt(const std::shared_ptr<Break> &stmt)
+{
+    auto &function(functions.back());
+    if (function.loops.empty())
+        throw UnsupportedError("'break' outside of a loop.");
+
+    line = stmt->break_tok.line;
+    discardLocals(function.loops.back().scope_depth);
+    function.loops.back().break_jumps.emplace_back(emitJump(OP_JUMP));
+    return {};
+}
+
+Value Compiler::visitContinueStmt(const std::shared_ptr<Continue> &stmt)
+{
+    auto &function(functions.back());
+    if (function.loops.empty())
+        throw UnsupportedError("'continue' outside of a loop.");
+
+    line = stmt->continue_tok.line;
+    discardLocals(function.loops.back().scope_depth);
+    if (function.loops.back().has_increment)
+        function.loops.back().continue_jumps.emplace_back(emitJump(OP_JUMP));
+    else
+        emitLoop(function.loops.back().start);
+    return {};
+}
+
+Value Compiler::visitFunctionStmt(const std::shared_ptr<Function> &stmt)
+{
+    line = stmt->name.line;
+    if (functions.back().scope_depth > 0)
+    {
+        addLocal(stmt->name, stmt->is_fixed);
+        compileFunction(stmt->name, stmt->params, stmt->body);
+    }
+    else
+    {
+        compileFunction(stmt->name, stmt->params, stmt->body);
+        defineVariable(stmt->name, stmt->is_fixed);
+    }
+
+    return {};
+}
+
+Value Compiler::visitReturnStmt(const std::shared_ptr<Return> &stmt)
+{
+    line = stmt->keyword.line;
+    if (stmt->value)
+        compile(stmt->value);
+    else
+        emitByte(OP_NIL);
+
+    emitByte(OP_RETURN);
+    return {};
+}
+
+Value Compiler::visitClassStmt(const std::shared_ptr<Class> &stmt)
+{
+    throw UnsupportedError("Classes are not supported by the bytecode compiler.");
+}
+
+Value Compiler::visitImportStmt(const std::shared_ptr<Import> &stmt)
+{
+    throw UnsupportedError("Imports are not supported by the bytecode compiler.");
+}
+
+Value Compiler::visitNamespaceStmt(const std::shared_ptr<Namespace> &stmt)
+{
+    throw UnsupportedError("Namespaces are not supported by the bytecode compiler.");
+}
+
+Value Compiler::visitHaltStmt(const std::shared_ptr<Halt> &stmt)
+{
+    line = stmt->keyword.line;
+    compile(stmt->message);
+    emitByte(OP_HALT);
+    return {};
+}
+
+Value Compiler::visitCompiledStmt(const std::shared_ptr<Compiled> &stmt)
+{
+    throw UnsupportedError("Statements compiled to closures have no bytecode.");
+}
+
+Value Compiler::visitBinaryExpr(const std::shared_ptr<Binary> &expr)
+{
+    compile(expr->left);
+    compile(expr->right);
+
+    line = expr->op.line;
+    switch (expr->op.token_type)
+    {
+    case MINUS:
+        emitByte(OP_SUBTRACT);
+        break;
+    case SLASH:
+        emitByte(OP_DIVIDE);
+        break;
+    case STAR:
+        emitByte(OP_MULTIPLY);
+        break;
+    case PLUS:
+        emitByte(OP_ADD);
+        break;
+    case LEFT_SHIFT:
+        emitByte(OP_LEFT_SHIFT);
+        break;
+    case RIGHT_SHIFT:
+        emitByte(OP_RIGHT_SHIFT);
+        break;
+    case CARET:
+        emitByte(OP_BIT_XOR);
+        break;
+    case PERCENT:
+        emitByte(OP_MODULO);
+        break;
+    case SINGLE_AMPERSAND:
+        emitByte(OP_BIT_AND);
+        break;
+    case SINGLE_BAR:
+        emitByte(OP_BIT_OR);
+        break;
+    case GREATER:
+        emitByte(OP_GREATER);
+        break;
+    case GREATER_EQUAL:
+        emitByte(OP_GREATER_EQUAL);
+        break;
+    case LESS:
+        emitByte(OP_LESS);
+        break;
+    case LESS_EQUAL:
+        emitByte(OP_LESS_EQUAL);
+        break;
+    case BANG_EQUAL:
+        emitByte(OP_NOT_EQUAL);
+        break;
+    case DOUBLE_EQUAL:
+        emitByte(OP_EQUAL);
+        break;
+    default:
+        throw UnsupportedError("Unexpected binary operator: " + expr->op.lexeme);
+    }
+
+    return {};
+}
+
+Value Compiler::visitGroupExpr(const std::shared_ptr<Group> &expr)
+{
+    compile(expr->expr_in);
+    return {};
+}
+
+Value Compiler::visitLiteralExpr(const std::shared_ptr<Literal> &expr)
+{
+    if (expr->value.isNil())
+        emitByte(OP_NIL);
+    else if (expr->value.isBool())
+        emitByte(expr->value.asBool() ? OP_TRUE : OP_FALSE);
+    else
+        emitConstant(expr->value);
+
+    return {};
+}
+
+Value Compiler::visitUnaryExpr(const std::shared_ptr<Unary> &expr)
+{
+    compile(expr->right);
+
+    line = expr->op.line;
+    switch (expr->op.token_type)
+    {
+    case MINUS:
+        emitByte(OP_NEGATE);
+        break;
+    case BANG:
+        emitByte(OP_NOT);
+        break;
+    default:
+        throw UnsupportedError("Unexpected unary operator: " + expr->op.lexeme);
+    }
+
+    return {};
+}
+
+Value Compiler::visitAssignExpr(const std::shared_ptr<Assign> &expr)
+{
+    compile(expr->value);
+
+    line = expr->name.line;
+    int32_t local(resolveLocal(functions.back(), expr->name.lexeme));
+    if (local != -1)
+    {
+        // the interpreter reports writes to fixed locals at run time; leave that to it
+        if (functions.back().locals[local].is_fixed)
+            throw UnsupportedError("Assignment to a fixed local.");
+
+        emitBytes(OP_SET_LOCAL, local);
+        return {};
+    }
+
+    int32_t upvalue(resolveUpvalue(functions.size() - 1, expr->name.lexeme));
+    if (upvalue != -1)
+    {
+        if (functions.back().upvalues[upvalue].is_fixed)
+            throw UnsupportedError("Assignment to a fixed local.");
+
+        emitBytes(OP_SET_UPVALUE, upvalue);
+        return {};
+    }
+
+    emitByte(OP_SET_GLOBAL);
+    emitShort(makeName(expr->name));
+    return {};
+}
+
+Value Compiler::visitVariableExpr(const std::shared_ptr<Variable> &expr)
+{
+    line = expr->name.line;
+    int32_t local(resolveLocal(functions.back(), expr->name.lexeme));
+    if (local != -1)
+    {
+        emitBytes(OP_GET_LOCAL, local);
+        return {};
+    }
+
+    int32_t upvalue(resolveUpvalue(functions.size() - 1, expr->name.lexeme));
+    if (upvalue != -1)
+    {
+        emitBytes(OP_GET_UPVALUE, upvalue);
+        return {};
+    }
+
+    emitByte(OP_GET_GLOBAL);
+    emitShort(makeName(expr->name));
+    return {};
+}
+
+Value Compiler::visitLogicalExpr(const std::shared_ptr<Logical> &expr)
+{
+    compile(expr->left);
+
+    line = expr->op.line;
+    if (expr->op.token_type == OR)
+    {
+        size_t else_jump(emitJump(OP_JUMP_IF_FALSE));
+        size_t end_jump(emitJump(OP_JUMP));
+
+        patchJump(else_jump);
+        emitByte(OP_POP);
+        compile(expr->right);
+        patchJump(end_jump);
+    }
+    else
+    {
+        size_t end_jump(emitJump(OP_JUMP_IF_FALSE));
+
+        emitByte(OP_POP);
+        compile(expr->right);
+        patchJump(end_jump);
+    }
+
+    return {};
+}
+
+void Compiler::compileCall(const std::shared_ptr<Call> &call)
+{
+    compile(call->callee);
+
+    size_t arg_count(call->arguments.size());
+    for (const auto &argument : call->arguments)
+        compile(argument);
+
+    if (arg_count > UINT8_MAX)
+        throw UnsupportedError("Too many arguments in one call.");
+
+    line = call->paren.line;
+    emitBytes(OP_CALL, arg_count);
+}
+
+Value Compiler::visitCallExpr(const std::shared_ptr<Call> &expr)
+{
+    compileCall(expr);
+    return {};
+}
+
+Value Compiler::visitLambdaExpr(const std::shared_ptr<Lambda> &expr)
+{
+    line = expr->name.line;
+    std::list<std::shared_ptr<Stmt>> lambda_return{std::make_shared<Return>(Token("return", {}, RETURN, expr->name.line), expr->body)};
+    compileFunction(expr->name, expr->params, lambda_return);
+    return {};
+}
+
+Value Compiler::visitTernaryExpr(const std::shared_ptr<Ternary> &expr)
+{
+    compile(expr->condition);
+
+    line = expr->question.line;
+    size_t else_jump(emitJump(OP_JUMP_IF_FALSE));
+    emitByte(OP_POP);
+    compile(expr->true_branch);
+
+    size_t end_jump(emitJump(OP_JUMP));
+    patchJump(else_jump);
+    emitByte(OP_POP);
+    compile(expr->else_branch);
+    patchJump(end_jump);
+
+    return {};
+}
+
+Value Compiler::visitGetExpr(const std::shared_ptr<Get> &expr)
+{
+    compile(expr->object);
+
+    line = expr->name.line;
+    emitByte(OP_GET_PROPERTY);
+    emitShort(makeName(expr->name));
+    return {};
+}
+
+Value Compiler::visitSetExpr(const std::shared_ptr<Set> &expr)
+{
+    compile(expr->object);
+    compile(expr->value);
+
+    line = expr->name.line;
+    emitByte(OP_SET_PROPERTY);
+    emitShort(makeName(expr->name));
+    return {};
+}
+
+Value Compiler::visitThisExpr(const std::shared_ptr<This> &expr)
+{
+    throw UnsupportedError("'this' is not supported by the bytecode compiler.");
+}
+
+Value Compiler::visitSuperExpr(const std::shared_ptr<Super> &expr)
+{
+    throw UnsupportedError("'super' is not supported by the bytecode compiler.");
+}
+
+Value Compiler::visitArrayExpr(const std::shared_ptr<Array> &expr)
+{
+    if (expr->dynamic_size)
+    {
+        compile(expr->dynamic_size);
+        line = expr->op.line;
+        emitByte(OP_ARRAY_ALLOC);
+        return {};
+    }
+
+    for (const auto &e : expr->expr_vector)
+        compile(e);
+
+    line = expr->op.line;
+    emitByte(OP_ARRAY);
+    emitShort(expr->expr_vector.size());
+    return {};
+}
+
+Value Compiler::visitAccessExpr(const std::shared_ptr<Access> &expr)
+{
+    compile(expr->index);
+    compile(expr->arr_name);
+
+    line = expr->op.line;
+    emitByte(OP_ACCESS);
+    return {};
+}
+
+Value Compiler::visitArraySetExpr(const std::shared_ptr<ArraySet> &expr)
+{
+    auto assignee(std::static_pointer_cast<Access>(expr->assignee));
+    compile(expr->value);
+    compile(assignee->index);
+    compile(assignee->arr_name);
+
+    line = expr->op.line;
+    emitByte(OP_ARRAY_SET);
+    return {};
+}
+
+Value Compiler::visitCommaExpr(const std::shared_ptr<Comma> &expr)
+{
+    for (size_t i = 0; i < expr->expressions.size(); i++)
+    {
+        compile(expr->expressions[i]);
+        if (i + 1 < expr->expressions.size())
+            emitByte(OP_POP);
+    }
+
+    return {};
+}
+
+Value Compiler::visitInvariantExpr(const std::shared_ptr<Invariant> &expr)
+{
+    // the cache is a slot the compiler knows nothing about; evaluating the expression every time is always correct
+    compile(expr->expr);
+    return {};
+}
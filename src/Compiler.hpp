@@ -0,0 +1,170 @@
+#ifndef SURPHER_COMPILER_HPP
+#define SURPHER_COMPILER_HPP
+
+#include <list>
+#include <vector>
+#include <memory>
+#include <stdexcept>
+
+#include "Chunk.hpp"
+#include "Expr.hpp"
+#include "Stmt.hpp"
+
+struct UnsupportedError : public std::runtime_error
+{
+    using std::runtime_error::runtime_error;
+};
+
+class Compiler : ExprVisitor, StmtVisitor
+{
+    struct Local
+    {
+        std::string name;
+        uint32_t depth;
+        bool is_captured;
+        bool is_fixed;
+    };
+    struct Upvalue
+    {
+        uint8_t index;
+        bool is_local;
+        bool is_fixed;
+    };
+    struct Loop
+    {
+        size_t start;
+        uint32_t scope_depth;
+        // "continue" jumps forward to the increment when there is one, back to the condition otherwise
+        bool has_increment;
+        std::vector<size_t> break_jumps;
+        std::vector<size_t> continue_jumps;
+    };
+    struct FunctionState
+    {
+        std::shared_ptr<FunctionProto> proto;
+        std::vector<Local> locals;
+        std::vector<Upvalue> upvalues;
+        std::vector<Loop> loops;
+        uint32_t scope_depth = 0;
+    };
+    std::vector<FunctionState> functions;
+    uint32_t line = 0;
+
+    Chunk &currentChunk();
+
+    void emitByte(uint8_t byte);
+
+    void emitBytes(uint8_t byte1, uint8_t byte2);
+
+    void emitShort(uint32_t value);
+
+    void emitConstant(const Value &value);
+
+    uint32_t makeConstant(const Value &value);
+
+    uint32_t makeName(const Token &name);
+
+    size_t emitJump(OpCode op);
+
+    void patchJump(size_t offset);
+
+    void emitLoop(size_t loop_start);
+
+    void beginScope();
+
+    void endScope();
+
+    void discardLocals(uint32_t depth);
+
+    void addLocal(const Token &name, bool is_fixed);
+
+    void defineVariable(const Token &name, bool is_fixed);
+
+    int32_t resolveLocal(FunctionState &function, const std::string &name);
+
+    int32_t resolveUpvalue(size_t function_index, const std::string &name);
+
+    int32_t addUpvalue(FunctionState &function, uint8_t index, bool is_local, bool is_fixed);
+
+    void compileFunction(const Token &name, const std::vector<Token> &params, const std::list<std::shared_ptr<Stmt>> &body);
+
+    void compileCall(const std::shared_ptr<Call> &call);
+
+    void compile(const std::shared_ptr<Expr> &expr);
+
+    void compile(const std::shared_ptr<Stmt> &stmt);
+
+public:
+    std::vector<std::shared_ptr<FunctionProto>> compile(const std::list<std::shared_ptr<Stmt>> &statements);
+
+    Value visitBlockStmt(const std::shared_ptr<Block> &stmt) override;
+
+    Value visitExpressionStmt(const std::shared_ptr<Expression> &stmt) override;
+
+    Value visitPrintStmt(const std::shared_ptr<Print> &stmt) override;
+
+    Value visitVarStmt(const std::shared_ptr<Var> &stmt) override;
+
+    Value visitIfStmt(const std::shared_ptr<If> &stmt) override;
+
+    Value visitWhileStmt(const std::shared_ptr<While> &stmt) override;
+
+    Value visitBreakStmt(const std::shared_ptr<Break> &stmt) override;
+
+    Value visitContinueStmt(const std::shared_ptr<Continue> &stmt) override;
+
+    Value visitFunctionStmt(const std::shared_ptr<Function> &stmt) override;
+
+    Value visitReturnStmt(const std::shared_ptr<Return> &stmt) override;
+
+    Value visitClassStmt(const std::shared_ptr<Class> &stmt) override;
+
+    Value visitImportStmt(const std::shared_ptr<Import> &stmt) override;
+
+    Value visitNamespaceStmt(const std::shared_ptr<Namespace> &stmt) override;
+
+    Value visitHaltStmt(const std::shared_ptr<Halt> &stmt) override;
+
+    Value visitCompiledStmt(const std::shared_ptr<Compiled> &stmt) override;
+
+    Value visitBinaryExpr(const std::shared_ptr<Binary> &expr) override;
+
+    Value visitGroupExpr(const std::shared_ptr<Group> &expr) override;
+
+    Value visitLiteralExpr(const std::shared_ptr<Literal> &expr) override;
+
+    Value visitUnaryExpr(const std::shared_ptr<Unary> &expr) override;
+
+    Value visitAssignExpr(const std::shared_ptr<Assign> &expr) override;
+
+    Value visitVariableExpr(const std::shared_ptr<Variable> &expr) override;
+
+    Value visitLogicalExpr(const std::shared_ptr<Logical> &expr) override;
+
+    Value visitCallExpr(const std::shared_ptr<Call> &expr) override;
+
+    Value visitLambdaExpr(const std::shared_ptr<Lambda> &expr) override;
+
+    Value visitTernaryExpr(const std::shared_ptr<Ternary> &expr) override;
+
+    Value visitGetExpr(const std::shared_ptr<Get> &expr) override;
+
+    Value visitSetExpr(const std::shared_ptr<Set> &expr) override;
+
+    Value visitThisExpr(const std::shared_ptr<This> &expr) override;
+
+    Value visitSuperExpr(const std::shared_ptr<Super> &expr) override;
+
+    Value visitArrayExpr(const std::shared_ptr<Array> &expr) override;
+
+    Value visitAccessExpr(const std::shared_ptr<Access> &expr) override;
+
+    Value visitArraySetExpr(const std::shared_ptr<ArraySet> &expr) override;
+
+    Value visitCommaExpr(const std::shared_ptr<Comma> &expr) override;
+
+    Value visitInvariantExpr(const std::shared_ptr<Invariant> &expr) override;
+
+};
+
+#endif // SURPHER_COMPILER_HPP
@@ -0,0 +1,119 @@
+#include <iostream>
+
+#include "ConstantFolder.hpp"
+#include "Interpreter.hpp"
+#include "Error.hpp"
+
+ConstantFolder::ConstantFolder(Interpreter &interpreter, bool dump) : interpreter(interpreter), dump(dump)
+{
+}
+
+void ConstantFolder::evaluateConstant(const std::shared_ptr<Expr> &expr, const Token &token)
+{
+    try
+    {
+        Value value(expr->accept(interpreter));
+        report(token, "expression", value);
+        replacement = std::make_shared<Literal>(std::move(value));
+    }
+    catch (const RuntimeError &)
+    {
+        // the error belongs to run time, if the expression is ever reached
+    }
+}
+
+void ConstantFolder::report(const Token &token, const std::string &what, const Value &value) const
+{
+    if (!dump)
+        return;
+
+    std::string value_str(Interpreter::stringify(value));
+    if (value.isString())
+        value_str = "\"" + value_str + "\"";
+    std::cerr << "[line " << token.line << "] folded " << what << " to " << value_str << "\n";
+}
+
+Value ConstantFolder::visitBinaryExpr(const std::shared_ptr<Binary> &expr)
+{
+    rewrite(expr->left);
+    rewrite(expr->right);
+    if (std::dynamic_pointer_cast<Literal>(expr->left) && std::dynamic_pointer_cast<Literal>(expr->right))
+        evaluateConstant(expr, expr->op);
+    return {};
+}
+
+Value ConstantFolder::visitGroupExpr(const std::shared_ptr<Group> &expr)
+{
+    // parentheses have done their job once the tree is built
+    rewrite(expr->expr_in);
+    replacement = expr->expr_in;
+    return {};
+}
+
+Value ConstantFolder::visitUnaryExpr(const std::shared_ptr<Unary> &expr)
+{
+    rewrite(expr->right);
+    if (std::dynamic_pointer_cast<Literal>(expr->right))
+        evaluateConstant(expr, expr->op);
+    return {};
+}
+
+Value ConstantFolder::visitVariableExpr(const std::shared_ptr<Variable> &expr)
+{
+    if (!expr->fixed_declaration)
+        return {};
+
+    // the declaration comes first in the tree, so its initialiser has already been folded
+    const auto &initializer(std::get<2>(expr->fixed_declaration->var_inits[expr->fixed_index]));
+    if (auto literal = std::dynamic_pointer_cast<Literal>(initializer))
+    {
+        report(expr->name, "\"" + expr->name.lexeme + "\"", literal->value);
+        replacement = literal;
+    }
+    return {};
+}
+
+Value ConstantFolder::visitLogicalExpr(const std::shared_ptr<Logical> &expr)
+{
+    rewrite(expr->left);
+    rewrite(expr->right);
+
+    // a constant left operand decides which operand is the result, whatever the right one is
+    if (auto left = std::dynamic_pointer_cast<Literal>(expr->left))
+    {
+        bool short_circuits = Interpreter::isTruthy(left->value) == (expr->op.token_type == OR);
+        replacement = short_circuits ? expr->left : expr->right;
+    }
+    return {};
+}
+
+Value ConstantFolder::visitTernaryExpr(const std::shared_ptr<Ternary> &expr)
+{
+    rewrite(expr->condition);
+    rewrite(expr->true_branch);
+    rewrite(expr->else_branch);
+
+    if (auto condition = std::dynamic_pointer_cast<Literal>(expr->condition))
+        replacement = Interpreter::isTruthy(condition->value) ? expr->true_branch : expr->else_branch;
+    return {};
+}
+
+Value ConstantFolder::visitCommaExpr(const std::shared_ptr<Comma> &expr)
+{
+    for (auto &expression : expr->expressions)
+        rewrite(expression);
+
+    // only the last operand gives the result, so the others are kept only for their side effects
+    auto &expressions(expr->expressions);
+    for (auto it = expressions.begin(); it + 1 < expressions.end();)
+    {
+        if (std::dynamic_pointer_cast<Literal>(*it) || std::dynamic_pointer_cast<Lambda>(*it))
+            it = expressions.erase(it);
+        else
+            ++it;
+    }
+
+    if (expressions.size() == 1)
+        replacement = expressions.front();
+    return {};
+}
@@ -0,0 +1,39 @@
+#ifndef SURPHER_CONSTANT_FOLDER_HPP
+#define SURPHER_CONSTANT_FOLDER_HPP
+
+#include "OptimizationPass.hpp"
+
+class Interpreter;
+
+// Replaces reads of fixed vars whose initialisers are constant with the constant, folds operators whose operands
+// are literals and drops parentheses and comma operands that do nothing. Operators are evaluated by the interpreter
+// itself, so a folded expression behaves exactly like the one it replaces; one that would fail at run time is left
+// alone.
+class ConstantFolder : public OptimizationPass
+{
+    Interpreter &interpreter;
+    const bool dump;
+
+    void evaluateConstant(const std::shared_ptr<Expr> &expr, const Token &token);
+
+    void report(const Token &token, const std::string &what, const Value &value) const;
+
+public:
+    ConstantFolder(Interpreter &interpreter, bool dump);
+
+    Value visitBinaryExpr(const std::shared_ptr<Binary> &expr) override;
+
+    Value visitGroupExpr(const std::shared_ptr<Group> &expr) override;
+
+    Value visitUnaryExpr(const std::shared_ptr<Unary> &expr) override;
+
+    Value visitVariableExpr(const std::shared_ptr<Variable> &expr) override;
+
+    Value visitLogicalExpr(const std::shared_ptr<Logical> &expr) override;
+
+    Value visitTernaryExpr(const std::shared_ptr<Ternary> &expr) override;
+
+    Value visitCommaExpr(const std::shared_ptr<Comma> &expr) override;
+};
+
+#endif // SURPHER_CONSTANT_FOLDER_HPP
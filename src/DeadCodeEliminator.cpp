@@ -0,0 +1,70 @@
+#include "DeadCodeEliminator.hpp"
+#include "Interpreter.hpp"
+
+bool DeadCodeEliminator::alwaysLeaves(const std::shared_ptr<Stmt> &stmt)
+{
+    if (std::dynamic_pointer_cast<Return>(stmt) || std::dynamic_pointer_cast<Break>(stmt) ||
+        std::dynamic_pointer_cast<Continue>(stmt) || std::dynamic_pointer_cast<Halt>(stmt))
+        return true;
+
+    if (auto block = std::dynamic_pointer_cast<Block>(stmt))
+        return !block->statements.empty() && alwaysLeaves(block->statements.back());
+
+    if (auto if_stmt = std::dynamic_pointer_cast<If>(stmt))
+        return if_stmt->else_branch && alwaysLeaves(if_stmt->true_branch) && alwaysLeaves(if_stmt->else_branch);
+
+    return false;
+}
+
+void DeadCodeEliminator::run(std::list<std::shared_ptr<Stmt>> &statements)
+{
+    // a top-level statement that fails, halts included, only ends itself: the script goes on with the next one
+    OptimizationPass::rewrite(statements);
+}
+
+void DeadCodeEliminator::rewrite(std::list<std::shared_ptr<Stmt>> &statements)
+{
+    OptimizationPass::rewrite(statements);
+
+    // nothing is hoisted, so whatever follows a statement that always leaves the list is never reached
+    for (auto it = statements.begin(); it != statements.end(); ++it)
+    {
+        if (alwaysLeaves(*it))
+        {
+            statements.erase(std::next(it), statements.end());
+            break;
+        }
+    }
+}
+
+Value DeadCodeEliminator::visitIfStmt(const std::shared_ptr<If> &stmt)
+{
+    OptimizationPass::visitIfStmt(stmt);
+
+    if (auto condition = std::dynamic_pointer_cast<Literal>(stmt->condition))
+    {
+        const auto &taken(Interpreter::isTruthy(condition->value) ? stmt->true_branch : stmt->else_branch);
+        stmt_replacement = taken ? taken : emptyStatement();
+    }
+    return {};
+}
+
+Value DeadCodeEliminator::visitWhileStmt(const std::shared_ptr<While> &stmt)
+{
+    OptimizationPass::visitWhileStmt(stmt);
+
+    auto condition(std::dynamic_pointer_cast<Literal>(stmt->condition));
+    if (condition && !Interpreter::isTruthy(condition->value))
+        stmt_replacement = emptyStatement();
+    return {};
+}
+
+Value DeadCodeEliminator::visitExpressionStmt(const std::shared_ptr<Expression> &stmt)
+{
+    OptimizationPass::visitExpressionStmt(stmt);
+
+    // what is left of an expression statement once folding has reduced it to a value
+    if (std::dynamic_pointer_cast<Literal>(stmt->expression) || std::dynamic_pointer_cast<Lambda>(stmt->expression))
+        stmt_replacement = emptyStatement();
+    return {};
+}
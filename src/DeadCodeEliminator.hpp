@@ -0,0 +1,28 @@
+#ifndef SURPHER_DEAD_CODE_ELIMINATOR_HPP
+#define SURPHER_DEAD_CODE_ELIMINATOR_HPP
+
+#include "OptimizationPass.hpp"
+
+// Drops statements that can never run: those after a return, break, continue or halt in the same list, the branch of
+// an if whose condition is a literal that isn't taken, and loops whose condition is a false literal. Runs after
+// constant folding, which is what turns most conditions into literals.
+class DeadCodeEliminator : public OptimizationPass
+{
+    static bool alwaysLeaves(const std::shared_ptr<Stmt> &stmt);
+
+protected:
+    void rewrite(std::list<std::shared_ptr<Stmt>> &statements) override;
+
+    using OptimizationPass::rewrite;
+
+public:
+    void run(std::list<std::shared_ptr<Stmt>> &statements) override;
+
+    Value visitIfStmt(const std::shared_ptr<If> &stmt) override;
+
+    Value visitWhileStmt(const std::shared_ptr<While> &stmt) override;
+
+    Value visitExpressionStmt(const std::shared_ptr<Expression> &stmt) override;
+};
+
+#endif // SURPHER_DEAD_CODE_ELIMINATOR_HPP
@@ -5,14 +5,12 @@
 #include "Token.hpp"
 #include "Error.hpp"
 
-void Environment::assign(const Token &name, const std::any &value)
+void Environment::assign(const Token &name, const Value &value)
 {
-    if (var_val_pairs.find(name.lexeme) != var_val_pairs.end())
+    auto elem(name_indices.find(name.lexeme));
+    if (elem != name_indices.end() && named[elem->second].is_defined)
     {
-        if (var_val_pairs[name.lexeme].first)
-            throw RuntimeError(name, "Can't modify fixed binding \"" + name.lexeme + "\".");
-
-        var_val_pairs[name.lexeme] = {false, value};
+        assignGlobal(elem->second, name, value);
         return;
     }
 
@@ -24,10 +22,11 @@ void Environment::assign(const Token &name, const std::any &value)
     throw RuntimeError(name, "Undefined variable '" + name.lexeme + "'.");
 }
 
-std::any Environment::get(const Token &name)
+Value Environment::get(const Token &name)
 {
-    if (var_val_pairs.find(name.lexeme) != var_val_pairs.end())
-        return var_val_pairs[name.lexeme].second;
+    auto elem(name_indices.find(name.lexeme));
+    if (elem != name_indices.end() && named[elem->second].is_defined)
+        return named[elem->second].value;
 
     if (enclosing != nullptr)
         return enclosing->get(name);
@@ -35,48 +34,169 @@ std::any Environment::get(const Token &name)
     throw RuntimeError(name, "Undefined variable \"" + name.lexeme + "\".");
 }
 
-void Environment::define(const std::string &var, const std::any &val, bool is_const)
+uint32_t Environment::globalIndex(const std::string &name)
+{
+    auto elem(name_indices.try_emplace(name, named.size()));
+    if (elem.second)
+        named.emplace_back();
+
+    return elem.first->second;
+}
+
+const Value &Environment::getGlobal(uint32_t index, const Token &name)
+{
+    const auto &binding(named[index]);
+    if (!binding.is_defined)
+        throw RuntimeError(name, "Undefined variable \"" + name.lexeme + "\".");
+
+    return binding.value;
+}
+
+void Environment::assignGlobal(uint32_t index, const Token &name, Value value)
 {
-    // assert(var_val_pairs.find(var) == var_val_pairs.end());
+    auto &binding(named[index]);
+    if (!binding.is_defined)
+        throw RuntimeError(name, "Undefined variable '" + name.lexeme + "'.");
+    if (binding.is_fixed)
+        throw RuntimeError(name, "Can't modify fixed binding \"" + name.lexeme + "\".");
 
-    var_val_pairs[var] = {is_const, val};
+    binding.value = std::move(value);
 }
 
-void Environment::define(const Token &var, std::any val, bool is_const)
+bool Environment::getFixed(const std::string &name, Value &value) const
 {
-    if (var_val_pairs.find(var.lexeme) != var_val_pairs.end())
+    auto elem(name_indices.find(name));
+    if (elem == name_indices.end() || !named[elem->second].is_defined || !named[elem->second].is_fixed)
+        return false;
+
+    value = named[elem->second].value;
+    return true;
+}
+
+bool Environment::getFixedAt(uint32_t slot, Value &value) const
+{
+    const auto &binding(bindings[slot]);
+    if (binding.second.isBox())
     {
-        if (var_val_pairs[var.lexeme].first)
-            throw RuntimeError(var, "Can't modify fixed binding \"" + var.lexeme + "\".");
+        auto box(binding.second.asPointer<SurpherBox>());
+        if (!box->is_fixed)
+            return false;
+        value = box->value;
+        return true;
     }
+    if (!binding.first)
+        return false;
+
+    value = binding.second;
+    return true;
+}
 
-    var_val_pairs[var.lexeme] = {is_const, std::move(val)};
+void Environment::define(const std::string &var, const Value &val, bool is_const)
+{
+    named[globalIndex(var)] = {val, is_const, true};
 }
 
-Environment::Environment(const std::shared_ptr<Environment>& enclosing)
+void Environment::define(const Token &var, Value val, bool is_const)
+{
+    auto &binding(named[globalIndex(var.lexeme)]);
+    if (binding.is_defined && binding.is_fixed)
+        throw RuntimeError(var, "Can't modify fixed binding \"" + var.lexeme + "\".");
+
+    binding = {std::move(val), is_const, true};
+}
+
+Environment::Environment(const std::shared_ptr<Environment>& enclosing, uint32_t slot_count)
+    : slots(slot_count), bindings(slots.data()), slot_count(slot_count)
 {
     this->enclosing = enclosing;
 }
 
-std::any Environment::getAt(uint32_t distance, const std::string &name)
+Environment::Environment(const std::shared_ptr<Environment> &enclosing, uint32_t slot_count, FrameStack &frame_stack)
+    : bindings(frame_stack.push(slot_count)), slot_count(slot_count), enclosing(enclosing)
 {
-    return ancestor(distance)->var_val_pairs[name].second;
+    if (bindings != nullptr)
+    {
+        this->frame_stack = &frame_stack;
+        return;
+    }
+    slots.resize(slot_count);
+    bindings = slots.data();
 }
 
-std::shared_ptr<Environment> Environment::ancestor(uint32_t distance)
+Environment::~Environment()
 {
-    std::shared_ptr<Environment> environment(shared_from_this());
+    if (frame_stack != nullptr)
+        frame_stack->pop(bindings, slot_count);
+}
+
+void Environment::defineAt(uint32_t slot, Value val, bool is_fixed)
+{
+    auto &binding(bindings[slot]);
+    if (binding.second.isBox())
+    {
+        auto box(binding.second.asPointer<SurpherBox>());
+        box->value = std::move(val);
+        box->is_fixed = is_fixed;
+        return;
+    }
+    binding = {is_fixed, std::move(val)};
+}
+
+void Environment::setFixedAt(uint32_t slot, bool is_fixed)
+{
+    auto &binding(bindings[slot]);
+    if (binding.second.isBox())
+        binding.second.asPointer<SurpherBox>()->is_fixed = is_fixed;
+    else
+        binding.first = is_fixed;
+}
+
+const Value &Environment::getAt(uint32_t distance, uint32_t slot)
+{
+    const auto &value(ancestor(distance)->bindings[slot].second);
+    if (value.isBox())
+        return value.asPointer<SurpherBox>()->value;
+    return value;
+}
+
+void Environment::boxAt(uint32_t slot)
+{
+    bindings[slot] = {false, makeRef<SurpherBox>()};
+}
+
+void Environment::bindBox(uint32_t slot, Ref<SurpherBox> box)
+{
+    bindings[slot] = {false, std::move(box)};
+}
+
+Ref<SurpherBox> Environment::getBoxAt(uint32_t distance, uint32_t slot)
+{
+    return ancestor(distance)->bindings[slot].second.as<SurpherBox>();
+}
+
+Environment *Environment::ancestor(uint32_t distance)
+{
+    Environment *environment(this);
     for (size_t i = 0; i < distance; i++)
-        environment = environment->enclosing;
+        environment = environment->enclosing.get();
 
     return environment;
 }
 
-void Environment::assignAt(uint32_t distance, const Token &name, std::any value)
+void Environment::assignAt(uint32_t distance, uint32_t slot, const Token &name, Value value)
 {
-    if (ancestor(distance)->var_val_pairs[name.lexeme].first)
+    auto &binding(ancestor(distance)->bindings[slot]);
+    if (binding.second.isBox())
+    {
+        auto box(binding.second.asPointer<SurpherBox>());
+        if (box->is_fixed)
+            throw RuntimeError(name, "Can't modify fixed binding \"" + name.lexeme + "\".");
+        box->value = std::move(value);
+        return;
+    }
+    if (binding.first)
         throw RuntimeError(name, "Can't modify fixed binding \"" + name.lexeme + "\".");
-    ancestor(distance)->var_val_pairs[name.lexeme] = {false, std::move(value)};
+    binding.second = std::move(value);
 }
 
 std::shared_ptr<Environment> Environment::getEnclosing()
@@ -86,10 +206,12 @@ std::shared_ptr<Environment> Environment::getEnclosing()
 
 void Environment::erase(const std::string &var)
 {
-    var_val_pairs.erase(var);
+    auto elem(name_indices.find(var));
+    if (elem != name_indices.end())
+        named[elem->second] = {};
 }
 
 void Environment::setFixed(const Token &name, bool is_fixed)
 {
-    var_val_pairs[name.lexeme].first = is_fixed;
+    named[globalIndex(name.lexeme)].is_fixed = is_fixed;
 }
\ No newline at end of file
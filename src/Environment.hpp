@@ -1,40 +1,99 @@
 #ifndef SURPHER_ENVIRONMENT_HPP
 #define SURPHER_ENVIRONMENT_HPP
 
+#include <string>
 #include <unordered_map>
 #include <memory>
-#include <any>
+#include <vector>
 #include <utility>
 
+#include "Value.hpp"
+#include "FrameStack.hpp"
+
 struct Token;
 
+// A local captured by a closure. Its slot holds the box instead of the value, and the closures that captured it
+// share the same box.
+struct SurpherBox : Object
+{
+    static constexpr ValueType value_type = ValueType::BOX;
+
+    Value value;
+    bool is_fixed = false;
+};
+
 class Environment : public std::enable_shared_from_this<Environment> {
-    std::unordered_map<std::string, std::pair<bool, std::any>> var_val_pairs;
+    struct NamedBinding
+    {
+        Value value;
+        bool is_fixed = false;
+        // names get an index before they are defined, so the Resolver can hand it out ahead of the definition
+        bool is_defined = false;
+    };
+    // globals and native modules are looked up by name or by the index the name was given, resolved locals by slot
+    std::unordered_map<std::string, uint32_t> name_indices;
+    std::vector<NamedBinding> named;
+    std::vector<Binding> slots;
+    // points into slots, or into a window of the frame stack for frames nothing outlives
+    Binding *bindings = nullptr;
+    uint32_t slot_count = 0;
+    FrameStack *frame_stack = nullptr;
     std::shared_ptr<Environment> enclosing;
 public:
     std::shared_ptr<Environment> getEnclosing();
 
-    void define(const std::string &var, const std::any& val, bool is_fixed);
+    void define(const std::string &var, const Value& val, bool is_fixed);
 
-    void define(const Token &var, std::any val, bool is_fixed);
+    void define(const Token &var, Value val, bool is_fixed);
 
     void erase(const std::string &var);
 
-    void assign(const Token &name, const std::any &value);
+    void assign(const Token &name, const Value &value);
 
     void setFixed(const Token &name, bool is_fixed);
 
-    void assignAt(uint32_t distance, const Token &name, std::any value);
+    Value get(const Token &name);
+
+    // the index of a name in this environment, for getGlobal and assignGlobal; reserves one if the name is new
+    uint32_t globalIndex(const std::string &name);
+
+    const Value &getGlobal(uint32_t index, const Token &name);
+
+    void assignGlobal(uint32_t index, const Token &name, Value value);
+
+    // looks only in this environment; true when the name is bound fixed, with its value
+    bool getFixed(const std::string &name, Value &value) const;
+
+    bool getFixedAt(uint32_t slot, Value &value) const;
 
-    std::any get(const Token &name);
+    void defineAt(uint32_t slot, Value val, bool is_fixed);
 
-    std::any getAt(uint32_t distance, const std::string &name);
+    void setFixedAt(uint32_t slot, bool is_fixed);
 
-    std::shared_ptr<Environment> ancestor(uint32_t distance);
+    void assignAt(uint32_t distance, uint32_t slot, const Token &name, Value value);
+
+    const Value &getAt(uint32_t distance, uint32_t slot);
+
+    // puts an empty box in a slot before its variable is defined
+    void boxAt(uint32_t slot);
+
+    void bindBox(uint32_t slot, Ref<SurpherBox> box);
+
+    Ref<SurpherBox> getBoxAt(uint32_t distance, uint32_t slot);
+
+    Environment *ancestor(uint32_t distance);
 
     Environment() = default;
 
-    Environment(const std::shared_ptr<Environment>& enclosing);
+    Environment(const std::shared_ptr<Environment>& enclosing, uint32_t slot_count = 0);
+
+    Environment(const std::shared_ptr<Environment> &enclosing, uint32_t slot_count, FrameStack &frame_stack);
+
+    Environment(const Environment &) = delete;
+
+    Environment &operator=(const Environment &) = delete;
+
+    ~Environment();
 };
 
 #endif //SURPHER_ENVIRONMENT_HPP
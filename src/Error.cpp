@@ -28,30 +28,6 @@ void runtimeError(const RuntimeError &error) {
     had_runtime_error = true;
 }
 
-void continueError(const ContinueError &error) {
-    std::cerr << error.what() << "\n[line " << error.continue_tok.line << "]\n";
-    had_runtime_error = true;
-}
-
-void breakError(const BreakError &error) {
-    std::cerr << error.what() << "\n[line " << error.break_tok.line << "]\n";
-    had_runtime_error = true;
-}
-
-BreakError::BreakError(Token token, const std::string_view &message) : std::runtime_error(message.data()),
-                                                                       break_tok{std::move(token)} {
-
-}
-
-ContinueError::ContinueError(Token token, const std::string_view &message) : std::runtime_error(message.data()),
-                                                                             continue_tok{std::move(token)} {
-
-}
-
-ReturnError::ReturnError(std::any value) : runtime_error(""), value(std::move(value)) {
-
-}
-
 ImportError::ImportError(std::string script, const std::string& new_module_name) : runtime_error(""), script(std::move(script)){
 module_name.emplace(new_module_name);
 }
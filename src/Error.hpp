@@ -3,7 +3,6 @@
 
 #include <string_view>
 #include <stdexcept>
-#include <any>
 #include <optional>
 #include "Token.hpp"
 
@@ -24,24 +23,6 @@ struct RuntimeError : public std::runtime_error {
     RuntimeError(Token token, const std::string_view &message);
 };
 
-struct BreakError : public std::runtime_error {
-    const Token break_tok;
-
-    BreakError(Token token, const std::string_view &message);
-};
-
-struct ContinueError : public std::runtime_error {
-    const Token continue_tok;
-
-    ContinueError(Token token, const std::string_view &message);
-};
-
-struct ReturnError : public std::runtime_error {
-    const std::any value;
-
-    explicit ReturnError(std::any value);
-};
-
 struct ImportError : public std::runtime_error{
     const std::string script;
     std::optional<std::string> module_name {std::nullopt};
@@ -52,9 +33,5 @@ struct ImportError : public std::runtime_error{
 
 void runtimeError(const RuntimeError &error);
 
-void continueError(const ContinueError &error);
-
-void breakError(const BreakError &error);
-
 
 #endif //SURPHER_ERROR_HPP
@@ -8,7 +8,7 @@ Binary::Binary(std::shared_ptr<Expr> left, Token op, std::shared_ptr<Expr> right
 {
 }
 
-std::any Binary::accept(ExprVisitor &visitor)
+Value Binary::accept(ExprVisitor &visitor)
 {
     return visitor.visitBinaryExpr(shared_from_this());
 }
@@ -17,16 +17,16 @@ Group::Group(std::shared_ptr<Expr> expr_in) : expr_in(std::move(expr_in))
 {
 }
 
-std::any Group::accept(ExprVisitor &visitor)
+Value Group::accept(ExprVisitor &visitor)
 {
     return visitor.visitGroupExpr(shared_from_this());
 }
 
-Literal::Literal(std::any value) : value(std::move(value))
+Literal::Literal(Value value) : value(std::move(value))
 {
 }
 
-std::any Literal::accept(ExprVisitor &visitor)
+Value Literal::accept(ExprVisitor &visitor)
 {
     return visitor.visitLiteralExpr(shared_from_this());
 }
@@ -35,7 +35,7 @@ Unary::Unary(Token op, std::shared_ptr<Expr> right) : op(std::move(op)), right(s
 {
 }
 
-std::any Unary::accept(ExprVisitor &visitor)
+Value Unary::accept(ExprVisitor &visitor)
 {
     return visitor.visitUnaryExpr(shared_from_this());
 }
@@ -44,7 +44,7 @@ Assign::Assign(Token name, std::shared_ptr<Expr> value) : name{std::move(name)},
 {
 }
 
-std::any Assign::accept(ExprVisitor &visitor)
+Value Assign::accept(ExprVisitor &visitor)
 {
     return visitor.visitAssignExpr(shared_from_this());
 }
@@ -53,29 +53,18 @@ Variable::Variable(Token name, bool is_fixed) : name(std::move(name)), is_fixed(
 {
 }
 
-std::any Variable::accept(ExprVisitor &visitor)
+Value Variable::accept(ExprVisitor &visitor)
 {
     return visitor.visitVariableExpr(shared_from_this());
 }
 
-Pipe::Pipe(std::shared_ptr<Expr> left, Token op, std::shared_ptr<Expr> right) : left{std::move(left)},
-                                                                                op{std::move(op)},
-                                                                                right{std::move(right)}
-{
-}
-
-std::any Pipe::accept(ExprVisitor &visitor)
-{
-    return visitor.visitPipeExpr(shared_from_this());
-}
-
 Logical::Logical(std::shared_ptr<Expr> left, Token op, std::shared_ptr<Expr> right) : left{std::move(left)},
                                                                                       op{std::move(op)},
                                                                                       right{std::move(right)}
 {
 }
 
-std::any Logical::accept(ExprVisitor &visitor)
+Value Logical::accept(ExprVisitor &visitor)
 {
     return visitor.visitLogicalExpr(shared_from_this());
 }
@@ -86,7 +75,7 @@ Call::Call(std::shared_ptr<Expr> callee, Token paren, std::vector<std::shared_pt
 {
 }
 
-std::any Call::accept(ExprVisitor &visitor)
+Value Call::accept(ExprVisitor &visitor)
 {
     return visitor.visitCallExpr(shared_from_this());
 }
@@ -97,7 +86,7 @@ Lambda::Lambda(Token name, std::vector<Token> params, std::shared_ptr<Expr> body
 {
 }
 
-std::any Lambda::accept(ExprVisitor &visitor)
+Value Lambda::accept(ExprVisitor &visitor)
 {
     return visitor.visitLambdaExpr(shared_from_this());
 }
@@ -109,27 +98,29 @@ Ternary::Ternary(std::shared_ptr<Expr> condition, Token question, std::shared_pt
 {
 }
 
-std::any Ternary::accept(ExprVisitor &visitor)
+Value Ternary::accept(ExprVisitor &visitor)
 {
     return visitor.visitTernaryExpr(shared_from_this());
 }
 
-Get::Get(std::shared_ptr<Expr> object, Token name) : object(std::move(object)), name(std::move(name))
+Get::Get(std::shared_ptr<Expr> object, Token name) : object(std::move(object)), name(std::move(name)),
+                                                     name_id(intern(this->name.lexeme))
 {
 }
 
-std::any Get::accept(ExprVisitor &visitor)
+Value Get::accept(ExprVisitor &visitor)
 {
     return visitor.visitGetExpr(shared_from_this());
 }
 
 Set::Set(std::shared_ptr<Expr> object, Token name, std::shared_ptr<Expr> value) : object(std::move(object)),
                                                                                   name(std::move(name)),
+                                                                                  name_id(intern(this->name.lexeme)),
                                                                                   value(std::move(value))
 {
 }
 
-std::any Set::accept(ExprVisitor &visitor)
+Value Set::accept(ExprVisitor &visitor)
 {
     return visitor.visitSetExpr(shared_from_this());
 }
@@ -138,16 +129,17 @@ This::This(Token keyword) : keyword(std::move(keyword))
 {
 }
 
-std::any This::accept(ExprVisitor &visitor)
+Value This::accept(ExprVisitor &visitor)
 {
     return visitor.visitThisExpr(shared_from_this());
 }
 
-Super::Super(Token keyword, Token method) : keyword(std::move(keyword)), method(std::move(method))
+Super::Super(Token keyword, Token method) : keyword(std::move(keyword)), method(std::move(method)),
+                                            method_id(intern(this->method.lexeme))
 {
 }
 
-std::any Super::accept(ExprVisitor &visitor)
+Value Super::accept(ExprVisitor &visitor)
 {
     return visitor.visitSuperExpr(shared_from_this());
 }
@@ -156,7 +148,7 @@ Array::Array(Token op, std::vector<std::shared_ptr<Expr>> expr_vector, std::shar
 {
 }
 
-std::any Array::accept(ExprVisitor &visitor)
+Value Array::accept(ExprVisitor &visitor)
 {
     return visitor.visitArrayExpr(shared_from_this());
 }
@@ -170,7 +162,7 @@ Access::Access(std::shared_ptr<Expr> index, std::shared_ptr<Expr> arr_name, Toke
 {
 }
 
-std::any Access::accept(ExprVisitor &visitor)
+Value Access::accept(ExprVisitor &visitor)
 {
     return visitor.visitAccessExpr(shared_from_this());
 }
@@ -179,14 +171,23 @@ ArraySet::ArraySet(std::shared_ptr<Expr> assignee, std::shared_ptr<Expr> value,
 {
 }
 
-std::any ArraySet::accept(ExprVisitor &visitor)
+Value ArraySet::accept(ExprVisitor &visitor)
 {
     return visitor.visitArraySetExpr(shared_from_this());
 }
 
 Comma::Comma(std::vector<std::shared_ptr<Expr>> expressions) : expressions(std::move(expressions)) {}
 
-std::any Comma::accept(ExprVisitor &visitor)
+Value Comma::accept(ExprVisitor &visitor)
 {
     return visitor.visitCommaExpr(shared_from_this());
+}
+
+Invariant::Invariant(std::shared_ptr<Expr> expr, Resolution resolution) : expr(std::move(expr)), resolution(resolution)
+{
+}
+
+Value Invariant::accept(ExprVisitor &visitor)
+{
+    return visitor.visitInvariantExpr(shared_from_this());
 }
\ No newline at end of file
@@ -2,13 +2,16 @@
 #define SURPHER_EXPR_HPP
 
 #include <memory>
-#include <any>
+#include "Value.hpp"
 #include <vector>
 #include <optional>
 
 #include "Token.hpp"
+#include "Shape.hpp"
 
 struct Stmt;
+struct Function;
+struct Var;
 struct Binary;
 struct Ternary;
 struct Group;
@@ -27,132 +30,166 @@ struct Array;
 struct Access;
 struct ArraySet;
 struct Comma;
-struct Pipe;
+struct Invariant;
 
 struct ExprVisitor
 {
-    virtual std::any visitBinaryExpr(const std::shared_ptr<Binary> &expr) = 0;
+    virtual Value visitBinaryExpr(const std::shared_ptr<Binary> &expr) = 0;
 
-    virtual std::any visitGroupExpr(const std::shared_ptr<Group> &expr) = 0;
+    virtual Value visitGroupExpr(const std::shared_ptr<Group> &expr) = 0;
 
-    virtual std::any visitLiteralExpr(const std::shared_ptr<Literal> &expr) = 0;
+    virtual Value visitLiteralExpr(const std::shared_ptr<Literal> &expr) = 0;
 
-    virtual std::any visitUnaryExpr(const std::shared_ptr<Unary> &expr) = 0;
+    virtual Value visitUnaryExpr(const std::shared_ptr<Unary> &expr) = 0;
 
-    virtual std::any visitAssignExpr(const std::shared_ptr<Assign> &expr) = 0;
+    virtual Value visitAssignExpr(const std::shared_ptr<Assign> &expr) = 0;
 
-    virtual std::any visitVariableExpr(const std::shared_ptr<Variable> &expr) = 0;
+    virtual Value visitVariableExpr(const std::shared_ptr<Variable> &expr) = 0;
 
-    virtual std::any visitLogicalExpr(const std::shared_ptr<Logical> &expr) = 0;
+    virtual Value visitLogicalExpr(const std::shared_ptr<Logical> &expr) = 0;
 
-    virtual std::any visitCallExpr(const std::shared_ptr<Call> &expr) = 0;
+    virtual Value visitCallExpr(const std::shared_ptr<Call> &expr) = 0;
 
-    virtual std::any visitLambdaExpr(const std::shared_ptr<Lambda> &expr) = 0;
+    virtual Value visitLambdaExpr(const std::shared_ptr<Lambda> &expr) = 0;
 
-    virtual std::any visitTernaryExpr(const std::shared_ptr<Ternary> &expr) = 0;
+    virtual Value visitTernaryExpr(const std::shared_ptr<Ternary> &expr) = 0;
 
-    virtual std::any visitGetExpr(const std::shared_ptr<Get> &expr) = 0;
+    virtual Value visitGetExpr(const std::shared_ptr<Get> &expr) = 0;
 
-    virtual std::any visitSetExpr(const std::shared_ptr<Set> &expr) = 0;
+    virtual Value visitSetExpr(const std::shared_ptr<Set> &expr) = 0;
 
-    virtual std::any visitThisExpr(const std::shared_ptr<This> &expr) = 0;
+    virtual Value visitThisExpr(const std::shared_ptr<This> &expr) = 0;
 
-    virtual std::any visitSuperExpr(const std::shared_ptr<Super> &expr) = 0;
+    virtual Value visitSuperExpr(const std::shared_ptr<Super> &expr) = 0;
 
-    virtual std::any visitArrayExpr(const std::shared_ptr<Array> &expr) = 0;
+    virtual Value visitArrayExpr(const std::shared_ptr<Array> &expr) = 0;
 
-    virtual std::any visitAccessExpr(const std::shared_ptr<Access> &expr) = 0;
+    virtual Value visitAccessExpr(const std::shared_ptr<Access> &expr) = 0;
 
-    virtual std::any visitArraySetExpr(const std::shared_ptr<ArraySet> &expr) = 0;
+    virtual Value visitArraySetExpr(const std::shared_ptr<ArraySet> &expr) = 0;
 
-    virtual std::any visitCommaExpr(const std::shared_ptr<Comma> &expr) = 0;
+    virtual Value visitCommaExpr(const std::shared_ptr<Comma> &expr) = 0;
 
-    virtual std::any visitPipeExpr(const std::shared_ptr<Pipe> &expr) = 0;
+    virtual Value visitInvariantExpr(const std::shared_ptr<Invariant> &expr) = 0;
 };
 
-struct Expr
+// filled in by the Resolver: how many scopes up a local lives and its slot in that scope; depth -1 means global,
+// and slot is then its index in the global table
+struct Resolution
 {
-    virtual std::any accept(ExprVisitor &visitor) = 0;
+    int32_t depth = -1;
+    uint32_t slot = 0;
 };
 
-struct Binary : Expr, public std::enable_shared_from_this<Binary>
+struct Expr
 {
-    const std::shared_ptr<Expr> left;
-    const Token op;
-    const std::shared_ptr<Expr> right;
-
-    Binary(std::shared_ptr<Expr> left, Token op, std::shared_ptr<Expr> right);
-
-    std::any accept(ExprVisitor &visitor) override;
+    virtual Value accept(ExprVisitor &visitor) = 0;
 };
 
-struct Pipe : Expr, public std::enable_shared_from_this<Pipe>
+struct Binary : Expr, public std::enable_shared_from_this<Binary>
 {
-    const std::shared_ptr<Expr> left;
+    // what the Interpreter has seen the operator applied to: the first evaluation picks the variant matching the
+    // operand types, and an evaluation its guard turns away sends the node to GENERIC for good
+    enum class Specialisation : uint8_t
+    {
+        UNSPECIALISED,
+        NUMBER_ADD,
+        STRING_CONCAT,
+        NUMBER_SUBTRACT,
+        NUMBER_MULTIPLY,
+        NUMBER_LESS,
+        NUMBER_LESS_EQUAL,
+        NUMBER_GREATER,
+        NUMBER_GREATER_EQUAL,
+        NUMBER_EQUAL,
+        NUMBER_NOT_EQUAL,
+        GENERIC
+    };
+
+    // how a specialised node reads an operand: a local variable or a literal is read in place rather than visited
+    enum class Operand : uint8_t
+    {
+        EXPRESSION,
+        LOCAL,
+        LITERAL
+    };
+
+    std::shared_ptr<Expr> left;
     const Token op;
-    const std::shared_ptr<Expr> right;
+    std::shared_ptr<Expr> right;
+    Specialisation specialisation = Specialisation::UNSPECIALISED;
+    Operand left_operand = Operand::EXPRESSION;
+    Operand right_operand = Operand::EXPRESSION;
 
-    Pipe(std::shared_ptr<Expr> left, Token op, std::shared_ptr<Expr> right);
+    Binary(std::shared_ptr<Expr> left, Token op, std::shared_ptr<Expr> right);
 
-    std::any accept(ExprVisitor &visitor) override;
+    Value accept(ExprVisitor &visitor) override;
 };
 
 struct Logical : Expr, public std::enable_shared_from_this<Logical>
 {
-    const std::shared_ptr<Expr> left;
+    std::shared_ptr<Expr> left;
     const Token op;
-    const std::shared_ptr<Expr> right;
+    std::shared_ptr<Expr> right;
 
     Logical(std::shared_ptr<Expr> left, Token op, std::shared_ptr<Expr> right);
 
-    std::any accept(ExprVisitor &visitor) override;
+    Value accept(ExprVisitor &visitor) override;
 };
 
 struct Group : Expr, public std::enable_shared_from_this<Group>
 {
-    const std::shared_ptr<Expr> expr_in;
+    std::shared_ptr<Expr> expr_in;
 
     explicit Group(std::shared_ptr<Expr> expr);
 
-    std::any accept(ExprVisitor &visitor) override;
+    Value accept(ExprVisitor &visitor) override;
 };
 
 struct Literal : Expr, public std::enable_shared_from_this<Literal>
 {
-    const std::any value;
+    const Value value;
 
-    explicit Literal(std::any value);
+    explicit Literal(Value value);
 
-    std::any accept(ExprVisitor &visitor) override;
+    Value accept(ExprVisitor &visitor) override;
 };
 
 struct Unary : Expr, public std::enable_shared_from_this<Unary>
 {
     const Token op;
-    const std::shared_ptr<Expr> right;
+    std::shared_ptr<Expr> right;
 
     Unary(Token op, std::shared_ptr<Expr> right);
 
-    std::any accept(ExprVisitor &visitor) override;
+    Value accept(ExprVisitor &visitor) override;
 };
 
 struct Assign : Expr, public std::enable_shared_from_this<Assign>
 {
     const Token name;
-    const std::shared_ptr<Expr> value;
+    std::shared_ptr<Expr> value;
+    Resolution resolution;
 
     Assign(Token name, std::shared_ptr<Expr> value);
-    std::any accept(ExprVisitor &visitor) override;
+    Value accept(ExprVisitor &visitor) override;
 };
 
 struct Variable : Expr, public std::enable_shared_from_this<Variable>
 {
     const Token name;
     const bool is_fixed;
+    Resolution resolution;
+    // set by the Resolver when the variable names a fixed var with an initialiser, so its value can be propagated
+    std::shared_ptr<Var> fixed_declaration;
+    size_t fixed_index = 0;
+    // set by the Resolver when the variable names a function declaration that can't be rebound, so calls through
+    // it can be inlined
+    std::shared_ptr<Function> function_declaration;
 
     Variable(Token name, bool is_fixed);
 
-    std::any accept(ExprVisitor &visitor) override;
+    Value accept(ExprVisitor &visitor) override;
 };
 
 struct Call : Expr, public std::enable_shared_from_this<Call>
@@ -160,10 +197,12 @@ struct Call : Expr, public std::enable_shared_from_this<Call>
     const std::shared_ptr<Expr> callee;
     const Token paren;
     std::vector<std::shared_ptr<Expr>> arguments;
+    // set by the Resolver when the callee is a property access, so a method can be called without binding it first
+    std::shared_ptr<Get> invoke;
 
     Call(std::shared_ptr<Expr> callee, Token paren, std::vector<std::shared_ptr<Expr>> arguments);
 
-    std::any accept(ExprVisitor &visitor) override;
+    Value accept(ExprVisitor &visitor) override;
 };
 
 struct Lambda : Expr, public std::enable_shared_from_this<Lambda>
@@ -171,108 +210,138 @@ struct Lambda : Expr, public std::enable_shared_from_this<Lambda>
     const Token name;
     const std::vector<Token> params;
     const std::shared_ptr<Expr> body;
+    // the body wrapped in a return statement, built once by the Resolver
+    std::shared_ptr<Function> function;
 
     Lambda(Token name, std::vector<Token> params, std::shared_ptr<Expr> body);
 
-    std::any accept(ExprVisitor &visitor) override;
+    Value accept(ExprVisitor &visitor) override;
 };
 
 struct Ternary : Expr, public std::enable_shared_from_this<Ternary>
 {
-    const std::shared_ptr<Expr> condition;
+    std::shared_ptr<Expr> condition;
     const Token question;
-    const std::shared_ptr<Expr> true_branch;
+    std::shared_ptr<Expr> true_branch;
     const Token colon;
-    const std::shared_ptr<Expr> else_branch;
+    std::shared_ptr<Expr> else_branch;
 
     Ternary(std::shared_ptr<Expr> condition, Token question, std::shared_ptr<Expr> true_branch, Token colon, std::shared_ptr<Expr> else_branch);
 
-    std::any accept(ExprVisitor &visitor) override;
+    Value accept(ExprVisitor &visitor) override;
 };
 
 struct Get : Expr, public std::enable_shared_from_this<Get>
 {
     const std::shared_ptr<Expr> object;
     const Token name;
+    const SymbolId name_id;
+    PropertyCache cache;
+    // set by the Resolver when the object is a fixed global namespace and the member is fixed too, like Math.sin
+    Value bound_member;
 
     Get(std::shared_ptr<Expr> object, Token name);
 
-    std::any accept(ExprVisitor &visitor) override;
+    Value accept(ExprVisitor &visitor) override;
 };
 
 struct Set : Expr, public std::enable_shared_from_this<Set>
 {
     const std::shared_ptr<Expr> object;
     const Token name;
-    const std::shared_ptr<Expr> value;
+    const SymbolId name_id;
+    std::shared_ptr<Expr> value;
+    PropertyCache cache;
 
     Set(std::shared_ptr<Expr> object, Token name, std::shared_ptr<Expr> value);
 
-    std::any accept(ExprVisitor &visitor) override;
+    Value accept(ExprVisitor &visitor) override;
 };
 
 struct This : Expr, public std::enable_shared_from_this<This>
 {
     const Token keyword;
+    Resolution resolution;
 
     explicit This(Token keyword);
 
-    std::any accept(ExprVisitor &visitor) override;
+    Value accept(ExprVisitor &visitor) override;
 };
 
 struct Super : Expr, public std::enable_shared_from_this<Super>
 {
     const Token keyword;
     const Token method;
+    const SymbolId method_id;
+    Resolution resolution;
+    Resolution this_resolution;
 
     Super(Token keyword, Token method);
 
-    std::any accept(ExprVisitor &visitor) override;
+    Value accept(ExprVisitor &visitor) override;
 };
 
 struct Array : Expr, public std::enable_shared_from_this<Array>
 {
     const Token op;
-    const std::vector<std::shared_ptr<Expr>> expr_vector;
+    std::vector<std::shared_ptr<Expr>> expr_vector;
     uint64_t size;
-    const std::shared_ptr<Expr> dynamic_size;
+    std::shared_ptr<Expr> dynamic_size;
 
     Array(Token op, std::vector<std::shared_ptr<Expr>> expr_vector, std::shared_ptr<Expr> dynamic_size);
 
     void setArraySize(uint64_t new_size);
 
-    std::any accept(ExprVisitor &visitor) override;
+    Value accept(ExprVisitor &visitor) override;
 };
 
 struct Access : Expr, public std::enable_shared_from_this<Access>
 {
-    const std::shared_ptr<Expr> index;
+    std::shared_ptr<Expr> index;
     const std::shared_ptr<Expr> arr_name;
     const Token op;
+    // cleared by the loop optimiser when the index is a loop counter proven to be an integer within the array
+    bool is_bounds_checked = true;
 
     Access(std::shared_ptr<Expr> index, std::shared_ptr<Expr> arr_name, Token op);
 
-    std::any accept(ExprVisitor &visitor) override;
+    Value accept(ExprVisitor &visitor) override;
 };
 
 struct ArraySet : Expr, public std::enable_shared_from_this<ArraySet>
 {
     const std::shared_ptr<Expr> assignee;
-    const std::shared_ptr<Expr> value;
+    std::shared_ptr<Expr> value;
     const Token op;
 
     ArraySet(std::shared_ptr<Expr> assignee, std::shared_ptr<Expr> value, Token op);
 
-    std::any accept(ExprVisitor &visitor) override;
+    Value accept(ExprVisitor &visitor) override;
 };
 
 struct Comma : Expr, public std::enable_shared_from_this<Comma>
 {
-    const std::vector<std::shared_ptr<Expr>> expressions;
+    std::vector<std::shared_ptr<Expr>> expressions;
 
     explicit Comma(std::vector<std::shared_ptr<Expr>> expressions);
 
-    std::any accept(ExprVisitor &visitor) override;
+    Value accept(ExprVisitor &visitor) override;
+};
+
+// Inserted by the loop optimiser around an expression that can't change while its loop runs: the first evaluation
+// after the loop is entered is kept in a slot of the loop's frame and read back from then on. A nil result is simply
+// evaluated again.
+struct Invariant : Expr, public std::enable_shared_from_this<Invariant>
+{
+    const std::shared_ptr<Expr> expr;
+    Resolution resolution;
+    // set when expr is a call to sizeOf: only the sizes of arrays and strings are kept, since a class's sizeOf
+    // protocol is user code and has to run every time
+    std::shared_ptr<Expr> size_of_argument;
+
+    Invariant(std::shared_ptr<Expr> expr, Resolution resolution);
+
+    Value accept(ExprVisitor &visitor) override;
 };
 
 #endif // SURPHER_EXPR_HPP
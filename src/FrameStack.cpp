@@ -0,0 +1,41 @@
+#include <cassert>
+
+#include "FrameStack.hpp"
+
+Binding *FrameStack::push(uint32_t count)
+{
+    if (count == 0 || count > chunk_size)
+        return nullptr;
+
+    if (chunks.empty())
+        chunks.emplace_back(new Binding[chunk_size]);
+
+    if (top + count > chunk_size)
+    {
+        tops.push_back(top);
+        chunk++;
+        top = 0;
+        if (chunk == chunks.size())
+            chunks.emplace_back(new Binding[chunk_size]);
+    }
+
+    Binding *window(chunks[chunk].get() + top);
+    top += count;
+    return window;
+}
+
+void FrameStack::pop(Binding *window, uint32_t count)
+{
+    assert(window + count == chunks[chunk].get() + top);
+
+    for (uint32_t i = 0; i < count; i++)
+        window[i] = Binding();
+    top -= count;
+
+    if (top == 0 && chunk > 0)
+    {
+        chunk--;
+        top = tops.back();
+        tops.pop_back();
+    }
+}
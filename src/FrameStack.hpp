@@ -0,0 +1,89 @@
+#ifndef SURPHER_FRAME_STACK_HPP
+#define SURPHER_FRAME_STACK_HPP
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "Value.hpp"
+
+// a local slot: whether it is fixed, and its value
+using Binding = std::pair<bool, Value>;
+
+// The interpreter's call stack. Frames that no closure can capture take their slots from here and give them back
+// in LIFO order. Chunks never move, so a window stays valid for as long as its frame is live.
+class FrameStack
+{
+    static constexpr size_t chunk_size = 1 << 16;
+
+    std::vector<std::unique_ptr<Binding[]>> chunks;
+    // how far each chunk below the current one was filled when the stack moved on
+    std::vector<size_t> tops;
+    size_t chunk = 0;
+    size_t top = 0;
+
+public:
+    // nullptr for an empty window or one that doesn't fit in a chunk; the frame then keeps its own slots
+    Binding *push(uint32_t count);
+
+    void pop(Binding *window, uint32_t count);
+};
+
+// Recycles the storage of frame environments, so entering a scope doesn't go to the system allocator once the
+// stack has been that deep before.
+template <typename T>
+struct FrameAllocator
+{
+    using value_type = T;
+
+    FrameAllocator() = default;
+
+    template <typename U>
+    FrameAllocator(const FrameAllocator<U> &)
+    {
+    }
+
+    T *allocate(size_t n)
+    {
+        auto &free_list(freeList());
+        if (n != 1 || free_list.empty())
+            return static_cast<T *>(::operator new(n * sizeof(T)));
+
+        T *storage(free_list.back());
+        free_list.pop_back();
+        return storage;
+    }
+
+    void deallocate(T *storage, size_t n)
+    {
+        if (n != 1)
+        {
+            ::operator delete(storage);
+            return;
+        }
+        freeList().push_back(storage);
+    }
+
+private:
+    static std::vector<T *> &freeList()
+    {
+        // never destroyed: environments held by globals may be released after it during exit
+        static auto *free_list(new std::vector<T *>());
+        return *free_list;
+    }
+};
+
+template <typename T, typename U>
+bool operator==(const FrameAllocator<T> &, const FrameAllocator<U> &)
+{
+    return true;
+}
+
+template <typename T, typename U>
+bool operator!=(const FrameAllocator<T> &, const FrameAllocator<U> &)
+{
+    return false;
+}
+
+#endif // SURPHER_FRAME_STACK_HPP
@@ -0,0 +1,281 @@
+#include "Inliner.hpp"
+
+namespace
+{
+    // rejects bodies that can't be moved into another frame: closures and the receiver belong to the callee
+    class InlineCheck : public OptimizationPass
+    {
+        const Function *function;
+
+    public:
+        bool is_inlinable = true;
+
+        explicit InlineCheck(const Function *function) : function(function)
+        {
+        }
+
+        Value visitLambdaExpr(const std::shared_ptr<Lambda> &expr) override
+        {
+            is_inlinable = false;
+            return {};
+        }
+
+        Value visitThisExpr(const std::shared_ptr<This> &expr) override
+        {
+            is_inlinable = false;
+            return {};
+        }
+
+        Value visitSuperExpr(const std::shared_ptr<Super> &expr) override
+        {
+            is_inlinable = false;
+            return {};
+        }
+
+        Value visitVariableExpr(const std::shared_ptr<Variable> &expr) override
+        {
+            if (expr->function_declaration.get() == function)
+                is_inlinable = false;
+            return {};
+        }
+
+        bool check(const std::shared_ptr<Expr> &expr)
+        {
+            visit(expr);
+            return is_inlinable;
+        }
+    };
+
+    // a deep copy of an inlined body, with the callee's slots moved up by `base` into the caller's frame
+    class BodyCopy : public OptimizationPass
+    {
+        const uint32_t base;
+
+        Resolution relocate(const Resolution &resolution) const
+        {
+            return resolution.depth == 0 ? Resolution{0, resolution.slot + base} : resolution;
+        }
+
+        std::vector<std::shared_ptr<Expr>> copy(const std::vector<std::shared_ptr<Expr>> &exprs)
+        {
+            std::vector<std::shared_ptr<Expr>> copies;
+            copies.reserve(exprs.size());
+            for (const auto &expr : exprs)
+                copies.push_back(copy(expr));
+            return copies;
+        }
+
+    public:
+        explicit BodyCopy(uint32_t base) : base(base)
+        {
+        }
+
+        std::shared_ptr<Expr> copy(const std::shared_ptr<Expr> &expr)
+        {
+            auto copied(expr);
+            rewrite(copied);
+            return copied;
+        }
+
+        Value visitBinaryExpr(const std::shared_ptr<Binary> &expr) override
+        {
+            replacement = std::make_shared<Binary>(copy(expr->left), expr->op, copy(expr->right));
+            return {};
+        }
+
+        Value visitLogicalExpr(const std::shared_ptr<Logical> &expr) override
+        {
+            replacement = std::make_shared<Logical>(copy(expr->left), expr->op, copy(expr->right));
+            return {};
+        }
+
+        Value visitGroupExpr(const std::shared_ptr<Group> &expr) override
+        {
+            replacement = std::make_shared<Group>(copy(expr->expr_in));
+            return {};
+        }
+
+        Value visitUnaryExpr(const std::shared_ptr<Unary> &expr) override
+        {
+            replacement = std::make_shared<Unary>(expr->op, copy(expr->right));
+            return {};
+        }
+
+        Value visitAssignExpr(const std::shared_ptr<Assign> &expr) override
+        {
+            auto assign(std::make_shared<Assign>(expr->name, copy(expr->value)));
+            assign->resolution = relocate(expr->resolution);
+            replacement = assign;
+            return {};
+        }
+
+        Value visitVariableExpr(const std::shared_ptr<Variable> &expr) override
+        {
+            auto variable(std::make_shared<Variable>(expr->name, expr->is_fixed));
+            variable->resolution = relocate(expr->resolution);
+            variable->fixed_declaration = expr->fixed_declaration;
+            variable->fixed_index = expr->fixed_index;
+            variable->function_declaration = expr->function_declaration;
+            replacement = variable;
+            return {};
+        }
+
+        Value visitCallExpr(const std::shared_ptr<Call> &expr) override
+        {
+            auto call(std::make_shared<Call>(copy(expr->callee), expr->paren, copy(expr->arguments)));
+            if (expr->invoke)
+                call->invoke = std::dynamic_pointer_cast<Get>(call->callee);
+            replacement = call;
+            return {};
+        }
+
+        Value visitTernaryExpr(const std::shared_ptr<Ternary> &expr) override
+        {
+            replacement = std::make_shared<Ternary>(copy(expr->condition), expr->question, copy(expr->true_branch),
+                                                    expr->colon, copy(expr->else_branch));
+            return {};
+        }
+
+        Value visitGetExpr(const std::shared_ptr<Get> &expr) override
+        {
+            auto get(std::make_shared<Get>(copy(expr->object), expr->name));
+            get->bound_member = expr->bound_member;
+            replacement = get;
+            return {};
+        }
+
+        Value visitSetExpr(const std::shared_ptr<Set> &expr) override
+        {
+            replacement = std::make_shared<Set>(copy(expr->object), expr->name, copy(expr->value));
+            return {};
+        }
+
+        Value visitArrayExpr(const std::shared_ptr<Array> &expr) override
+        {
+            auto array(std::make_shared<Array>(expr->op, copy(expr->expr_vector), copy(expr->dynamic_size)));
+            array->setArraySize(expr->size);
+            replacement = array;
+            return {};
+        }
+
+        Value visitAccessExpr(const std::shared_ptr<Access> &expr) override
+        {
+            replacement = std::make_shared<Access>(copy(expr->index), copy(expr->arr_name), expr->op);
+            return {};
+        }
+
+        Value visitArraySetExpr(const std::shared_ptr<ArraySet> &expr) override
+        {
+            replacement = std::make_shared<ArraySet>(copy(expr->assignee), copy(expr->value), expr->op);
+            return {};
+        }
+
+        Value visitCommaExpr(const std::shared_ptr<Comma> &expr) override
+        {
+            replacement = std::make_shared<Comma>(copy(expr->expressions));
+            return {};
+        }
+    };
+}
+
+Inliner::Inliner(size_t budget) : budget(budget)
+{
+}
+
+std::shared_ptr<Function> Inliner::target(const std::shared_ptr<Call> &call)
+{
+    auto callee(std::dynamic_pointer_cast<Variable>(call->callee));
+    if (!callee)
+        return nullptr;
+
+    if (callee->function_declaration)
+        return callee->function_declaration->is_rebound ? nullptr : callee->function_declaration;
+
+    if (callee->fixed_declaration)
+    {
+        const auto &initializer(std::get<2>(callee->fixed_declaration->var_inits[callee->fixed_index]));
+        if (auto lambda = std::dynamic_pointer_cast<Lambda>(initializer))
+            return lambda->function;
+    }
+    return nullptr;
+}
+
+std::shared_ptr<Expr> Inliner::inlinableBody(const std::shared_ptr<Function> &function)
+{
+    // methods take their receiver in slot 0 and closures read their captures from their own frame
+    if (function->is_sig || function->param_slot != 0 || !function->captures.empty() ||
+        !function->boxed_slots.empty() || function->body.size() != 1)
+        return nullptr;
+
+    auto return_stmt(std::dynamic_pointer_cast<Return>(function->body.front()));
+    if (!return_stmt || !return_stmt->value || countNodes(return_stmt->value) > MAX_BODY_SIZE)
+        return nullptr;
+
+    return InlineCheck(function.get()).check(return_stmt->value) ? return_stmt->value : nullptr;
+}
+
+Value Inliner::visitBlockStmt(const std::shared_ptr<Block> &stmt)
+{
+    if (!stmt->is_scoped)
+        return OptimizationPass::visitBlockStmt(stmt);
+
+    frames.push_back(&stmt->slot_count);
+    OptimizationPass::visitBlockStmt(stmt);
+    frames.pop_back();
+    return {};
+}
+
+Value Inliner::visitFunctionStmt(const std::shared_ptr<Function> &stmt)
+{
+    frames.push_back(&stmt->slot_count);
+    OptimizationPass::visitFunctionStmt(stmt);
+    frames.pop_back();
+    return {};
+}
+
+Value Inliner::visitNamespaceStmt(const std::shared_ptr<Namespace> &stmt)
+{
+    // a namespace's frame becomes its members
+    frames.push_back(nullptr);
+    OptimizationPass::visitNamespaceStmt(stmt);
+    frames.pop_back();
+    return {};
+}
+
+Value Inliner::visitCallExpr(const std::shared_ptr<Call> &expr)
+{
+    OptimizationPass::visitCallExpr(expr);
+
+    // code outside any function or block runs in the globals, which have no slots to spare
+    if (frames.empty() || !frames.back())
+        return {};
+
+    auto function(target(expr));
+    if (!function || function->params.size() != expr->arguments.size())
+        return {};
+
+    auto body(inlinableBody(function));
+    if (!body)
+        return {};
+
+    size_t growth(countNodes(body) + expr->arguments.size());
+    if (growth > budget)
+        return {};
+    budget -= growth;
+
+    uint32_t &slot_count(*frames.back());
+    uint32_t base(slot_count);
+    slot_count += function->slot_count;
+
+    std::vector<std::shared_ptr<Expr>> expressions;
+    for (size_t i = 0; i < function->params.size(); i++)
+    {
+        auto argument(std::make_shared<Assign>(function->params[i], expr->arguments[i]));
+        argument->resolution = {0, base + function->param_slot + static_cast<uint32_t>(i)};
+        expressions.push_back(std::move(argument));
+    }
+    expressions.push_back(BodyCopy(base).copy(body));
+
+    replacement = expressions.size() == 1 ? expressions.back() : std::make_shared<Comma>(std::move(expressions));
+    return {};
+}
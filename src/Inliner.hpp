@@ -0,0 +1,38 @@
+#ifndef SURPHER_INLINER_HPP
+#define SURPHER_INLINER_HPP
+
+#include <vector>
+
+#include "OptimizationPass.hpp"
+
+// Replaces calls to small functions whose target is known (a fixed function, a local function that is never
+// assigned to, or a fixed var holding a lambda) with a copy of the function's body. The callee's frame is spliced
+// into the caller's innermost frame: its slots are renumbered past the caller's own, the arguments are assigned to
+// the renumbered parameters, and the copied body reads them from there. Only bodies that are a single return of an
+// expression without closures are copied, and only while the nodes they add stay within the growth budget.
+class Inliner : public OptimizationPass
+{
+    // the slot count of each enclosing frame, innermost last; null where calls have no frame to spill into
+    std::vector<uint32_t *> frames;
+    size_t budget;
+
+    static std::shared_ptr<Function> target(const std::shared_ptr<Call> &call);
+
+    static std::shared_ptr<Expr> inlinableBody(const std::shared_ptr<Function> &function);
+
+public:
+    // a body bigger than this is never copied, however much budget is left
+    static constexpr size_t MAX_BODY_SIZE = 24;
+
+    explicit Inliner(size_t budget);
+
+    Value visitBlockStmt(const std::shared_ptr<Block> &stmt) override;
+
+    Value visitFunctionStmt(const std::shared_ptr<Function> &stmt) override;
+
+    Value visitNamespaceStmt(const std::shared_ptr<Namespace> &stmt) override;
+
+    Value visitCallExpr(const std::shared_ptr<Call> &expr) override;
+};
+
+#endif // SURPHER_INLINER_HPP
@@ -3,7 +3,6 @@
 #include <numeric>
 #include <functional>
 #include <utility>
-#include <execution>
 #include <sstream>
 
 #include "Interpreter.hpp"
@@ -11,26 +10,28 @@
 #include "SurpherInstance.hpp"
 #include "SurpherCallable.hpp"
 #include "SurpherNamespace.hpp"
+#include "ClosureCompiler.hpp"
+#include "NativeLoop.hpp"
 
-std::any Interpreter::visitLiteralExpr(const std::shared_ptr<Literal> &expr)
+Value Interpreter::visitLiteralExpr(const std::shared_ptr<Literal> &expr)
 {
     return expr->value;
 }
 
-std::any Interpreter::visitGroupExpr(const std::shared_ptr<Group> &expr)
+Value Interpreter::visitGroupExpr(const std::shared_ptr<Group> &expr)
 {
     return evaluate(expr->expr_in);
 }
 
-std::any Interpreter::visitUnaryExpr(const std::shared_ptr<Unary> &expr)
+Value Interpreter::visitUnaryExpr(const std::shared_ptr<Unary> &expr)
 {
-    std::any right(evaluate(expr->right));
+    Value right(evaluate(expr->right));
 
     switch (expr->op.token_type)
     {
     case MINUS:
-        checkNumberOperands(expr->op, {right});
-        return -std::any_cast<const long double &>(right);
+        checkNumberOperands(expr->op, right);
+        return -right.asNumber();
     case BANG:
         return !isTruthy(right);
     default:
@@ -38,84 +39,221 @@ std::any Interpreter::visitUnaryExpr(const std::shared_ptr<Unary> &expr)
     }
 }
 
-std::any Interpreter::visitBinaryExpr(const std::shared_ptr<Binary> &expr)
+Value Interpreter::visitBinaryExpr(const std::shared_ptr<Binary> &expr)
 {
-    std::any left(evaluate(expr->left)), right(evaluate(expr->right));
+    using Specialisation = Binary::Specialisation;
 
-    switch (expr->op.token_type)
+    Value left(evaluateOperand(expr->left, expr->left_operand)),
+          right(evaluateOperand(expr->right, expr->right_operand));
+    bool numbers(left.isNumber() && right.isNumber());
+
+    switch (expr->specialisation)
     {
+    case Specialisation::NUMBER_ADD:
+        if (numbers)
+            return left.asNumber() + right.asNumber();
+        break;
+    case Specialisation::STRING_CONCAT:
+        if (left.isString() && right.isString())
+            return left.asString() + right.asString();
+        break;
+    case Specialisation::NUMBER_SUBTRACT:
+        if (numbers)
+            return left.asNumber() - right.asNumber();
+        break;
+    case Specialisation::NUMBER_MULTIPLY:
+        if (numbers)
+            return left.asNumber() * right.asNumber();
+        break;
+    case Specialisation::NUMBER_LESS:
+        if (numbers)
+            return left.asNumber() < right.asNumber();
+        break;
+    case Specialisation::NUMBER_LESS_EQUAL:
+        if (numbers)
+            return left.asNumber() <= right.asNumber();
+        break;
+    case Specialisation::NUMBER_GREATER:
+        if (numbers)
+            return left.asNumber() > right.asNumber();
+        break;
+    case Specialisation::NUMBER_GREATER_EQUAL:
+        if (numbers)
+            return left.asNumber() >= right.asNumber();
+        break;
+    case Specialisation::NUMBER_EQUAL:
+        if (numbers)
+            return left.asNumber() == right.asNumber();
+        break;
+    case Specialisation::NUMBER_NOT_EQUAL:
+        if (numbers)
+            return left.asNumber() != right.asNumber();
+        break;
+    case Specialisation::UNSPECIALISED:
+        specialise(*expr, left, right);
+        return applyBinary(*expr, left, right);
+    case Specialisation::GENERIC:
+        return applyBinary(*expr, left, right);
+    }
+
+    // the guard failed: the operands aren't what the node was specialised for, and may never be again
+    expr->specialisation = Specialisation::GENERIC;
+    return applyBinary(*expr, left, right);
+}
+
+void Interpreter::specialise(Binary &expr, const Value &left, const Value &right)
+{
+    using Specialisation = Binary::Specialisation;
+
+    auto operandOf = [](const std::shared_ptr<Expr> &operand) {
+        if (auto variable = dynamic_cast<const Variable *>(operand.get()); variable && variable->resolution.depth >= 0)
+            return Binary::Operand::LOCAL;
+        if (dynamic_cast<const Literal *>(operand.get()))
+            return Binary::Operand::LITERAL;
+        return Binary::Operand::EXPRESSION;
+    };
+    expr.left_operand = operandOf(expr.left);
+    expr.right_operand = operandOf(expr.right);
+
+    if (left.isString() && right.isString() && expr.op.token_type == PLUS)
+    {
+        expr.specialisation = Specialisation::STRING_CONCAT;
+        return;
+    }
+    if (!left.isNumber() || !right.isNumber())
+    {
+        expr.specialisation = Specialisation::GENERIC;
+        return;
+    }
+
+    switch (expr.op.token_type)
+    {
+    case PLUS:
+        expr.specialisation = Specialisation::NUMBER_ADD;
+        break;
     case MINUS:
-        checkNumberOperands(expr->op, {left, right});
-        return std::any_cast<const long double &>(left) -
-               std::any_cast<const long double &>(right);
+        expr.specialisation = Specialisation::NUMBER_SUBTRACT;
+        break;
+    case STAR:
+        expr.specialisation = Specialisation::NUMBER_MULTIPLY;
+        break;
+    case LESS:
+        expr.specialisation = Specialisation::NUMBER_LESS;
+        break;
+    case LESS_EQUAL:
+        expr.specialisation = Specialisation::NUMBER_LESS_EQUAL;
+        break;
+    case GREATER:
+        expr.specialisation = Specialisation::NUMBER_GREATER;
+        break;
+    case GREATER_EQUAL:
+        expr.specialisation = Specialisation::NUMBER_GREATER_EQUAL;
+        break;
+    case DOUBLE_EQUAL:
+        expr.specialisation = Specialisation::NUMBER_EQUAL;
+        break;
+    case BANG_EQUAL:
+        expr.specialisation = Specialisation::NUMBER_NOT_EQUAL;
+        break;
+    default:
+        // division and the integer operators check their operands beyond their type
+        expr.specialisation = Specialisation::GENERIC;
+        break;
+    }
+}
+
+Value Interpreter::evaluateOperand(const std::shared_ptr<Expr> &expr, Binary::Operand operand)
+{
+    switch (operand)
+    {
+    case Binary::Operand::LOCAL:
+    {
+        const auto &resolution(static_cast<const Variable &>(*expr).resolution);
+        return environment->getAt(resolution.depth, resolution.slot);
+    }
+    case Binary::Operand::LITERAL:
+        return static_cast<const Literal &>(*expr).value;
+    default:
+        return evaluate(expr);
+    }
+}
+
+Value Interpreter::applyBinary(const Binary &expr, const Value &left, const Value &right)
+{
+    switch (expr.op.token_type)
+    {
+    case MINUS:
+        checkNumberOperands(expr.op, left, right);
+        return left.asNumber() -
+               right.asNumber();
     case SLASH:
-        checkNumberOperands(expr->op, {left, right});
-        if (std::any_cast<long double>(right) == 0)
-            throw RuntimeError(expr->op, "Denominator cannot be 0.");
-        return std::any_cast<const long double &>(left) /
-               std::any_cast<const long double &>(right);
+        checkNumberOperands(expr.op, left, right);
+        if (right.asNumber() == 0)
+            throw RuntimeError(expr.op, "Denominator cannot be 0.");
+        return left.asNumber() /
+               right.asNumber();
     case STAR:
-        checkNumberOperands(expr->op, {left, right});
-        return std::any_cast<const long double &>(left) *
-               std::any_cast<const long double &>(right);
+        checkNumberOperands(expr.op, left, right);
+        return left.asNumber() *
+               right.asNumber();
     case PLUS:
     {
-        if (left.type() == typeid(std::string) || right.type() == typeid(std::string))
+        if (left.isString() || right.isString())
         {
             return stringify(left) +
                    stringify(right);
         }
         else
         {
-            checkNumberOperands(expr->op, {left, right});
-            return std::any_cast<const long double &>(left) +
-                   std::any_cast<const long double &>(right);
+            checkNumberOperands(expr.op, left, right);
+            return left.asNumber() +
+                   right.asNumber();
         }
     }
     case LEFT_SHIFT:
-        checkNumberOperands(expr->op, {left, right});
-        return static_cast<long double>(static_cast<int64_t>(std::any_cast<const long double &>(left)) << static_cast<int64_t>(std::any_cast<const long double &>(right)));
+        checkNumberOperands(expr.op, left, right);
+        return static_cast<double>(static_cast<int64_t>(left.asNumber()) << static_cast<int64_t>(right.asNumber()));
     case RIGHT_SHIFT:
-        checkNumberOperands(expr->op, {left, right});
-        return static_cast<long double>(static_cast<int64_t>(std::any_cast<const long double &>(left)) >> static_cast<int64_t>(std::any_cast<const long double &>(right)));
+        checkNumberOperands(expr.op, left, right);
+        return static_cast<double>(static_cast<int64_t>(left.asNumber()) >> static_cast<int64_t>(right.asNumber()));
     case CARET:
-        checkNumberOperands(expr->op, {left, right});
-        return static_cast<long double>(static_cast<int64_t>(std::any_cast<const long double &>(left)) ^ static_cast<int64_t>(std::any_cast<const long double &>(right)));
+        checkNumberOperands(expr.op, left, right);
+        return static_cast<double>(static_cast<int64_t>(left.asNumber()) ^ static_cast<int64_t>(right.asNumber()));
     case PERCENT:
-        checkNumberOperands(expr->op, {left, right});
-        if (std::any_cast<long double>(right) == 0)
-            throw RuntimeError(expr->op, "Denominator cannot be 0.");
-        return std::fmod(std::any_cast<const long double &>(left), std::any_cast<const long double &>(right));
+        checkNumberOperands(expr.op, left, right);
+        if (right.asNumber() == 0)
+            throw RuntimeError(expr.op, "Denominator cannot be 0.");
+        return std::fmod(left.asNumber(), right.asNumber());
     case SINGLE_AMPERSAND:
-        checkNumberOperands(expr->op, {left, right});
-        return static_cast<long double>(static_cast<int64_t>(std::any_cast<const long double &>(left)) &
-                                        static_cast<int64_t>(std::any_cast<const long double &>(right)));
+        checkNumberOperands(expr.op, left, right);
+        return static_cast<double>(static_cast<int64_t>(left.asNumber()) &
+                                        static_cast<int64_t>(right.asNumber()));
     case SINGLE_BAR:
-        checkNumberOperands(expr->op, {left, right});
-        return static_cast<long double>(static_cast<int64_t>(std::any_cast<const long double &>(left)) |
-                                        static_cast<int64_t>(std::any_cast<const long double &>(right)));
+        checkNumberOperands(expr.op, left, right);
+        return static_cast<double>(static_cast<int64_t>(left.asNumber()) |
+                                        static_cast<int64_t>(right.asNumber()));
     case GREATER:
-        checkNumberOperands(expr->op, {left, right});
-        return std::any_cast<const long double &>(left) >
-               std::any_cast<const long double &>(right);
+        checkNumberOperands(expr.op, left, right);
+        return left.asNumber() >
+               right.asNumber();
     case GREATER_EQUAL:
-        checkNumberOperands(expr->op, {left, right});
-        return std::any_cast<const long double &>(left) >=
-               std::any_cast<const long double &>(right);
+        checkNumberOperands(expr.op, left, right);
+        return left.asNumber() >=
+               right.asNumber();
     case LESS:
-        checkNumberOperands(expr->op, {left, right});
-        return std::any_cast<const long double &>(left) <
-               std::any_cast<const long double &>(right);
+        checkNumberOperands(expr.op, left, right);
+        return left.asNumber() <
+               right.asNumber();
     case LESS_EQUAL:
-        checkNumberOperands(expr->op, {left, right});
-        return std::any_cast<const long double &>(left) <=
-               std::any_cast<const long double &>(right);
+        checkNumberOperands(expr.op, left, right);
+        return left.asNumber() <=
+               right.asNumber();
     case BANG_EQUAL:
         return !isEqual(left, right);
     case DOUBLE_EQUAL:
         return isEqual(left, right);
     default:
-        throw std::invalid_argument("Unexpected value: " + expr->op.lexeme);
+        throw std::invalid_argument("Unexpected value: " + expr.op.lexeme);
     }
 }
 
@@ -139,14 +277,6 @@ void Interpreter::interpret()
         {
             runtimeError(e);
         }
-        catch (BreakError &e)
-        {
-            breakError(e);
-        }
-        catch (ContinueError &e)
-        {
-            continueError(e);
-        }
         catch (ImportError &e)
         {
             appendScriptBack(curr_script);
@@ -155,96 +285,143 @@ void Interpreter::interpret()
     }
 }
 
-std::any Interpreter::visitExpressionStmt(const std::shared_ptr<Expression> &stmt)
+Value Interpreter::visitExpressionStmt(const std::shared_ptr<Expression> &stmt)
 {
     evaluate(stmt->expression);
     return {};
 }
 
-std::any Interpreter::visitPrintStmt(const std::shared_ptr<Print> &stmt)
+Value Interpreter::visitPrintStmt(const std::shared_ptr<Print> &stmt)
 {
-    std::any value(evaluate(stmt->expression));
+    Value value(evaluate(stmt->expression));
     std::cout << stringify(value) << std::endl;
     return {};
 }
 
-std::any Interpreter::visitHaltStmt(const std::shared_ptr<Halt> &stmt)
+Value Interpreter::visitHaltStmt(const std::shared_ptr<Halt> &stmt)
 {
-    std::any message_str = evaluate(stmt->message);
-    if (message_str.type() != typeid(std::string))
+    Value message_str = evaluate(stmt->message);
+    if (!message_str.isString())
     {
         throw RuntimeError(stmt->keyword, "Message after \"halt\" should be a string.");
     }
     else
     {
-        throw RuntimeError(stmt->keyword, std::any_cast<const std::string &>(message_str));
+        throw RuntimeError(stmt->keyword, message_str.asString());
     }
 }
 
-std::any Interpreter::visitBlockStmt(const std::shared_ptr<Block> &stmt)
+Value Interpreter::visitCompiledStmt(const std::shared_ptr<Compiled> &stmt)
+{
+    stmt->code->execute(*this);
+    return {};
+}
+
+Value Interpreter::visitBlockStmt(const std::shared_ptr<Block> &stmt)
 {
-    executeBlock(stmt->statements, std::make_shared<Environment>(this->environment));
+    if (!stmt->is_scoped)
+    {
+        for (const auto &s : stmt->statements)
+        {
+            if (execute(s) != Completion::NORMAL)
+                break;
+        }
+        return {};
+    }
+
+    executeBlock(stmt->statements, newFrame(environment, stmt->slot_count, stmt->escapes, stmt->boxed_slots));
     return {};
 }
 
-std::any Interpreter::visitVarStmt(const std::shared_ptr<Var> &stmt)
+Value Interpreter::visitVarStmt(const std::shared_ptr<Var> &stmt)
 {
-    std::for_each(std::execution::seq, stmt->var_inits.begin(), stmt->var_inits.end(), [this](const auto &a)
-                  { environment->define(std::get<0>(a), evaluate(std::get<2>(a)), std::get<1>(a)); });
+    for (size_t i = 0; i < stmt->var_inits.size(); i++)
+    {
+        const auto &var_init(stmt->var_inits[i]);
+        defineVariable(stmt->slots[i], std::get<0>(var_init), evaluate(std::get<2>(var_init)), std::get<1>(var_init));
+    }
 
     return {};
 }
 
-std::any Interpreter::visitVariableExpr(const std::shared_ptr<Variable> &expr)
+Value Interpreter::visitVariableExpr(const std::shared_ptr<Variable> &expr)
 {
-    return lookUpVariable(expr->name, expr);
+    return lookUpVariable(expr->name, expr->resolution);
 }
 
-std::any Interpreter::visitCommaExpr(const std::shared_ptr<Comma> &expr)
+Value Interpreter::visitCommaExpr(const std::shared_ptr<Comma> &expr)
 {
-    std::any ret;
-    std::for_each(std::execution::seq, expr->expressions.begin(), expr->expressions.end() - 1, [this](const auto &a)
-                  { evaluate(a); });
+    for (size_t i = 0; i + 1 < expr->expressions.size(); i++)
+        evaluate(expr->expressions[i]);
 
     return evaluate(expr->expressions.back());
 }
 
-std::any Interpreter::visitAssignExpr(const std::shared_ptr<Assign> &expr)
+Value Interpreter::visitInvariantExpr(const std::shared_ptr<Invariant> &expr)
 {
-    std::any value(evaluate(expr->value));
+    const Value &cached(environment->getAt(expr->resolution.depth, expr->resolution.slot));
+    if (!cached.isNil())
+        return cached;
 
-    auto elem_iter(locals.find(expr));
-    if (elem_iter != locals.end())
+    Value value;
+    if (expr->size_of_argument)
     {
-        environment->assignAt(elem_iter->second, expr->name, value);
+        Value argument(evaluate(expr->size_of_argument));
+        if (argument.isArray())
+            value = static_cast<double>(argument.asPointer<SurpherArray>()->size());
+        else if (argument.isString())
+            value = static_cast<double>(argument.asString().size());
+        else
+            return evaluate(expr->expr);
     }
     else
     {
-        globals->assign(expr->name, value);
+        value = evaluate(expr->expr);
     }
 
+    environment->ancestor(expr->resolution.depth)->defineAt(expr->resolution.slot, value, false);
     return value;
 }
 
-std::any Interpreter::evaluate(const std::shared_ptr<Expr> &expr)
+Value Interpreter::visitAssignExpr(const std::shared_ptr<Assign> &expr)
+{
+    Value value(evaluate(expr->value));
+
+    if (expr->resolution.depth >= 0)
+    {
+        environment->assignAt(expr->resolution.depth, expr->resolution.slot, expr->name, value);
+    }
+    else
+    {
+        globals->assignGlobal(expr->resolution.slot, expr->name, value);
+    }
+
+    return value;
+}
+
+Value Interpreter::evaluate(const std::shared_ptr<Expr> &expr)
 {
     return expr->accept(*this);
 }
 
-void Interpreter::execute(const std::shared_ptr<Stmt> &stmt)
+Interpreter::Completion Interpreter::execute(const std::shared_ptr<Stmt> &stmt)
 {
     stmt->accept(*this);
+    return completion;
 }
 
-void Interpreter::executeBlock(const std::list<std::shared_ptr<Stmt>> &stmts,
-                               const std::shared_ptr<Environment> &curr_environment)
+Interpreter::Completion Interpreter::executeBlock(const std::list<std::shared_ptr<Stmt>> &stmts,
+                                                  const std::shared_ptr<Environment> &curr_environment)
 {
     auto previous_environment(environment);
     try
     {
         environment = curr_environment;
         for (const std::shared_ptr<Stmt> &s : stmts)
-            execute(s);
+        {
+            if (execute(s) != Completion::NORMAL)
+                break;
+        }
     }
     catch (...)
     {
@@ -252,41 +429,48 @@ void Interpreter::executeBlock(const std::list<std::shared_ptr<Stmt>> &stmts,
         throw;
     }
     this->environment = previous_environment;
+    return completion;
 }
 
-bool Interpreter::isTruthy(const std::any &value)
+Value Interpreter::takeReturnValue()
 {
-    if (value.type() == typeid(nullptr))
+    completion = Completion::NORMAL;
+    return std::move(return_value);
+}
+
+bool Interpreter::isTruthy(const Value &value)
+{
+    if (value.isNil())
         return false;
-    if (value.type() == typeid(bool))
-        return std::any_cast<bool>(value);
+    if (value.isBool())
+        return value.asBool();
     return true;
 }
 
-bool Interpreter::isEqual(const std::any &a, const std::any &b)
+bool Interpreter::isEqual(const Value &a, const Value &b)
 {
-    if (a.type() == typeid(nullptr) && b.type() == typeid(nullptr))
+    if (a.isNil() && b.isNil())
         return true;
-    if (a.type() == typeid(nullptr))
+    if (a.isNil())
         return false;
-    if (a.type() == typeid(std::string) && b.type() == typeid(std::string))
-        return std::any_cast<const std::string &>(a) == std::any_cast<const std::string &>(b);
-    if (a.type() == typeid(long double) && b.type() == typeid(long double))
-        return std::any_cast<const long double &>(a) == std::any_cast<const long double &>(b);
-    if (a.type() == typeid(bool) && b.type() == typeid(bool))
-        return std::any_cast<bool>(a) == std::any_cast<bool>(b);
+    if (a.isString() && b.isString())
+        return a.asString() == b.asString();
+    if (a.isNumber() && b.isNumber())
+        return a.asNumber() == b.asNumber();
+    if (a.isBool() && b.isBool())
+        return a.asBool() == b.asBool();
     return false;
 }
 
-std::string Interpreter::stringify(const std::any &value)
+std::string Interpreter::stringify(const Value &value)
 {
-    if (value.type() == typeid(nullptr))
+    switch (value.getType())
     {
+    case ValueType::NIL:
         return "nil";
-    }
-    else if (value.type() == typeid(long double))
+    case ValueType::NUMBER:
     {
-        auto double_val(std::any_cast<const long double &>(value));
+        auto double_val(value.asNumber());
         std::string num_str(std::to_string(double_val));
         if (std::floor(double_val) == double_val)
         {
@@ -299,65 +483,57 @@ std::string Interpreter::stringify(const std::any &value)
         }
         return num_str;
     }
-    else if (value.type() == typeid(std::string))
-    {
-        return std::any_cast<const std::string &>(value);
-    }
-    else if (value.type() == typeid(bool))
+    case ValueType::STRING:
+        return value.asString();
+    case ValueType::BOOL:
+        return value.asBool() ? "true" : "false";
+    case ValueType::CALLABLE:
+        return value.asPointer<SurpherCallable>()->SurpherCallableToString();
+    case ValueType::INSTANCE:
+        return value.asPointer<SurpherInstance>()->SurpherInstanceToString();
+    case ValueType::NAMESPACE:
+        return value.asPointer<SurpherNamespace>()->SurpherNamespaceToString();
+    case ValueType::ARRAY:
     {
-        return std::any_cast<bool>(value) ? "true" : "false";
-    }
-    else if (value.type() == typeid(std::shared_ptr<SurpherCallable>))
-    {
-        return (std::any_cast<std::shared_ptr<SurpherCallable>>(value))->SurpherCallableToString();
-    }
-    else if (value.type() == typeid(std::shared_ptr<SurpherInstance>))
-    {
-        return (std::any_cast<std::shared_ptr<SurpherInstance>>(value))->SurpherInstanceToString();
-    }
-    else if (value.type() == typeid(std::shared_ptr<SurpherNamespace>))
-    {
-        return (std::any_cast<std::shared_ptr<SurpherNamespace>>(value))->SurpherNamespaceToString();
-    }
-    else if (value.type() == typeid(SurpherArrayPtr))
-    {
-        auto expr_vector{std::any_cast<SurpherArrayPtr>(value)};
+        auto expr_vector{value.asPointer<SurpherArray>()};
         if (expr_vector->empty())
         {
             return "[]";
         }
 
-        std::ostringstream str_builder;
-        str_builder << "[";
-        std::for_each(std::execution::seq, expr_vector->begin(), expr_vector->end(), [&str_builder](const auto &a)
-                      { str_builder << stringify(a) << ", "; });
-        std::string expr_vector_str{str_builder.str().begin(), str_builder.str().end() - 2};
-
+        std::string expr_vector_str{"["};
+        for (const auto &element : *expr_vector)
+        {
+            expr_vector_str += stringify(element);
+            expr_vector_str += ", ";
+        }
+        expr_vector_str.resize(expr_vector_str.size() - 2);
         expr_vector_str.push_back(']');
         return expr_vector_str;
     }
+    default:
+        break;
+    }
     std::ostringstream str_builder;
     str_builder << &value;
     return "<unknown type> at: " + str_builder.str();
 }
 
-void Interpreter::checkNumberOperands(const Token &operator_token, const std::vector<std::any> &operands)
+void Interpreter::checkNumberOperands(const Token &operator_token, const Value &operand)
 {
-    bool result{std::transform_reduce(
-        std::execution::par,
-        operands.begin(), operands.end(), true,
-        [](const bool a, const bool b)
-        {
-            return a && b;
-        },
-        [](const std::any &operand)
-        { return operand.type() == typeid(long double); })};
-    if (result)
+    if (operand.isNumber())
+        return;
+    throw RuntimeError{operator_token, "Operand must be a number."};
+}
+
+void Interpreter::checkNumberOperands(const Token &operator_token, const Value &left, const Value &right)
+{
+    if (left.isNumber() && right.isNumber())
         return;
     throw RuntimeError{operator_token, "Operand must be a number."};
 }
 
-std::any Interpreter::visitIfStmt(const std::shared_ptr<If> &stmt)
+Value Interpreter::visitIfStmt(const std::shared_ptr<If> &stmt)
 {
     if (isTruthy(evaluate(stmt->condition)))
     {
@@ -370,21 +546,9 @@ std::any Interpreter::visitIfStmt(const std::shared_ptr<If> &stmt)
     return {};
 }
 
-std::any Interpreter::visitPipeExpr(const std::shared_ptr<Pipe> &expr)
+Value Interpreter::visitLogicalExpr(const std::shared_ptr<Logical> &expr)
 {
-    if (auto right_callable = std::dynamic_pointer_cast<Call>(expr->right))
-    {
-        right_callable->arguments.insert(right_callable->arguments.begin(), expr->left);
-
-        return evaluate(expr->right);
-    }
-
-    throw RuntimeError(expr->op, "Pipe operator can only be applied to a callable instance.");
-}
-
-std::any Interpreter::visitLogicalExpr(const std::shared_ptr<Logical> &expr)
-{
-    std::any left(evaluate(expr->left));
+    Value left(evaluate(expr->left));
 
     if (expr->op.token_type == OR)
     {
@@ -400,97 +564,194 @@ std::any Interpreter::visitLogicalExpr(const std::shared_ptr<Logical> &expr)
     return evaluate(expr->right);
 }
 
-std::any Interpreter::visitWhileStmt(const std::shared_ptr<While> &stmt)
+Value Interpreter::visitWhileStmt(const std::shared_ptr<While> &stmt)
 {
+    if (stmt->native && runNative(*stmt))
+        return {};
+
+    // every iteration redefines the body's locals before reading them, so the slots can simply be overwritten
+    std::shared_ptr<Environment> body_environment;
+    if (stmt->body_scope)
+        body_environment = newFrame(environment, stmt->body_scope->slot_count, false, {});
+    for (uint32_t slot : stmt->invariant_slots)
+        environment->defineAt(slot, Value(), false);
+
     while (isTruthy(evaluate(stmt->condition)))
     {
-        try
+        auto body_completion(body_environment ? executeBlock(stmt->body_scope->statements, body_environment)
+                                              : execute(stmt->body));
+        if (body_completion == Completion::BREAK)
         {
-            execute(stmt->body);
+            completion = Completion::NORMAL;
+            break;
         }
-        catch (BreakError &e)
+        else if (body_completion == Completion::CONTINUE)
         {
-            break;
+            completion = Completion::NORMAL;
         }
-        catch (ContinueError &e)
+        else if (body_completion == Completion::RETURN)
         {
-            continue;
+            break;
         }
+
+        if (stmt->increment)
+            evaluate(stmt->increment);
+
+        if (jit && ++stmt->back_edges == NativeLoop::HOT_THRESHOLD && (stmt->native = NativeLoop::compile(*stmt)) &&
+            runNative(*stmt))
+            return {};
     }
     return {};
 }
 
-std::any Interpreter::visitBreakStmt(const std::shared_ptr<Break> &stmt)
+bool Interpreter::runNative(While &stmt)
 {
-    throw BreakError(stmt->break_tok, "'break' must be used in loop");
+    switch (stmt.native->run(*environment, return_value))
+    {
+    case NativeLoop::Exit::FINISHED:
+        return true;
+    case NativeLoop::Exit::RETURNED:
+        completion = Completion::RETURN;
+        return true;
+    default:
+        return false;
+    }
+}
+
+Value Interpreter::visitBreakStmt(const std::shared_ptr<Break> &stmt)
+{
+    completion = Completion::BREAK;
+    return {};
 }
 
-std::any Interpreter::visitContinueStmt(const std::shared_ptr<Continue> &stmt)
+Value Interpreter::visitContinueStmt(const std::shared_ptr<Continue> &stmt)
 {
-    throw ContinueError(stmt->continue_tok, "'continue' must be used in loop");
+    completion = Completion::CONTINUE;
+    return {};
 }
 
-std::any Interpreter::visitCallExpr(const std::shared_ptr<Call> &expr)
+Value Interpreter::visitCallExpr(const std::shared_ptr<Call> &expr)
 {
-    std::any callee(evaluate(expr->callee));
-    std::vector<std::any> arguments(expr->arguments.size());
-    std::transform(std::execution::par_unseq, expr->arguments.begin(), expr->arguments.end(), arguments.begin(), [this](const auto &a)
-                   { return evaluate(a); });
-    std::shared_ptr<SurpherCallable> callable;
+    Value callee;
+    Ref<SurpherInstance> receiver;
+    SurpherFunction *method = nullptr;
+    if (expr->invoke)
+        callee = getMethod(evaluate(expr->invoke->object), expr->invoke, receiver, method);
+    else
+        callee = evaluate(expr->callee);
+
+    ArgumentWindow window(*this);
+    auto &arguments(window.arguments);
+    for (const auto &argument : expr->arguments)
+        arguments.push_back(evaluate(argument));
 
-    if (callee.type() == typeid(std::shared_ptr<SurpherCallable>))
+    return call(callee, receiver, method, arguments, expr->paren);
+}
+
+Value Interpreter::getMethod(const Value &object, const std::shared_ptr<Get> &invoke, Ref<SurpherInstance> &receiver,
+                             SurpherFunction *&method)
+{
+    if (!object.isInstance())
+        return getProperty(object, invoke);
+
+    receiver = object.as<SurpherInstance>();
+    return receiver->getUnbound(invoke->name, invoke->name_id, invoke->cache, method);
+}
+
+Value Interpreter::call(const Value &callee, const Ref<SurpherInstance> &receiver, SurpherFunction *method,
+                        const std::vector<Value> &arguments, const Token &paren)
+{
+    if (method != nullptr)
     {
-        callable = std::any_cast<std::shared_ptr<SurpherCallable>>(callee);
-        if (auto surpher_fun = std::dynamic_pointer_cast<SurpherFunction>(callable))
-        {
-            if (surpher_fun->is_sig)
-            {
-                throw RuntimeError(surpher_fun->declaration->name, "Cannot invoke a function signature.");
-            }
+        return callFunction(method, receiver, arguments, paren);
+    }
 
-            if (arguments.size() > surpher_fun->arity())
-            {
-                throw RuntimeError(expr->paren,
-                                   "Expected " + std::to_string(surpher_fun->arity()) + " arguments but got " +
-                                       std::to_string(arguments.size()) + ".");
-            }
-            else if (arguments.size() < surpher_fun->arity())
-            {
-                std::shared_ptr<Function> partial_fun(std::make_shared<Function>(
-                    Token("partial-" + surpher_fun->declaration->name.lexeme, surpher_fun->declaration->name.literal,
-                          surpher_fun->declaration->name.token_type, surpher_fun->declaration->name.line),
-                    std::vector<Token>(surpher_fun->declaration->params.begin() + arguments.size(),
-                                       surpher_fun->declaration->params.end()),
-                    surpher_fun->declaration->body, surpher_fun->is_sig, true));
-#pragma omp parallel for
-                {
-                    for (size_t i = 0; i < arguments.size(); i++)
-                    {
-                        surpher_fun->closure->define(surpher_fun->declaration->params[i], arguments[i], true);
-                    }
-                }
-                std::shared_ptr<SurpherCallable> new_fun(std::make_shared<SurpherFunction>(partial_fun, surpher_fun->closure,
-                                                                                           surpher_fun->is_initializer, true));
-                return new_fun;
-            }
-            else
-            {
-                return surpher_fun->call(*this, arguments);
-            }
+    if (callee.isCallable())
+    {
+        Ref<SurpherCallable> callable(callee.as<SurpherCallable>());
+        if (auto surpher_fun = dynamicRefCast<SurpherFunction>(callable))
+        {
+            return callFunction(surpher_fun.get(), surpher_fun->receiver, arguments, paren);
+        }
+        else if (auto partial_fun = dynamicRefCast<PartialFunction>(callable))
+        {
+            std::vector<Value> all_arguments(partial_fun->arguments);
+            all_arguments.insert(all_arguments.end(), arguments.begin(), arguments.end());
+            return callFunction(partial_fun->function.get(), partial_fun->receiver, all_arguments, paren);
         }
-        else if (auto native_fun = std::dynamic_pointer_cast<NativeFunction>(callable))
+        else if (auto native_fun = dynamicRefCast<NativeFunction>(callable))
         {
-            native_fun->paren = expr->paren;
+            native_fun->paren = paren;
         }
         if (arguments.size() != callable->arity())
         {
-            throw RuntimeError(expr->paren, "Expected " + std::to_string(callable->arity()) + " arguments but got " +
-                                                std::to_string(arguments.size()) + ".");
+            throw RuntimeError(paren, "Expected " + std::to_string(callable->arity()) + " arguments but got " +
+                                          std::to_string(arguments.size()) + ".");
         }
 
         return callable->call(*this, arguments);
     }
-    throw RuntimeError(expr->paren, "Not a callable instance.");
+    throw RuntimeError(paren, "Not a callable instance.");
+}
+
+Value Interpreter::callFunction(SurpherFunction *surpher_fun, const Ref<SurpherInstance> &receiver,
+                                const std::vector<Value> &arguments, const Token &paren)
+{
+    if (surpher_fun->is_sig)
+    {
+        throw RuntimeError(surpher_fun->declaration->name, "Cannot invoke a function signature.");
+    }
+
+    if (arguments.size() > surpher_fun->arity())
+    {
+        throw RuntimeError(paren, "Expected " + std::to_string(surpher_fun->arity()) + " arguments but got " +
+                                      std::to_string(arguments.size()) + ".");
+    }
+    else if (arguments.size() < surpher_fun->arity())
+    {
+        Ref<SurpherCallable> partial_fun(
+            makeRef<PartialFunction>(Ref<SurpherFunction>(surpher_fun), receiver, arguments));
+        return partial_fun;
+    }
+
+    return surpher_fun->invoke(*this, receiver, arguments);
+}
+
+Interpreter::ArgumentWindow::ArgumentWindow(Interpreter &interpreter)
+    : interpreter(interpreter),
+      arguments(interpreter.call_depth < interpreter.argument_windows.size()
+                    ? interpreter.argument_windows[interpreter.call_depth]
+                    : interpreter.argument_windows.emplace_back())
+{
+    interpreter.call_depth++;
+}
+
+Interpreter::ArgumentWindow::~ArgumentWindow()
+{
+    arguments.clear();
+    interpreter.call_depth--;
+}
+
+std::shared_ptr<Environment> Interpreter::newFrame(const std::shared_ptr<Environment> &enclosing, uint32_t slot_count,
+                                                   bool escapes, const std::vector<uint32_t> &boxed_slots)
+{
+    std::shared_ptr<Environment> frame(
+        escapes ? std::make_shared<Environment>(enclosing, slot_count)
+                : std::allocate_shared<Environment>(FrameAllocator<Environment>(), enclosing, slot_count, frame_stack));
+    for (uint32_t slot : boxed_slots)
+        frame->boxAt(slot);
+
+    return frame;
+}
+
+Ref<SurpherFunction> Interpreter::makeClosure(const std::shared_ptr<Function> &declaration, bool is_initializer)
+{
+    std::vector<Ref<SurpherBox>> captures;
+    captures.reserve(declaration->captures.size());
+    for (const auto &capture : declaration->captures)
+        captures.push_back(environment->getBoxAt(capture.source.depth, capture.source.slot));
+
+    return makeRef<SurpherFunction>(declaration, std::move(captures), is_initializer);
 }
 
 Interpreter::Interpreter()
@@ -501,88 +762,91 @@ Interpreter::Interpreter()
     environment->define("String", String(), true);
     // environment->define("Concurrency", Concurrency(), true);
     environment->define("Chrono", Chrono(), true);
+    environment->define("Parallel", Parallel(), true);
 }
 
-std::any Interpreter::visitFunctionStmt(const std::shared_ptr<Function> &stmt)
+Value Interpreter::visitFunctionStmt(const std::shared_ptr<Function> &stmt)
 {
-    std::shared_ptr<SurpherCallable> function(std::make_shared<SurpherFunction>(stmt, environment, false, false));
-    environment->define(stmt->name, std::move(function), stmt->is_fixed);
+    Ref<SurpherCallable> function(makeClosure(stmt, false));
+    defineVariable(stmt->slot, stmt->name, std::move(function), stmt->is_fixed);
     return {};
 }
 
-std::any Interpreter::visitReturnStmt(const std::shared_ptr<Return> &stmt)
+Value Interpreter::visitReturnStmt(const std::shared_ptr<Return> &stmt)
 {
-    std::any value;
-    if (stmt->value)
-    {
-        value = evaluate(stmt->value);
-    }
-
-    throw ReturnError(value);
+    return_value = stmt->value ? evaluate(stmt->value) : Value();
+    completion = Completion::RETURN;
+    return {};
 }
 
-std::any Interpreter::visitImportStmt(const std::shared_ptr<Import> &stmt)
+Value Interpreter::visitImportStmt(const std::shared_ptr<Import> &stmt)
 {
-    throw ImportError(std::any_cast<const std::string &>(evaluate(stmt->script)));
+    throw ImportError(evaluate(stmt->script).asString());
 }
 
-std::any Interpreter::visitLambdaExpr(const std::shared_ptr<Lambda> &expr)
+Value Interpreter::visitLambdaExpr(const std::shared_ptr<Lambda> &expr)
 {
-    std::list<std::shared_ptr<Stmt>> lambda_return;
-    lambda_return.emplace_back(std::make_shared<Return>(Token("return", {}, RETURN, expr->name.line), expr->body));
-
-    std::shared_ptr<SurpherCallable> function = std::make_shared<SurpherFunction>(
-        std::make_shared<Function>(expr->name, expr->params, std::move(lambda_return), false, true), environment, false,
-        false);
+    Ref<SurpherCallable> function(makeClosure(expr->function, false));
     return function;
 }
 
-std::any Interpreter::visitTernaryExpr(const std::shared_ptr<Ternary> &expr)
+Value Interpreter::visitTernaryExpr(const std::shared_ptr<Ternary> &expr)
 {
     return isTruthy(evaluate(expr->condition)) ? evaluate(expr->true_branch) : evaluate(expr->else_branch);
 }
 
-void Interpreter::resolve(const std::shared_ptr<Expr> &expr, uint32_t depth)
+void Interpreter::defineVariable(int32_t slot, const Token &name, Value value, bool is_fixed)
+{
+    if (slot >= 0)
+        environment->defineAt(slot, std::move(value), is_fixed);
+    else
+        environment->define(name, std::move(value), is_fixed);
+}
+
+void Interpreter::eraseVariable(int32_t slot, const Token &name)
 {
-    locals[expr] = depth;
+    if (slot >= 0)
+        environment->defineAt(slot, {}, false);
+    else
+        environment->erase(name.lexeme);
 }
 
-std::any Interpreter::lookUpVariable(const Token &name, const std::shared_ptr<Expr> &expr)
+Value Interpreter::lookUpVariable(const Token &name, const Resolution &resolution)
 {
-    auto elem_iter(locals.find(expr));
-    if (elem_iter != locals.end())
+    if (resolution.depth >= 0)
     {
-        return environment->getAt(elem_iter->second, name.lexeme);
+        return environment->getAt(resolution.depth, resolution.slot);
     }
     else
     {
-        return globals->get(name);
+        return globals->getGlobal(resolution.slot, name);
     }
 }
 
-std::any Interpreter::visitNamespaceStmt(const std::shared_ptr<Namespace> &stmt)
+Value Interpreter::visitNamespaceStmt(const std::shared_ptr<Namespace> &stmt)
 {
-    auto new_environment(std::make_shared<Environment>(environment));
+    auto new_environment(newFrame(environment, stmt->slot_count, true, stmt->boxed_slots));
     executeBlock(stmt->statements, new_environment);
-    environment->define(stmt->name, std::make_shared<SurpherNamespace>(stmt->name.lexeme, new_environment), stmt->is_fixed);
+    defineVariable(stmt->slot, stmt->name, makeRef<SurpherNamespace>(stmt->name.lexeme, new_environment, stmt->member_slots),
+                   stmt->is_fixed);
 
     return {};
 }
 
-std::any Interpreter::visitClassStmt(const std::shared_ptr<Class> &stmt)
+Value Interpreter::visitClassStmt(const std::shared_ptr<Class> &stmt)
 {
-    std::any superclass;
-    std::shared_ptr<SurpherClass> superclass_cast;
-    std::unordered_map<std::string, std::shared_ptr<SurpherCallable>> superclass_instance_methods;
-    std::unordered_map<std::string, std::shared_ptr<SurpherCallable>> superclass_class_methods;
+    Value superclass;
+    Ref<SurpherClass> superclass_cast;
+    std::unordered_map<SymbolId, Ref<SurpherCallable>> superclass_instance_methods;
+    std::unordered_map<SymbolId, Ref<SurpherCallable>> superclass_class_methods;
 
     if (stmt->superclass)
     {
         superclass = evaluate(stmt->superclass);
-        if (superclass.type() == typeid(std::shared_ptr<SurpherCallable>))
+        if (superclass.isCallable())
         {
-            auto superclass_callable = std::any_cast<std::shared_ptr<SurpherCallable>>(superclass);
-            if (superclass_cast = std::dynamic_pointer_cast<SurpherClass>(superclass_callable))
+            auto superclass_callable = superclass.as<SurpherCallable>();
+            if (superclass_cast = dynamicRefCast<SurpherClass>(superclass_callable))
             {
                 superclass_class_methods = superclass_cast->class_methods;
                 superclass_instance_methods = superclass_cast->instance_methods;
@@ -598,26 +862,23 @@ std::any Interpreter::visitClassStmt(const std::shared_ptr<Class> &stmt)
         }
     }
 
-    environment->define(stmt->name, {}, false);
+    defineVariable(stmt->slot, stmt->name, {}, false);
 
     if (stmt->superclass)
     {
-        environment = std::make_shared<Environment>(environment);
-        environment->define("super", superclass, true);
+        // boxed because it is only ever read by the methods, through their captures
+        environment = newFrame(environment, 1, true, {0});
+        environment->defineAt(0, superclass, true);
     }
 
-    std::unordered_map<std::string, std::shared_ptr<SurpherCallable>> instance_methods;
-    std::unordered_map<std::string, std::shared_ptr<SurpherCallable>> class_methods;
-    std::for_each(std::execution::par_unseq, stmt->instance_methods.begin(), stmt->instance_methods.end(), [&instance_methods, this](const auto &a)
-                  {
-                std::shared_ptr<SurpherCallable> function(std::make_shared<SurpherFunction>(a, environment, a->name.lexeme == "init", false));
-        instance_methods[a->name.lexeme] = function; });
-    std::for_each(std::execution::par_unseq, stmt->class_methods.begin(), stmt->class_methods.end(), [&class_methods, this](const auto &a)
-                  {
-                std::shared_ptr<SurpherCallable> function(std::make_shared<SurpherFunction>(a, environment, a->name.lexeme == "init", false));
-        class_methods[a->name.lexeme] = function; });
+    std::unordered_map<std::string, Ref<SurpherCallable>> instance_methods;
+    std::unordered_map<std::string, Ref<SurpherCallable>> class_methods;
+    for (const auto &method : stmt->instance_methods)
+        instance_methods[method->name.lexeme] = makeClosure(method, method->name.lexeme == "init");
+    for (const auto &method : stmt->class_methods)
+        class_methods[method->name.lexeme] = makeClosure(method, false);
 
-    std::shared_ptr<SurpherCallable> surpher_class(std::make_shared<SurpherClass>(stmt->name.lexeme, instance_methods, class_methods,
+    Ref<SurpherCallable> surpher_class(makeRef<SurpherClass>(stmt->name.lexeme, instance_methods, class_methods,
                                                                                   superclass_cast));
 
     if (superclass_cast)
@@ -627,95 +888,104 @@ std::any Interpreter::visitClassStmt(const std::shared_ptr<Class> &stmt)
 
     for (const auto &i_callable : superclass_instance_methods)
     {
-        auto i_function = std::static_pointer_cast<SurpherFunction>(i_callable.second);
+        auto i_function = staticRefCast<SurpherFunction>(i_callable.second);
         if (i_function->is_sig &&
-            (instance_methods.find(i_callable.first) == instance_methods.end() || std::dynamic_pointer_cast<SurpherFunction>(instance_methods[i_callable.first])->is_sig))
+            (instance_methods.find(symbolName(i_callable.first)) == instance_methods.end() ||
+             dynamicRefCast<SurpherFunction>(instance_methods[symbolName(i_callable.first)])->is_sig))
         {
-            environment->erase(stmt->name.lexeme);
+            eraseVariable(stmt->slot, stmt->name);
             throw RuntimeError(i_function->declaration->name,
-                               "Derived class \"" + stmt->name.lexeme + "\" must implement virtual method \"" + i_callable.first +
+                               "Derived class \"" + stmt->name.lexeme + "\" must implement virtual method \"" + symbolName(i_callable.first) +
                                    "\" from super class \"" + superclass_cast->name + "\".");
         }
     }
     for (const auto &c_callable : superclass_class_methods)
     {
-        auto c_function = std::static_pointer_cast<SurpherFunction>(c_callable.second);
+        auto c_function = staticRefCast<SurpherFunction>(c_callable.second);
         if (c_function->is_sig &&
-            (class_methods.find(c_callable.first) == class_methods.end() || std::dynamic_pointer_cast<SurpherFunction>(class_methods[c_callable.first])->is_sig))
+            (class_methods.find(symbolName(c_callable.first)) == class_methods.end() ||
+             dynamicRefCast<SurpherFunction>(class_methods[symbolName(c_callable.first)])->is_sig))
         {
-            environment->erase(stmt->name.lexeme);
+            eraseVariable(stmt->slot, stmt->name);
             throw RuntimeError(c_function->declaration->name,
-                               "Derived class \"" + stmt->name.lexeme + "\" must implement virtual method \"" + c_callable.first +
+                               "Derived class \"" + stmt->name.lexeme + "\" must implement virtual method \"" + symbolName(c_callable.first) +
                                    "\" from super class \"" + superclass_cast->name + "\".");
         }
     }
 
-    environment->assign(stmt->name, surpher_class);
-    environment->setFixed(stmt->name, stmt->is_fixed);
+    defineVariable(stmt->slot, stmt->name, surpher_class, stmt->is_fixed);
     return {};
 }
 
-std::any Interpreter::visitGetExpr(const std::shared_ptr<Get> &expr)
+Value Interpreter::visitGetExpr(const std::shared_ptr<Get> &expr)
 {
-    std::any object(evaluate(expr->object));
+    if (!expr->bound_member.isNil())
+        return expr->bound_member;
+
+    return getProperty(evaluate(expr->object), expr);
+}
 
-    if (object.type() == typeid(std::shared_ptr<SurpherInstance>))
+Value Interpreter::getProperty(const Value &object, const std::shared_ptr<Get> &expr)
+{
+    if (object.isInstance())
     {
-        return std::any_cast<std::shared_ptr<SurpherInstance>>(object)->get(expr->name);
+        return object.asPointer<SurpherInstance>()->get(expr->name, expr->name_id, expr->cache);
     }
-    else if (object.type() == typeid(std::shared_ptr<SurpherCallable>))
+    else if (object.isCallable())
     {
-        auto a = std::any_cast<std::shared_ptr<SurpherCallable>>(object);
-        auto b = std::static_pointer_cast<SurpherInstance>(std::static_pointer_cast<SurpherClass>(std::any_cast<std::shared_ptr<SurpherCallable>>(object)))->get(expr->name);
-        return std::static_pointer_cast<SurpherInstance>(std::static_pointer_cast<SurpherClass>(std::any_cast<std::shared_ptr<SurpherCallable>>(object)))->get(expr->name);
+        if (auto surpher_class = dynamicRefCast<SurpherClass>(object.as<SurpherCallable>()))
+            return surpher_class->get(expr->name, expr->name_id);
     }
-    else if (object.type() == typeid(std::shared_ptr<SurpherNamespace>))
+    else if (object.isNamespace())
     {
-        return std::any_cast<std::shared_ptr<SurpherNamespace>>(object)->get(expr->name);
+        return object.as<SurpherNamespace>()->get(expr->name);
     }
     throw RuntimeError(expr->name, "Can only get from a module or a class instance.");
 }
 
-std::any Interpreter::visitSetExpr(const std::shared_ptr<Set> &expr)
+Value Interpreter::visitSetExpr(const std::shared_ptr<Set> &expr)
 {
-    std::any object(evaluate(expr->object));
+    Value object(evaluate(expr->object));
 
-    if (object.type() == typeid(std::shared_ptr<SurpherInstance>))
+    if (object.isInstance())
     {
-        std::any value(evaluate(expr->value));
-        (std::any_cast<std::shared_ptr<SurpherInstance>>(object))->set(expr->name, value);
+        Value value(evaluate(expr->value));
+        object.asPointer<SurpherInstance>()->set(expr->name_id, value, expr->cache);
         return value;
     }
-    else if (object.type() == typeid(std::shared_ptr<SurpherNamespace>))
+    else if (object.isNamespace())
     {
-        std::any value(evaluate(expr->value));
-        (std::any_cast<std::shared_ptr<SurpherNamespace>>(object))->set(expr->name, value);
+        Value value(evaluate(expr->value));
+        (object.as<SurpherNamespace>())->set(expr->name, value);
         return value;
     }
 
     throw RuntimeError(expr->name, "Only instances have fields.");
 }
 
-std::any Interpreter::visitThisExpr(const std::shared_ptr<This> &expr)
+Value Interpreter::visitThisExpr(const std::shared_ptr<This> &expr)
 {
-    return lookUpVariable(expr->keyword, expr);
+    return lookUpVariable(expr->keyword, expr->resolution);
 }
 
-std::any Interpreter::visitSuperExpr(const std::shared_ptr<Super> &expr)
+Value Interpreter::visitSuperExpr(const std::shared_ptr<Super> &expr)
 {
-    uint32_t distance(locals[expr]);
-    auto superclass(std::static_pointer_cast<SurpherClass>(std::any_cast<std::shared_ptr<SurpherCallable>>(environment->getAt(distance, "super"))));
+    auto superclass(environment->getAt(expr->resolution.depth, expr->resolution.slot).as<SurpherClass>());
 
-    auto object(std::any_cast<std::shared_ptr<SurpherInstance>>(environment->getAt(distance - 1, "this")));
+    // class methods have no receiver
+    const auto &this_value(environment->getAt(expr->this_resolution.depth, expr->this_resolution.slot));
+    Ref<SurpherInstance> object;
+    if (this_value.isInstance())
+        object = this_value.as<SurpherInstance>();
 
-    std::shared_ptr<SurpherCallable> method(superclass->findInstanceMethod(expr->method.lexeme));
+    Ref<SurpherCallable> method(superclass->findInstanceMethod(expr->method_id));
     if (!method)
-        method = superclass->findClassMethod(expr->method.lexeme);
+        method = superclass->findClassMethod(expr->method_id);
 
     if (!method)
         throw RuntimeError(expr->method, "Undefined property \"" + expr->method.lexeme + "\".");
 
-    return std::dynamic_pointer_cast<SurpherFunction>(method)->bind(object);
+    return dynamicRefCast<SurpherFunction>(method)->bind(object);
 }
 
 void Interpreter::appendScriptFront(const std::list<std::shared_ptr<Stmt>> &script)
@@ -728,25 +998,25 @@ void Interpreter::appendScriptBack(const std::list<std::shared_ptr<Stmt>> &scrip
     scripts.emplace_back(script);
 }
 
-std::any Interpreter::visitArrayExpr(const std::shared_ptr<Array> &expr)
+Value Interpreter::visitArrayExpr(const std::shared_ptr<Array> &expr)
 {
     if (expr->dynamic_size)
     {
         auto actual_size{evaluate(expr->dynamic_size)};
-        if (actual_size.type() != typeid(long double))
+        if (!actual_size.isNumber())
         {
             throw RuntimeError(expr->op, "Size for array can only be a number.");
         }
-        else if (std::any_cast<const long double &>(actual_size) < 0)
+        else if (actual_size.asNumber() < 0)
         {
             throw RuntimeError(expr->op, "Size for array cannot be a negative number.");
         }
 
-        auto size_cast{static_cast<uint64_t>((std::any_cast<long double>(actual_size)))};
-        return std::make_shared<SurpherArray>(size_cast, nullptr);
+        auto size_cast{static_cast<uint64_t>((actual_size.asNumber()))};
+        return makeRef<SurpherArray>(size_cast, nullptr);
     }
 
-    SurpherArrayPtr result{std::make_shared<SurpherArray>(expr->expr_vector.size())};
+    SurpherArrayPtr result{makeRef<SurpherArray>(expr->expr_vector.size())};
     for (size_t i = 0; i < expr->expr_vector.size(); i++)
     {
         (*result)[i] = evaluate(expr->expr_vector[i]);
@@ -755,55 +1025,75 @@ std::any Interpreter::visitArrayExpr(const std::shared_ptr<Array> &expr)
     return result;
 }
 
-std::any Interpreter::visitAccessExpr(const std::shared_ptr<Access> &expr)
+Value Interpreter::visitAccessExpr(const std::shared_ptr<Access> &expr)
 {
     auto index{evaluate(expr->index)}, arr_name{evaluate(expr->arr_name)};
-    if (arr_name.type() != typeid(SurpherArrayPtr))
+    return getElement(*expr, arr_name, index);
+}
+
+Value Interpreter::getElement(const Access &expr, const Value &arr_name, const Value &index)
+{
+    if (!arr_name.isArray())
+    {
+        throw RuntimeError(expr.op, "Access operator can only be applied to an array.");
+    }
+    else if (!expr.is_bounds_checked)
     {
-        throw RuntimeError(expr->op, "Access operator can only be applied to an array.");
+        return (*arr_name.asPointer<SurpherArray>())[static_cast<uint64_t>(index.asNumber())];
     }
-    else if (index.type() != typeid(long double))
+    else if (!index.isNumber())
     {
-        throw RuntimeError(expr->op, "Index for access operator can only be a positive integer.");
+        throw RuntimeError(expr.op, "Index for access operator can only be a positive integer.");
     }
 
-    auto index_cast{static_cast<uint64_t>((std::any_cast<long double>(index)))};
-    auto arr_name_cast{std::any_cast<SurpherArrayPtr>(arr_name)};
+    auto index_cast{static_cast<uint64_t>((index.asNumber()))};
+    auto arr_name_cast{arr_name.asPointer<SurpherArray>()};
 
     if (arr_name_cast->size() <= index_cast)
     {
-        throw RuntimeError(expr->op, "Index-out-of-bound.");
+        throw RuntimeError(expr.op, "Index-out-of-bound.");
     }
 
     return (*arr_name_cast)[index_cast];
 }
 
-std::any Interpreter::visitArraySetExpr(const std::shared_ptr<ArraySet> &expr)
+Value Interpreter::visitArraySetExpr(const std::shared_ptr<ArraySet> &expr)
 {
     auto value{evaluate(expr->value)};
-    auto assignee{std::static_pointer_cast<Access>(expr->assignee)};
-    auto index{evaluate(assignee->index)}, arr_name{evaluate(assignee->arr_name)};
-    if (arr_name.type() != typeid(SurpherArrayPtr))
+    const auto &assignee(static_cast<const Access &>(*expr->assignee));
+    auto index{evaluate(assignee.index)}, arr_name{evaluate(assignee.arr_name)};
+    setElement(*expr, arr_name, index, value);
+    return value;
+}
+
+void Interpreter::setElement(const ArraySet &expr, const Value &arr_name, const Value &index, const Value &value)
+{
+    const auto &assignee(static_cast<const Access &>(*expr.assignee));
+    if (!arr_name.isArray())
+    {
+        throw RuntimeError(expr.op, "Access operator can only be applied to an array.");
+    }
+    else if (!assignee.is_bounds_checked)
     {
-        throw RuntimeError(expr->op, "Access operator can only be applied to an array.");
+        (*arr_name.asPointer<SurpherArray>())[static_cast<uint64_t>(index.asNumber())] = value;
+        return;
     }
-    else if (index.type() != typeid(long double))
+    else if (!index.isNumber())
     {
-        throw RuntimeError(expr->op, "Index for access operator can only be a number.");
+        throw RuntimeError(expr.op, "Index for access operator can only be a number.");
     }
-    else if (std::any_cast<const long double &>(index) < 0)
+    else if (index.asNumber() < 0)
     {
-        throw RuntimeError(expr->op, "Index cannot be a negative number.");
+        throw RuntimeError(expr.op, "Index cannot be a negative number.");
     }
 
-    auto index_cast{static_cast<uint64_t>((std::any_cast<const long double &>(index)))};
-    auto arr_name_cast{std::any_cast<SurpherArrayPtr>(arr_name)};
+    auto index_cast{static_cast<uint64_t>((index.asNumber()))};
+    auto arr_name_cast{arr_name.asPointer<SurpherArray>()};
 
     if (arr_name_cast->size() <= index_cast)
     {
-        throw RuntimeError(expr->op, "Index-out-of-bound.");
+        throw RuntimeError(expr.op, "Index-out-of-bound.");
     }
 
     (*arr_name_cast)[index_cast] = value;
-    return value;
 }
@@ -2,6 +2,7 @@
 #define SURPHER_INTERPRETER_HPP
 
 #include <list>
+#include <deque>
 #include "Environment.hpp"
 #include "Expr.hpp"
 #include "Stmt.hpp"
@@ -9,108 +10,179 @@
 
 struct SurpherCallable;
 struct SurpherInstance;
-class SurpherFunction;
-
-using SurpherArray = std::vector<std::any>;
-using SurpherArrayPtr = std::shared_ptr<std::vector<std::any>>;
+struct SurpherFunction;
 
 class Interpreter : public ExprVisitor, public StmtVisitor
 {
+    friend class ClosureRuntime;
+
+public:
+    // how the last statement finished; anything but NORMAL unwinds enclosing blocks up to its loop or function
+    enum class Completion
+    {
+        NORMAL = 0,
+        BREAK,
+        CONTINUE,
+        RETURN
+    };
+
+private:
+    // declared first so it outlives every frame that points into it
+    FrameStack frame_stack;
+
 public:
     std::shared_ptr<Environment> globals{std::make_shared<Environment>()};
+    // compile loops to machine code once they get hot
+    bool jit = false;
 
 private:
+    // argument vectors, one per call depth, reused so a call doesn't allocate once the stack has been that deep
+    std::deque<std::vector<Value>> argument_windows;
+    size_t call_depth = 0;
+
+    struct ArgumentWindow
+    {
+        Interpreter &interpreter;
+        std::vector<Value> &arguments;
+
+        explicit ArgumentWindow(Interpreter &interpreter);
+
+        ~ArgumentWindow();
+    };
+
     std::list<std::list<std::shared_ptr<Stmt>>> scripts;
     std::shared_ptr<Environment> environment = globals;
-    std::unordered_map<std::shared_ptr<Expr>, uint32_t> locals;
+    Completion completion = Completion::NORMAL;
+    Value return_value;
+
+    static void checkNumberOperands(const Token &operator_token, const Value &operand);
+
+    static void checkNumberOperands(const Token &operator_token, const Value &left, const Value &right);
+
+    // picks the variant of a binary operator suited to the operand types it was first applied to
+    static void specialise(Binary &expr, const Value &left, const Value &right);
+
+    Value evaluateOperand(const std::shared_ptr<Expr> &expr, Binary::Operand operand);
 
-    bool isTruthy(const std::any &val);
+    static Value applyBinary(const Binary &expr, const Value &left, const Value &right);
 
-    bool isEqual(const std::any &a, const std::any &b);
+    Value evaluate(const std::shared_ptr<Expr> &expr);
 
-    void checkNumberOperands(const Token &operator_token, const std::vector<std::any> &operands);
+    Value lookUpVariable(const Token &name, const Resolution &resolution);
 
-    std::any evaluate(const std::shared_ptr<Expr> &expr);
+    Value getProperty(const Value &object, const std::shared_ptr<Get> &expr);
 
-    std::any lookUpVariable(const Token &name, const std::shared_ptr<Expr> &expr);
+    // the callee of a method call on object; for an instance's own method, sets receiver and method instead of
+    // binding it
+    Value getMethod(const Value &object, const std::shared_ptr<Get> &invoke, Ref<SurpherInstance> &receiver,
+                    SurpherFunction *&method);
 
-    void execute(const std::shared_ptr<Stmt> &stmt);
+    Value call(const Value &callee, const Ref<SurpherInstance> &receiver, SurpherFunction *method,
+               const std::vector<Value> &arguments, const Token &paren);
+
+    static Value getElement(const Access &expr, const Value &arr_name, const Value &index);
+
+    static void setElement(const ArraySet &expr, const Value &arr_name, const Value &index, const Value &value);
+
+    Value callFunction(SurpherFunction *surpher_fun, const Ref<SurpherInstance> &receiver,
+                       const std::vector<Value> &arguments, const Token &paren);
+
+    Ref<SurpherFunction> makeClosure(const std::shared_ptr<Function> &declaration, bool is_initializer);
+
+    void defineVariable(int32_t slot, const Token &name, Value value, bool is_fixed);
+
+    void eraseVariable(int32_t slot, const Token &name);
+
+    Completion execute(const std::shared_ptr<Stmt> &stmt);
+
+    // runs the loop's machine code; false when it deoptimised and the loop has to be interpreted
+    bool runNative(While &stmt);
 
 public:
     Interpreter();
 
-    void
+    Completion
     executeBlock(const std::list<std::shared_ptr<Stmt>> &stmts, const std::shared_ptr<Environment> &curr_environment);
 
-    std::any visitLambdaExpr(const std::shared_ptr<Lambda> &expr) override;
+    Value takeReturnValue();
+
+    std::shared_ptr<Environment> newFrame(const std::shared_ptr<Environment> &enclosing, uint32_t slot_count,
+                                          bool escapes, const std::vector<uint32_t> &boxed_slots);
+
+    Value visitLambdaExpr(const std::shared_ptr<Lambda> &expr) override;
+
+    Value visitBinaryExpr(const std::shared_ptr<Binary> &expr) override;
+
+    Value visitLogicalExpr(const std::shared_ptr<Logical> &expr) override;
+
+    Value visitGroupExpr(const std::shared_ptr<Group> &expr) override;
 
-    std::any visitBinaryExpr(const std::shared_ptr<Binary> &expr) override;
+    Value visitLiteralExpr(const std::shared_ptr<Literal> &expr) override;
 
-    std::any visitLogicalExpr(const std::shared_ptr<Logical> &expr) override;
+    Value visitUnaryExpr(const std::shared_ptr<Unary> &expr) override;
 
-    std::any visitGroupExpr(const std::shared_ptr<Group> &expr) override;
+    Value visitBlockStmt(const std::shared_ptr<Block> &stmt) override;
 
-    std::any visitLiteralExpr(const std::shared_ptr<Literal> &expr) override;
+    Value visitExpressionStmt(const std::shared_ptr<Expression> &stmt) override;
 
-    std::any visitUnaryExpr(const std::shared_ptr<Unary> &expr) override;
+    Value visitPrintStmt(const std::shared_ptr<Print> &stmt) override;
 
-    std::any visitBlockStmt(const std::shared_ptr<Block> &stmt) override;
+    Value visitVarStmt(const std::shared_ptr<Var> &stmt) override;
 
-    std::any visitExpressionStmt(const std::shared_ptr<Expression> &stmt) override;
+    Value visitIfStmt(const std::shared_ptr<If> &stmt) override;
 
-    std::any visitPrintStmt(const std::shared_ptr<Print> &stmt) override;
+    Value visitBreakStmt(const std::shared_ptr<Break> &stmt) override;
 
-    std::any visitVarStmt(const std::shared_ptr<Var> &stmt) override;
+    Value visitFunctionStmt(const std::shared_ptr<Function> &stmt) override;
 
-    std::any visitIfStmt(const std::shared_ptr<If> &stmt) override;
+    Value visitContinueStmt(const std::shared_ptr<Continue> &stmt) override;
 
-    std::any visitBreakStmt(const std::shared_ptr<Break> &stmt) override;
+    Value visitWhileStmt(const std::shared_ptr<While> &stmt) override;
 
-    std::any visitFunctionStmt(const std::shared_ptr<Function> &stmt) override;
+    Value visitAssignExpr(const std::shared_ptr<Assign> &expr) override;
 
-    std::any visitContinueStmt(const std::shared_ptr<Continue> &stmt) override;
+    Value visitVariableExpr(const std::shared_ptr<Variable> &expr) override;
 
-    std::any visitWhileStmt(const std::shared_ptr<While> &stmt) override;
+    Value visitCallExpr(const std::shared_ptr<Call> &expr) override;
 
-    std::any visitAssignExpr(const std::shared_ptr<Assign> &expr) override;
+    Value visitTernaryExpr(const std::shared_ptr<Ternary> &expr) override;
 
-    std::any visitVariableExpr(const std::shared_ptr<Variable> &expr) override;
+    Value visitReturnStmt(const std::shared_ptr<Return> &stmt) override;
 
-    std::any visitCallExpr(const std::shared_ptr<Call> &expr) override;
+    Value visitClassStmt(const std::shared_ptr<Class> &stmt) override;
 
-    std::any visitTernaryExpr(const std::shared_ptr<Ternary> &expr) override;
+    Value visitGetExpr(const std::shared_ptr<Get> &expr) override;
 
-    std::any visitReturnStmt(const std::shared_ptr<Return> &stmt) override;
+    Value visitSetExpr(const std::shared_ptr<Set> &expr) override;
 
-    std::any visitClassStmt(const std::shared_ptr<Class> &stmt) override;
+    Value visitThisExpr(const std::shared_ptr<This> &expr) override;
 
-    std::any visitGetExpr(const std::shared_ptr<Get> &expr) override;
+    Value visitSuperExpr(const std::shared_ptr<Super> &expr) override;
 
-    std::any visitSetExpr(const std::shared_ptr<Set> &expr) override;
+    Value visitArrayExpr(const std::shared_ptr<Array> &expr) override;
 
-    std::any visitThisExpr(const std::shared_ptr<This> &expr) override;
+    Value visitCommaExpr(const std::shared_ptr<Comma> &expr) override;
 
-    std::any visitSuperExpr(const std::shared_ptr<Super> &expr) override;
+    Value visitInvariantExpr(const std::shared_ptr<Invariant> &expr) override;
 
-    std::any visitArrayExpr(const std::shared_ptr<Array> &expr) override;
 
-    std::any visitCommaExpr(const std::shared_ptr<Comma> &expr) override;
+    Value visitAccessExpr(const std::shared_ptr<Access> &expr) override;
 
-    std::any visitPipeExpr(const std::shared_ptr<Pipe> &expr) override;
+    Value visitArraySetExpr(const std::shared_ptr<ArraySet> &expr) override;
 
-    std::any visitAccessExpr(const std::shared_ptr<Access> &expr) override;
+    Value visitImportStmt(const std::shared_ptr<Import> &stmt) override;
 
-    std::any visitArraySetExpr(const std::shared_ptr<ArraySet> &expr) override;
+    Value visitHaltStmt(const std::shared_ptr<Halt> &stmt) override;
 
-    std::any visitImportStmt(const std::shared_ptr<Import> &stmt) override;
+    Value visitCompiledStmt(const std::shared_ptr<Compiled> &stmt) override;
 
-    std::any visitHaltStmt(const std::shared_ptr<Halt> &stmt) override;
+    Value visitNamespaceStmt(const std::shared_ptr<Namespace> &stmt) override;
 
-    std::any visitNamespaceStmt(const std::shared_ptr<Namespace> &stmt) override;
+    static std::string stringify(const Value &val);
 
-    void resolve(const std::shared_ptr<Expr> &expr, uint32_t depth);
+    static bool isTruthy(const Value &val);
 
-    static std::string stringify(const std::any &val);
+    static bool isEqual(const Value &a, const Value &b);
 
     void appendScriptBack(const std::list<std::shared_ptr<Stmt>> &script);
 
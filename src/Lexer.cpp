@@ -51,7 +51,7 @@ bool Lexer::matchNextChar(char expected)
     return true;
 }
 
-inline void Lexer::addToken(TokenType type, const std::any &literal)
+inline void Lexer::addToken(TokenType type, const Value &literal)
 {
     token_list.emplace_back(Token(source_code.substr(start, current - start), literal, type, line));
 }
@@ -114,7 +114,7 @@ void Lexer::matchString()
     anyChar();
 
     TokenType type = STRING;
-    std::any str_literal = str_builder.str();
+    Value str_literal = str_builder.str();
     addToken(type, str_literal);
 }
 
@@ -124,10 +124,10 @@ void Lexer::matchNumber()
         anyChar();
 
     TokenType type = NUMBER;
-    std::any num_literal;
+    Value num_literal;
     try
     {
-        num_literal = std::stold(source_code.substr(start, current - start));
+        num_literal = std::stod(source_code.substr(start, current - start));
     }
     catch (const std::exception &e)
     {
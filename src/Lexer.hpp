@@ -33,7 +33,7 @@ class Lexer
 
     inline void addToken(TokenType type);
 
-    inline void addToken(TokenType type, const std::any &literal);
+    inline void addToken(TokenType type, const Value &literal);
 
     bool matchNextChar(char expected);
 
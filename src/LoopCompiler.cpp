@@ -0,0 +1,323 @@
+#include "LoopCompiler.hpp"
+#include "Interpreter.hpp"
+
+LoopCompiler::LoopCompiler(LoopEmitter &emitter) : emitter(emitter)
+{
+}
+
+LoopCompiler::Label LoopCompiler::newLabel()
+{
+    return label_count++;
+}
+
+uint32_t LoopCompiler::newSlot(bool fixed)
+{
+    is_fixed.push_back(fixed);
+    return slot_count++;
+}
+
+uint32_t LoopCompiler::slotOf(const Resolution &resolution, bool is_assigned)
+{
+    if (resolution.depth < 0)
+    {
+        // globals can be changed by anything; only locals are compiled
+        is_supported = false;
+        return 0;
+    }
+
+    auto depth(static_cast<uint32_t>(resolution.depth));
+    if (depth < scopes.size())
+    {
+        auto &scope(scopes[scopes.size() - 1 - depth]);
+        if (resolution.slot >= scope.size() || scope[resolution.slot] < 0)
+        {
+            is_supported = false;
+            return 0;
+        }
+        auto index(static_cast<uint32_t>(scope[resolution.slot]));
+        if (is_assigned && is_fixed[index])
+            is_supported = false;
+        return index;
+    }
+
+    uint32_t distance(depth - scopes.size());
+    for (auto &local : locals)
+    {
+        if (local.distance == distance && local.slot == resolution.slot)
+        {
+            local.is_assigned |= is_assigned;
+            return local.index;
+        }
+    }
+    locals.push_back({distance, resolution.slot, newSlot(false), is_assigned});
+    return locals.back().index;
+}
+
+// loads a literal or a local straight into a register
+bool LoopCompiler::operand(const std::shared_ptr<Expr> &expr, uint8_t reg)
+{
+    if (auto literal = std::dynamic_pointer_cast<Literal>(expr); literal && literal->value.isNumber())
+    {
+        emitter.loadNumber(reg, literal->value.asNumber());
+        return true;
+    }
+    if (auto variable = std::dynamic_pointer_cast<Variable>(expr))
+    {
+        emitter.loadSlot(reg, slotOf(variable->resolution, false));
+        return true;
+    }
+    if (auto group = std::dynamic_pointer_cast<Group>(expr))
+        return operand(group->expr_in, reg);
+    return false;
+}
+
+void LoopCompiler::operands(const std::shared_ptr<Binary> &expr)
+{
+    if (!operand(expr->left, 0))
+        value(expr->left);
+    if (operand(expr->right, 1))
+        return;
+
+    emitter.push();
+    value(expr->right);
+    emitter.move(1, 0);
+    emitter.pop(0);
+}
+
+// leaves the number in register 0
+void LoopCompiler::value(const std::shared_ptr<Expr> &expr)
+{
+    if (operand(expr, 0))
+        return;
+
+    if (auto invariant = std::dynamic_pointer_cast<Invariant>(expr))
+    {
+        value(invariant->expr);
+    }
+    else if (auto assign = std::dynamic_pointer_cast<Assign>(expr))
+    {
+        value(assign->value);
+        emitter.storeSlot(slotOf(assign->resolution, true));
+    }
+    else if (auto unary = std::dynamic_pointer_cast<Unary>(expr); unary && unary->op.token_type == MINUS)
+    {
+        value(unary->right);
+        emitter.negate();
+    }
+    else if (auto ternary = std::dynamic_pointer_cast<Ternary>(expr))
+    {
+        Label otherwise(newLabel()), done(newLabel());
+        condition(ternary->condition, otherwise, false);
+        value(ternary->true_branch);
+        emitter.jump(done);
+        emitter.bind(otherwise);
+        value(ternary->else_branch);
+        emitter.bind(done);
+    }
+    else if (auto binary = std::dynamic_pointer_cast<Binary>(expr))
+    {
+        switch (binary->op.token_type)
+        {
+        case PLUS:
+        case MINUS:
+        case STAR:
+        case SLASH:
+        case PERCENT:
+            operands(binary);
+            emitter.arithmetic(binary->op.token_type);
+            break;
+        default:
+            is_supported = false;
+            break;
+        }
+    }
+    else
+    {
+        is_supported = false;
+    }
+}
+
+// jumps to target when the condition's truth is jump_if
+void LoopCompiler::condition(const std::shared_ptr<Expr> &expr, Label target, bool jump_if)
+{
+    if (auto group = std::dynamic_pointer_cast<Group>(expr))
+    {
+        condition(group->expr_in, target, jump_if);
+    }
+    else if (auto literal = std::dynamic_pointer_cast<Literal>(expr))
+    {
+        if (Interpreter::isTruthy(literal->value) == jump_if)
+            emitter.jump(target);
+    }
+    else if (auto unary = std::dynamic_pointer_cast<Unary>(expr); unary && unary->op.token_type == BANG)
+    {
+        condition(unary->right, target, !jump_if);
+    }
+    else if (auto logical = std::dynamic_pointer_cast<Logical>(expr))
+    {
+        // the left operand decides `or` when true and `and` when false
+        bool decides(logical->op.token_type == OR);
+        if (jump_if == decides)
+        {
+            condition(logical->left, target, decides);
+            condition(logical->right, target, decides);
+        }
+        else
+        {
+            Label decided(newLabel());
+            condition(logical->left, decided, decides);
+            condition(logical->right, target, jump_if);
+            emitter.bind(decided);
+        }
+    }
+    else if (auto binary = std::dynamic_pointer_cast<Binary>(expr);
+             binary && (binary->op.token_type == GREATER || binary->op.token_type == GREATER_EQUAL ||
+                        binary->op.token_type == LESS || binary->op.token_type == LESS_EQUAL ||
+                        binary->op.token_type == DOUBLE_EQUAL || binary->op.token_type == BANG_EQUAL))
+    {
+        operands(binary);
+        emitter.jumpIfComparison(binary->op.token_type, jump_if, target);
+    }
+    else
+    {
+        // numbers are always true
+        value(expr);
+        if (jump_if)
+            emitter.jump(target);
+    }
+}
+
+void LoopCompiler::effect(const std::shared_ptr<Expr> &expr)
+{
+    if (auto comma = std::dynamic_pointer_cast<Comma>(expr))
+    {
+        for (const auto &expression : comma->expressions)
+            effect(expression);
+    }
+    else
+    {
+        value(expr);
+    }
+}
+
+void LoopCompiler::statements(const std::list<std::shared_ptr<Stmt>> &stmts, uint32_t scope_slot_count,
+                              bool is_scoped)
+{
+    if (is_scoped)
+        scopes.emplace_back(scope_slot_count, -1);
+    for (const auto &stmt : stmts)
+        statement(stmt);
+    if (is_scoped)
+        scopes.pop_back();
+}
+
+void LoopCompiler::statement(const std::shared_ptr<Stmt> &stmt)
+{
+    if (auto expression = std::dynamic_pointer_cast<Expression>(stmt))
+    {
+        effect(expression->expression);
+    }
+    else if (auto var = std::dynamic_pointer_cast<Var>(stmt))
+    {
+        for (size_t i = 0; i < var->var_inits.size() && is_supported; i++)
+        {
+            if (scopes.empty() || var->slots[i] < 0)
+            {
+                is_supported = false;
+                break;
+            }
+            value(std::get<2>(var->var_inits[i]));
+            auto &slot(scopes.back()[var->slots[i]]);
+            if (slot < 0)
+                slot = static_cast<int32_t>(newSlot(std::get<1>(var->var_inits[i])));
+            emitter.storeSlot(slot);
+        }
+    }
+    else if (auto block = std::dynamic_pointer_cast<Block>(stmt))
+    {
+        if (!block->boxed_slots.empty())
+            is_supported = false;
+        statements(block->statements, block->slot_count, block->is_scoped);
+    }
+    else if (auto branch = std::dynamic_pointer_cast<If>(stmt))
+    {
+        Label otherwise(newLabel());
+        condition(branch->condition, otherwise, false);
+        statement(branch->true_branch);
+        if (branch->else_branch)
+        {
+            Label done(newLabel());
+            emitter.jump(done);
+            emitter.bind(otherwise);
+            statement(branch->else_branch);
+            emitter.bind(done);
+        }
+        else
+        {
+            emitter.bind(otherwise);
+        }
+    }
+    else if (auto loop_stmt = std::dynamic_pointer_cast<While>(stmt))
+    {
+        Label done(newLabel());
+        loop(*loop_stmt, done);
+        emitter.bind(done);
+    }
+    else if (std::dynamic_pointer_cast<Break>(stmt))
+    {
+        emitter.jump(loops.back().first);
+    }
+    else if (std::dynamic_pointer_cast<Continue>(stmt))
+    {
+        emitter.jump(loops.back().second);
+    }
+    else if (auto return_stmt = std::dynamic_pointer_cast<Return>(stmt))
+    {
+        if (return_stmt->value)
+        {
+            value(return_stmt->value);
+            emitter.exit(NativeLoop::RETURNED_NUMBER);
+        }
+        else
+        {
+            emitter.exit(NativeLoop::RETURNED_NIL);
+        }
+    }
+    else
+    {
+        is_supported = false;
+    }
+}
+
+void LoopCompiler::loop(const While &stmt, Label done)
+{
+    Label head(newLabel()), next(newLabel());
+    emitter.bind(head);
+    condition(stmt.condition, done, false);
+
+    loops.emplace_back(done, next);
+    if (stmt.body_scope)
+        statements(stmt.body_scope->statements, stmt.body_scope->slot_count, true);
+    else
+        statement(stmt.body);
+    loops.pop_back();
+
+    emitter.bind(next);
+    if (stmt.increment)
+        effect(stmt.increment);
+    emitter.jump(head);
+}
+
+bool LoopCompiler::compile(const While &stmt)
+{
+    Label finished(newLabel());
+    loop(stmt, finished);
+    emitter.bind(finished);
+    emitter.exit(NativeLoop::FINISHED);
+    return is_supported;
+}
+
+uint32_t LoopCompiler::slotCount() const
+{
+    return slot_count;
+}
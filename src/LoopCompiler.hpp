@@ -0,0 +1,98 @@
+#ifndef SURPHER_LOOP_COMPILER_HPP
+#define SURPHER_LOOP_COMPILER_HPP
+
+#include <memory>
+#include <vector>
+
+#include "NativeLoop.hpp"
+
+// What a numeric loop is lowered to, by the JIT as machine code and by surpherc as C++. Numbers are worked on in
+// registers 0 and 1: every result lands in register 0 and a binary operator takes its right operand from register 1.
+// Temporaries are pushed from register 0 and popped in stack order.
+class LoopEmitter
+{
+public:
+    using Label = uint32_t;
+
+    virtual ~LoopEmitter() = default;
+
+    virtual void loadNumber(uint8_t reg, double value) = 0;
+
+    virtual void loadSlot(uint8_t reg, uint32_t index) = 0;
+
+    // from register 0
+    virtual void storeSlot(uint32_t index) = 0;
+
+    virtual void push() = 0;
+
+    virtual void pop(uint8_t reg) = 0;
+
+    virtual void move(uint8_t to, uint8_t from) = 0;
+
+    virtual void negate() = 0;
+
+    // one of + - * / %; division and remainder by zero deoptimise
+    virtual void arithmetic(TokenType op) = 0;
+
+    // compares register 0 to register 1 with one of > >= < <= == != and jumps when the result is jump_if
+    virtual void jumpIfComparison(TokenType op, bool jump_if, Label target) = 0;
+
+    virtual void jump(Label target) = 0;
+
+    virtual void bind(Label label) = 0;
+
+    // leaves the loop; a returned number is in register 0
+    virtual void exit(NativeLoop::Status status) = 0;
+};
+
+// Lowers a while loop that only does arithmetic, comparisons and branches on local numbers, giving up on anything
+// else. The loop's own locals and the ones it uses from outside it are given machine slots.
+class LoopCompiler
+{
+    using Label = LoopEmitter::Label;
+
+    LoopEmitter &emitter;
+    bool is_supported = true;
+    Label label_count = 0;
+    // machine slots of the locals of scopes inside the loop, innermost last; -1 until declared
+    std::vector<std::vector<int32_t>> scopes;
+    std::vector<bool> is_fixed;
+    uint32_t slot_count = 0;
+    // where break and continue go in each enclosing loop
+    std::vector<std::pair<Label, Label>> loops;
+
+    Label newLabel();
+
+    uint32_t newSlot(bool fixed);
+
+    uint32_t slotOf(const Resolution &resolution, bool is_assigned);
+
+    bool operand(const std::shared_ptr<Expr> &expr, uint8_t reg);
+
+    void operands(const std::shared_ptr<Binary> &expr);
+
+    void value(const std::shared_ptr<Expr> &expr);
+
+    void condition(const std::shared_ptr<Expr> &expr, Label target, bool jump_if);
+
+    void effect(const std::shared_ptr<Expr> &expr);
+
+    void statements(const std::list<std::shared_ptr<Stmt>> &stmts, uint32_t scope_slot_count, bool is_scoped);
+
+    void statement(const std::shared_ptr<Stmt> &stmt);
+
+    void loop(const While &stmt, Label done);
+
+public:
+    // the locals from outside the loop, in the order they were first used
+    std::vector<NativeLoop::Local> locals;
+
+    explicit LoopCompiler(LoopEmitter &emitter);
+
+    // false when the loop does something that can't be lowered; what was emitted is then of no use
+    bool compile(const While &stmt);
+
+    uint32_t slotCount() const;
+};
+
+#endif // SURPHER_LOOP_COMPILER_HPP
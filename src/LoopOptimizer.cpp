@@ -0,0 +1,519 @@
+#include <algorithm>
+#include <cmath>
+#include <set>
+
+#include "LoopOptimizer.hpp"
+#include "built_in_utils/Global.hpp"
+
+namespace
+{
+    // a literal integer that is not negative
+    bool isCount(const std::shared_ptr<Expr> &expr)
+    {
+        auto literal(std::dynamic_pointer_cast<Literal>(expr));
+        if (!literal || !literal->value.isNumber())
+            return false;
+
+        double number(literal->value.asNumber());
+        return number >= 0 && std::floor(number) == number;
+    }
+
+    bool isLocal(const std::shared_ptr<Expr> &expr, const Resolution &resolution)
+    {
+        auto variable(std::dynamic_pointer_cast<Variable>(expr));
+        return variable && variable->resolution.depth == resolution.depth &&
+               variable->resolution.slot == resolution.slot;
+    }
+
+    bool isSizeOf(const std::shared_ptr<Call> &call, uint32_t size_of_index)
+    {
+        auto callee(std::dynamic_pointer_cast<Variable>(call->callee));
+        return callee && callee->resolution.depth < 0 && callee->resolution.slot == size_of_index &&
+               call->arguments.size() == 1;
+    }
+
+    // What running part of a loop can change. Locals are kept by their depth from the loop's own frame; a call or a
+    // property set could change any global, boxed local or property, and a call or an array set any array's elements.
+    class LoopEffects : public OptimizationPass
+    {
+        int32_t offset = 0;
+
+    public:
+        std::set<std::pair<int32_t, uint32_t>> assigned;
+        std::set<uint32_t> assigned_globals;
+        bool has_call = false;
+        bool has_set = false;
+        bool has_array_set = false;
+        // the sizeOf the loop condition compares against, which isn't counted in has_call: on an array or a string
+        // it runs no user code, and on anything else its Invariant calls it on every evaluation
+        const Call *bound = nullptr;
+
+        void scan(const std::shared_ptr<Expr> &expr)
+        {
+            visit(expr);
+        }
+
+        void scan(const std::shared_ptr<Stmt> &stmt)
+        {
+            visit(stmt);
+        }
+
+        Value visitBlockStmt(const std::shared_ptr<Block> &stmt) override
+        {
+            offset += stmt->is_scoped;
+            OptimizationPass::visitBlockStmt(stmt);
+            offset -= stmt->is_scoped;
+            return {};
+        }
+
+        Value visitNamespaceStmt(const std::shared_ptr<Namespace> &stmt) override
+        {
+            offset++;
+            OptimizationPass::visitNamespaceStmt(stmt);
+            offset--;
+            return {};
+        }
+
+        // a function's body only runs when it is called, and calls are accounted for anyway
+        Value visitFunctionStmt(const std::shared_ptr<Function> &stmt) override
+        {
+            return {};
+        }
+
+        Value visitImportStmt(const std::shared_ptr<Import> &stmt) override
+        {
+            has_call = true;
+            return {};
+        }
+
+        Value visitAssignExpr(const std::shared_ptr<Assign> &expr) override
+        {
+            OptimizationPass::visitAssignExpr(expr);
+            if (expr->resolution.depth < 0)
+                assigned_globals.insert(expr->resolution.slot);
+            else if (expr->resolution.depth >= offset)
+                assigned.emplace(expr->resolution.depth - offset, expr->resolution.slot);
+            return {};
+        }
+
+        Value visitCallExpr(const std::shared_ptr<Call> &expr) override
+        {
+            if (expr.get() != bound)
+                has_call = true;
+            return OptimizationPass::visitCallExpr(expr);
+        }
+
+        Value visitSetExpr(const std::shared_ptr<Set> &expr) override
+        {
+            has_set = true;
+            return OptimizationPass::visitSetExpr(expr);
+        }
+
+        Value visitArraySetExpr(const std::shared_ptr<ArraySet> &expr) override
+        {
+            has_array_set = true;
+            return OptimizationPass::visitArraySetExpr(expr);
+        }
+    };
+
+    // Decides which expressions of a loop are invariant and wraps them. Runs over the loop's condition, body and
+    // increment but not into nested loops, which have wrapped their own invariants already.
+    class InvariantWrapper : public OptimizationPass
+    {
+        const LoopEffects &effects;
+        const std::vector<LoopOptimizer::Frame> &frames;
+        const uint32_t size_of_index;
+        const std::shared_ptr<While> &loop;
+        int32_t offset = 0;
+
+        bool mayBeBoxed(int32_t depth, uint32_t slot) const
+        {
+            return static_cast<size_t>(depth) >= frames.size() || frames[frames.size() - 1 - depth].mayBeBoxed(slot);
+        }
+
+        // whether expr may evaluate to an array; operators other than + never do
+        bool mayBeArray(const std::shared_ptr<Expr> &expr) const
+        {
+            if (std::dynamic_pointer_cast<Literal>(expr) || std::dynamic_pointer_cast<Unary>(expr) ||
+                std::dynamic_pointer_cast<Binary>(expr))
+                return false;
+            if (auto group = std::dynamic_pointer_cast<Group>(expr))
+                return mayBeArray(group->expr_in);
+            if (auto logical = std::dynamic_pointer_cast<Logical>(expr))
+                return mayBeArray(logical->left) || mayBeArray(logical->right);
+            if (auto ternary = std::dynamic_pointer_cast<Ternary>(expr))
+                return mayBeArray(ternary->true_branch) || mayBeArray(ternary->else_branch);
+            if (auto call = std::dynamic_pointer_cast<Call>(expr))
+                return !isSizeOf(call, size_of_index);
+            return true;
+        }
+
+        bool isInvariant(const std::shared_ptr<Expr> &expr) const
+        {
+            return isInvariant(expr, effects.has_call || effects.bound);
+        }
+
+        // an operand is cached along with its operator, so it can't be a sizeOf that may call __sizeOf__
+        bool isInvariantOperand(const std::shared_ptr<Expr> &expr, bool has_call) const
+        {
+            return !std::dynamic_pointer_cast<Call>(expr) && isInvariant(expr, has_call);
+        }
+
+        // whether expr can't change while the loop runs, where has_call is whether the loop may run user code
+        bool isInvariant(const std::shared_ptr<Expr> &expr, bool has_call) const
+        {
+            if (std::dynamic_pointer_cast<Literal>(expr) || std::dynamic_pointer_cast<This>(expr))
+                return true;
+
+            if (auto variable = std::dynamic_pointer_cast<Variable>(expr))
+            {
+                const auto &resolution(variable->resolution);
+                if (resolution.depth < 0)
+                    return !has_call && !effects.assigned_globals.count(resolution.slot);
+
+                // locals declared inside the loop are new every iteration
+                int32_t depth(resolution.depth - offset);
+                return depth >= 0 && !effects.assigned.count({depth, resolution.slot}) &&
+                       !(has_call && mayBeBoxed(depth, resolution.slot));
+            }
+            if (auto group = std::dynamic_pointer_cast<Group>(expr))
+                return isInvariantOperand(group->expr_in, has_call);
+            if (auto unary = std::dynamic_pointer_cast<Unary>(expr))
+                return isInvariantOperand(unary->right, has_call);
+            if (auto binary = std::dynamic_pointer_cast<Binary>(expr))
+            {
+                // + on a string prints an array operand, reading elements the loop may change
+                if (binary->op.token_type == PLUS && (has_call || effects.has_array_set) &&
+                    (mayBeArray(binary->left) || mayBeArray(binary->right)))
+                    return false;
+                return isInvariantOperand(binary->left, has_call) && isInvariantOperand(binary->right, has_call);
+            }
+            if (auto logical = std::dynamic_pointer_cast<Logical>(expr))
+                return isInvariantOperand(logical->left, has_call) && isInvariantOperand(logical->right, has_call);
+            if (auto ternary = std::dynamic_pointer_cast<Ternary>(expr))
+                return isInvariantOperand(ternary->condition, has_call) &&
+                       isInvariantOperand(ternary->true_branch, has_call) &&
+                       isInvariantOperand(ternary->else_branch, has_call);
+            if (auto get = std::dynamic_pointer_cast<Get>(expr))
+                return !get->bound_member.isNil() ||
+                       (!has_call && !effects.has_set && isInvariant(get->object, has_call));
+            if (auto call = std::dynamic_pointer_cast<Call>(expr))
+            {
+                if (call.get() == effects.bound)
+                    return isInvariant(call->arguments.front(), effects.has_call);
+                return isSizeOf(call, size_of_index) && isInvariant(call->arguments.front(), has_call);
+            }
+            return false;
+        }
+
+        // replaces an expression worth caching with an Invariant when it is one
+        bool wrap(const std::shared_ptr<Expr> &expr)
+        {
+            if (!isInvariant(expr))
+                return false;
+
+            auto invariant(std::make_shared<Invariant>(expr, Resolution{offset, (*frames.back().slot_count)++}));
+            if (auto call = std::dynamic_pointer_cast<Call>(expr))
+                invariant->size_of_argument = call->arguments.front();
+            loop->invariant_slots.push_back(invariant->resolution.slot);
+            replacement = invariant;
+            return true;
+        }
+
+    public:
+        InvariantWrapper(const LoopEffects &effects, const std::vector<LoopOptimizer::Frame> &frames,
+                         uint32_t size_of_index, const std::shared_ptr<While> &loop)
+            : effects(effects), frames(frames), size_of_index(size_of_index), loop(loop)
+        {
+        }
+
+        void wrap()
+        {
+            rewrite(loop->condition);
+            rewrite(loop->body);
+            rewrite(loop->increment);
+        }
+
+        Value visitBlockStmt(const std::shared_ptr<Block> &stmt) override
+        {
+            offset += stmt->is_scoped;
+            OptimizationPass::visitBlockStmt(stmt);
+            offset -= stmt->is_scoped;
+            return {};
+        }
+
+        Value visitNamespaceStmt(const std::shared_ptr<Namespace> &stmt) override
+        {
+            return {};
+        }
+
+        Value visitFunctionStmt(const std::shared_ptr<Function> &stmt) override
+        {
+            return {};
+        }
+
+        Value visitWhileStmt(const std::shared_ptr<While> &stmt) override
+        {
+            return {};
+        }
+
+        Value visitLambdaExpr(const std::shared_ptr<Lambda> &expr) override
+        {
+            return {};
+        }
+
+        Value visitBinaryExpr(const std::shared_ptr<Binary> &expr) override
+        {
+            return wrap(expr) ? Value() : OptimizationPass::visitBinaryExpr(expr);
+        }
+
+        Value visitLogicalExpr(const std::shared_ptr<Logical> &expr) override
+        {
+            return wrap(expr) ? Value() : OptimizationPass::visitLogicalExpr(expr);
+        }
+
+        Value visitUnaryExpr(const std::shared_ptr<Unary> &expr) override
+        {
+            return wrap(expr) ? Value() : OptimizationPass::visitUnaryExpr(expr);
+        }
+
+        Value visitTernaryExpr(const std::shared_ptr<Ternary> &expr) override
+        {
+            return wrap(expr) ? Value() : OptimizationPass::visitTernaryExpr(expr);
+        }
+
+        Value visitGetExpr(const std::shared_ptr<Get> &expr) override
+        {
+            // a member bound at resolve time is a constant already
+            if (!expr->bound_member.isNil())
+                return {};
+            return wrap(expr) ? Value() : OptimizationPass::visitGetExpr(expr);
+        }
+
+        Value visitCallExpr(const std::shared_ptr<Call> &expr) override
+        {
+            return wrap(expr) ? Value() : OptimizationPass::visitCallExpr(expr);
+        }
+    };
+
+    // Drops the checks of accesses `@counter->array` in a loop body, where the loop has proven the counter to be an
+    // integer below the array's size. Accesses in functions declared in the body may run after the counter moved on.
+    class BoundsCheckEliminator : public OptimizationPass
+    {
+        const Resolution counter;
+        const std::shared_ptr<Expr> &array;
+        int32_t offset = 0;
+
+        // whether expr, at the current depth, reads the same array as the loop condition does from depth 0
+        bool isArray(const std::shared_ptr<Expr> &expr, const std::shared_ptr<Expr> &other) const
+        {
+            if (auto invariant = std::dynamic_pointer_cast<Invariant>(expr))
+                return isArray(invariant->expr, other);
+            if (auto invariant = std::dynamic_pointer_cast<Invariant>(other))
+                return isArray(expr, invariant->expr);
+
+            if (std::dynamic_pointer_cast<This>(expr) && std::dynamic_pointer_cast<This>(other))
+                return true;
+
+            auto variable(std::dynamic_pointer_cast<Variable>(expr));
+            auto other_variable(std::dynamic_pointer_cast<Variable>(other));
+            if (variable && other_variable)
+            {
+                if (variable->resolution.depth < 0 || other_variable->resolution.depth < 0)
+                    return variable->resolution.depth == other_variable->resolution.depth &&
+                           variable->resolution.slot == other_variable->resolution.slot;
+                return variable->resolution.depth - offset == other_variable->resolution.depth &&
+                       variable->resolution.slot == other_variable->resolution.slot;
+            }
+
+            auto get(std::dynamic_pointer_cast<Get>(expr));
+            auto other_get(std::dynamic_pointer_cast<Get>(other));
+            return get && other_get && get->name_id == other_get->name_id && isArray(get->object, other_get->object);
+        }
+
+    public:
+        BoundsCheckEliminator(const Resolution &counter, const std::shared_ptr<Expr> &array)
+            : counter(counter), array(array)
+        {
+        }
+
+        void eliminate(const std::shared_ptr<Stmt> &body)
+        {
+            visit(body);
+        }
+
+        Value visitBlockStmt(const std::shared_ptr<Block> &stmt) override
+        {
+            offset += stmt->is_scoped;
+            OptimizationPass::visitBlockStmt(stmt);
+            offset -= stmt->is_scoped;
+            return {};
+        }
+
+        Value visitNamespaceStmt(const std::shared_ptr<Namespace> &stmt) override
+        {
+            return {};
+        }
+
+        Value visitFunctionStmt(const std::shared_ptr<Function> &stmt) override
+        {
+            return {};
+        }
+
+        Value visitLambdaExpr(const std::shared_ptr<Lambda> &expr) override
+        {
+            return {};
+        }
+
+        Value visitAccessExpr(const std::shared_ptr<Access> &expr) override
+        {
+            OptimizationPass::visitAccessExpr(expr);
+            if (isLocal(expr->index, {counter.depth + offset, counter.slot}) && isArray(expr->arr_name, array))
+                expr->is_bounds_checked = false;
+            return {};
+        }
+    };
+}
+
+bool LoopOptimizer::Frame::mayBeBoxed(uint32_t slot) const
+{
+    if (!boxed_slots || std::find(boxed_slots->begin(), boxed_slots->end(), slot) != boxed_slots->end())
+        return true;
+    return captures && std::any_of(captures->begin(), captures->end(),
+                                   [slot](const Capture &capture) { return capture.slot == slot; });
+}
+
+LoopOptimizer::LoopOptimizer(const std::shared_ptr<Environment> &globals)
+    : size_of_index(globals->globalIndex("sizeOf"))
+{
+    Value size_of;
+    has_size_of = globals->getFixed("sizeOf", size_of) && size_of.isCallable() &&
+                  dynamic_cast<Sizeof *>(size_of.asPointer<SurpherCallable>());
+}
+
+void LoopOptimizer::rewrite(std::list<std::shared_ptr<Stmt>> &statements)
+{
+    std::shared_ptr<Stmt> previous;
+    for (auto it = statements.begin(); it != statements.end();)
+    {
+        current = it->get();
+        preceding = previous;
+        rewrite(*it);
+        if (isEmptyStatement(*it))
+        {
+            it = statements.erase(it);
+            continue;
+        }
+        previous = *it++;
+    }
+    current = nullptr;
+    preceding = nullptr;
+}
+
+Value LoopOptimizer::visitBlockStmt(const std::shared_ptr<Block> &stmt)
+{
+    if (!stmt->is_scoped)
+        return OptimizationPass::visitBlockStmt(stmt);
+
+    frames.push_back({&stmt->slot_count, &stmt->boxed_slots, nullptr});
+    OptimizationPass::visitBlockStmt(stmt);
+    frames.pop_back();
+    return {};
+}
+
+Value LoopOptimizer::visitFunctionStmt(const std::shared_ptr<Function> &stmt)
+{
+    frames.push_back({&stmt->slot_count, &stmt->boxed_slots, &stmt->captures});
+    OptimizationPass::visitFunctionStmt(stmt);
+    frames.pop_back();
+    return {};
+}
+
+Value LoopOptimizer::visitNamespaceStmt(const std::shared_ptr<Namespace> &stmt)
+{
+    // a namespace's frame becomes its members
+    frames.push_back({nullptr, nullptr, nullptr});
+    OptimizationPass::visitNamespaceStmt(stmt);
+    frames.pop_back();
+    return {};
+}
+
+Value LoopOptimizer::visitWhileStmt(const std::shared_ptr<While> &stmt)
+{
+    // only a loop that is itself an element of a statement list runs straight after the element before it
+    auto initializer(current == stmt.get() ? preceding : nullptr);
+
+    OptimizationPass::visitWhileStmt(stmt);
+
+    // code outside any function or block runs in the globals, which have no slots to spare
+    if (frames.empty() || !frames.back().slot_count)
+        return {};
+
+    LoopEffects effects;
+    if (auto condition = std::dynamic_pointer_cast<Binary>(stmt->condition); condition && has_size_of)
+    {
+        if (auto bound = std::dynamic_pointer_cast<Call>(condition->right); bound && isSizeOf(bound, size_of_index))
+            effects.bound = bound.get();
+    }
+    effects.scan(stmt->condition);
+    effects.scan(stmt->body);
+    bool counter_is_assigned(false);
+    if (auto condition = std::dynamic_pointer_cast<Binary>(stmt->condition))
+    {
+        if (auto counter = std::dynamic_pointer_cast<Variable>(condition->left))
+            counter_is_assigned = counter->resolution.depth != 0 ||
+                                  effects.assigned.count({0, counter->resolution.slot});
+    }
+    effects.scan(stmt->increment);
+
+    if (has_size_of)
+        InvariantWrapper(effects, frames, size_of_index, stmt).wrap();
+    if (!counter_is_assigned)
+        eliminateBoundsChecks(stmt, initializer);
+    return {};
+}
+
+void LoopOptimizer::eliminateBoundsChecks(const std::shared_ptr<While> &stmt, const std::shared_ptr<Stmt> &initializer)
+{
+    // the condition must be `counter < sizeOf(array)`, with sizeOf(array) invariant
+    auto condition(std::dynamic_pointer_cast<Binary>(stmt->condition));
+    if (!condition || condition->op.token_type != LESS)
+        return;
+
+    auto counter(std::dynamic_pointer_cast<Variable>(condition->left));
+    auto bound(std::dynamic_pointer_cast<Invariant>(condition->right));
+    if (!counter || counter->resolution.depth != 0 || !bound || !bound->size_of_argument)
+        return;
+
+    const auto &resolution(counter->resolution);
+    if (frames.back().mayBeBoxed(resolution.slot))
+        return;
+
+    // the counter starts at an integer that is not negative...
+    bool starts_at_count(false);
+    if (auto var = std::dynamic_pointer_cast<Var>(initializer))
+    {
+        starts_at_count = !var->slots.empty() && var->slots.back() == static_cast<int32_t>(resolution.slot) &&
+                          isCount(std::get<2>(var->var_inits.back()));
+    }
+    else if (auto expression = std::dynamic_pointer_cast<Expression>(initializer))
+    {
+        auto assign(std::dynamic_pointer_cast<Assign>(expression->expression));
+        starts_at_count = assign && assign->resolution.depth == 0 && assign->resolution.slot == resolution.slot &&
+                          isCount(assign->value);
+    }
+    if (!starts_at_count)
+        return;
+
+    // ...and only ever grows by a count
+    auto increment(std::dynamic_pointer_cast<Assign>(stmt->increment));
+    if (!increment || increment->resolution.depth != 0 || increment->resolution.slot != resolution.slot)
+        return;
+    auto step(std::dynamic_pointer_cast<Binary>(increment->value));
+    if (!step || step->op.token_type != PLUS ||
+        !((isLocal(step->left, resolution) && isCount(step->right)) ||
+          (isCount(step->left) && isLocal(step->right, resolution))))
+        return;
+
+    BoundsCheckEliminator(resolution, bound->size_of_argument).eliminate(stmt->body);
+}
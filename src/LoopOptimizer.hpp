@@ -0,0 +1,57 @@
+#ifndef SURPHER_LOOP_OPTIMIZER_HPP
+#define SURPHER_LOOP_OPTIMIZER_HPP
+
+#include <vector>
+
+#include "OptimizationPass.hpp"
+#include "Environment.hpp"
+
+// Optimises while and for loops, innermost first:
+// - expressions that can't change while the loop runs and can't run user code, such as `sizeOf(arr)` or
+//   `this.size` in a loop that makes no calls, are wrapped in Invariant nodes, which evaluate them once per entry;
+//   the sizeOf a loop condition compares against doesn't count as a call
+// - in a loop `for (var i = <integer >= 0>; i < sizeOf(arr); i = i + <integer >= 0>)` that assigns i nowhere else,
+//   accesses `@i->arr` in the body skip their index and bounds checks, since i is an integer within arr
+class LoopOptimizer : public OptimizationPass
+{
+public:
+    // a frame enclosing the code being optimised; slot_count is null where there are no slots to spare
+    struct Frame
+    {
+        uint32_t *slot_count;
+        const std::vector<uint32_t> *boxed_slots;
+        const std::vector<Capture> *captures;
+
+        // whether a slot may hold a box, which closures can change behind the frame's back
+        bool mayBeBoxed(uint32_t slot) const;
+    };
+
+private:
+    std::vector<Frame> frames;
+    // where the native sizeOf is among the globals, to recognise calls to it
+    const uint32_t size_of_index;
+    bool has_size_of;
+    // the list element being rewritten and the one before it, which may initialise a loop's counter
+    const Stmt *current = nullptr;
+    std::shared_ptr<Stmt> preceding;
+
+    void eliminateBoundsChecks(const std::shared_ptr<While> &stmt, const std::shared_ptr<Stmt> &initializer);
+
+protected:
+    void rewrite(std::list<std::shared_ptr<Stmt>> &statements) override;
+
+    using OptimizationPass::rewrite;
+
+public:
+    explicit LoopOptimizer(const std::shared_ptr<Environment> &globals);
+
+    Value visitBlockStmt(const std::shared_ptr<Block> &stmt) override;
+
+    Value visitFunctionStmt(const std::shared_ptr<Function> &stmt) override;
+
+    Value visitNamespaceStmt(const std::shared_ptr<Namespace> &stmt) override;
+
+    Value visitWhileStmt(const std::shared_ptr<While> &stmt) override;
+};
+
+#endif // SURPHER_LOOP_OPTIMIZER_HPP
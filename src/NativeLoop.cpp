@@ -0,0 +1,395 @@
+#include <cmath>
+#include <cstring>
+
+#if defined(__x86_64__) && defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+#include "NativeLoop.hpp"
+#include "LoopCompiler.hpp"
+
+namespace
+{
+    // condition codes, as in the low nibble of jcc
+    enum Condition : uint8_t
+    {
+        BELOW = 0x2,
+        ABOVE_EQUAL = 0x3,
+        EQUAL = 0x4,
+        NOT_EQUAL = 0x5,
+        BELOW_EQUAL = 0x6,
+        ABOVE = 0x7,
+        PARITY = 0xA
+    };
+
+    constexpr uint8_t ADDSD = 0x58, MULSD = 0x59, SUBSD = 0x5C, DIVSD = 0x5E;
+
+    double remainder(double left, double right)
+    {
+        return std::fmod(left, right);
+    }
+
+    // Emits x86-64 templates. Registers 0 and 1 are xmm0 and xmm1, temporaries go on the machine stack, machine slots
+    // are addressed from rbx and the returned number is stored through r12.
+    class Assembler : public LoopEmitter
+    {
+        struct LabelState
+        {
+            int64_t position = -1;
+            std::vector<size_t> references;
+        };
+
+        std::vector<uint8_t> code;
+        std::vector<LabelState> labels;
+        // numbers pushed on the machine stack, to keep calls 16-byte aligned
+        uint32_t pushed = 0;
+        LabelState deoptimise, epilogue;
+
+        void emit(std::initializer_list<uint8_t> bytes)
+        {
+            code.insert(code.end(), bytes);
+        }
+
+        void emit32(uint32_t value)
+        {
+            for (int i = 0; i < 4; i++)
+                code.push_back(static_cast<uint8_t>(value >> (8 * i)));
+        }
+
+        void emit64(uint64_t value)
+        {
+            for (int i = 0; i < 8; i++)
+                code.push_back(static_cast<uint8_t>(value >> (8 * i)));
+        }
+
+        void patch(size_t at, size_t target)
+        {
+            auto offset(static_cast<uint32_t>(static_cast<int32_t>(target) - static_cast<int32_t>(at + 4)));
+            for (int i = 0; i < 4; i++)
+                code[at + i] = static_cast<uint8_t>(offset >> (8 * i));
+        }
+
+        LabelState &state(Label label)
+        {
+            if (label >= labels.size())
+                labels.resize(label + 1);
+            return labels[label];
+        }
+
+        void bind(LabelState &label)
+        {
+            label.position = static_cast<int64_t>(code.size());
+            for (size_t at : label.references)
+                patch(at, code.size());
+        }
+
+        void reference(LabelState &label)
+        {
+            size_t at(code.size());
+            emit32(0);
+            if (label.position >= 0)
+                patch(at, label.position);
+            else
+                label.references.push_back(at);
+        }
+
+        void jump(LabelState &label)
+        {
+            emit({0xE9});
+            reference(label);
+        }
+
+        void jumpIf(Condition condition, LabelState &label)
+        {
+            emit({0x0F, static_cast<uint8_t>(0x80 | condition)});
+            reference(label);
+        }
+
+        // mov eax, status
+        void setStatus(NativeLoop::Status status)
+        {
+            emit({0xB8});
+            emit32(status);
+        }
+
+        // xorpd xmm<to>, xmm<from>
+        void exclusiveOr(uint8_t to, uint8_t from)
+        {
+            emit({0x66, 0x0F, 0x57, static_cast<uint8_t>(0xC0 | to << 3 | from)});
+        }
+
+        // ucomisd xmm<left>, xmm<right>
+        void compare(uint8_t left, uint8_t right)
+        {
+            emit({0x66, 0x0F, 0x2E, static_cast<uint8_t>(0xC0 | left << 3 | right)});
+        }
+
+        // deoptimises when xmm1 is zero
+        void checkDenominator()
+        {
+            LabelState is_not_zero;
+            exclusiveOr(2, 2);
+            compare(1, 2);
+            jumpIf(PARITY, is_not_zero);
+            jumpIf(EQUAL, deoptimise);
+            bind(is_not_zero);
+        }
+
+        // sub rsp, 8 or add rsp, 8
+        void adjustStack(bool grow)
+        {
+            emit({0x48, 0x83, static_cast<uint8_t>(grow ? 0xEC : 0xC4), 0x08});
+        }
+
+        // mov rax, function; call rax
+        void call(const void *function)
+        {
+            emit({0x48, 0xB8});
+            emit64(reinterpret_cast<uint64_t>(function));
+            emit({0xFF, 0xD0});
+        }
+
+    public:
+        // push rbp; mov rbp, rsp; push rbx; push r12; mov rbx, rdi; mov r12, rsi -- leaves rsp 16-byte aligned
+        Assembler()
+        {
+            emit({0x55, 0x48, 0x89, 0xE5, 0x53, 0x41, 0x54, 0x48, 0x89, 0xFB, 0x49, 0x89, 0xF4});
+        }
+
+        // the machine code, once the loop has been lowered
+        std::vector<uint8_t> finish()
+        {
+            bind(deoptimise);
+            setStatus(NativeLoop::DEOPTIMISED);
+            bind(epilogue);
+            // lea rsp, [rbp - 16]; pop r12; pop rbx; pop rbp; ret -- whatever is still pushed
+            emit({0x48, 0x8D, 0x65, 0xF0, 0x41, 0x5C, 0x5B, 0x5D, 0xC3});
+            return std::move(code);
+        }
+
+        // mov rax, bits; movq xmm<reg>, rax
+        void loadNumber(uint8_t reg, double value) override
+        {
+            uint64_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            emit({0x48, 0xB8});
+            emit64(bits);
+            emit({0x66, 0x48, 0x0F, 0x6E, static_cast<uint8_t>(0xC0 | reg << 3)});
+        }
+
+        // movsd xmm<reg>, [rbx + 8 * index]
+        void loadSlot(uint8_t reg, uint32_t index) override
+        {
+            emit({0xF2, 0x0F, 0x10, static_cast<uint8_t>(0x83 | reg << 3)});
+            emit32(index * 8);
+        }
+
+        // movsd [rbx + 8 * index], xmm0
+        void storeSlot(uint32_t index) override
+        {
+            emit({0xF2, 0x0F, 0x11, 0x83});
+            emit32(index * 8);
+        }
+
+        // sub rsp, 8; movsd [rsp], xmm0
+        void push() override
+        {
+            emit({0x48, 0x83, 0xEC, 0x08, 0xF2, 0x0F, 0x11, 0x04, 0x24});
+            pushed++;
+        }
+
+        // movsd xmm<reg>, [rsp]; add rsp, 8
+        void pop(uint8_t reg) override
+        {
+            emit({0xF2, 0x0F, 0x10, static_cast<uint8_t>(0x04 | reg << 3), 0x24, 0x48, 0x83, 0xC4, 0x08});
+            pushed--;
+        }
+
+        // movapd xmm<to>, xmm<from>
+        void move(uint8_t to, uint8_t from) override
+        {
+            emit({0x66, 0x0F, 0x28, static_cast<uint8_t>(0xC0 | to << 3 | from)});
+        }
+
+        // flips the sign bit
+        void negate() override
+        {
+            loadNumber(1, -0.0);
+            exclusiveOr(0, 1);
+        }
+
+        // addsd, subsd, mulsd or divsd xmm0, xmm1, or a call to fmod
+        void arithmetic(TokenType op) override
+        {
+            switch (op)
+            {
+            case PLUS:
+                emit({0xF2, 0x0F, ADDSD, 0xC1});
+                break;
+            case MINUS:
+                emit({0xF2, 0x0F, SUBSD, 0xC1});
+                break;
+            case STAR:
+                emit({0xF2, 0x0F, MULSD, 0xC1});
+                break;
+            case SLASH:
+                checkDenominator();
+                emit({0xF2, 0x0F, DIVSD, 0xC1});
+                break;
+            default:
+                checkDenominator();
+                if (pushed % 2)
+                    adjustStack(true);
+                call(reinterpret_cast<const void *>(&remainder));
+                if (pushed % 2)
+                    adjustStack(false);
+                break;
+            }
+        }
+
+        void jumpIfComparison(TokenType op, bool jump_if, Label target) override
+        {
+            // an unordered comparison, with a NaN, sets the carry flag, so `above` is false for it
+            switch (op)
+            {
+            case GREATER:
+                compare(0, 1);
+                jumpIf(jump_if ? ABOVE : BELOW_EQUAL, state(target));
+                break;
+            case GREATER_EQUAL:
+                compare(0, 1);
+                jumpIf(jump_if ? ABOVE_EQUAL : BELOW, state(target));
+                break;
+            case LESS:
+                compare(1, 0);
+                jumpIf(jump_if ? ABOVE : BELOW_EQUAL, state(target));
+                break;
+            case LESS_EQUAL:
+                compare(1, 0);
+                jumpIf(jump_if ? ABOVE_EQUAL : BELOW, state(target));
+                break;
+            default:
+                compare(0, 1);
+                // equal means the zero flag set and the parity flag, for unordered, clear
+                if (jump_if == (op == DOUBLE_EQUAL))
+                {
+                    LabelState unequal;
+                    jumpIf(PARITY, unequal);
+                    jumpIf(EQUAL, state(target));
+                    bind(unequal);
+                }
+                else
+                {
+                    jumpIf(PARITY, state(target));
+                    jumpIf(NOT_EQUAL, state(target));
+                }
+                break;
+            }
+        }
+
+        void jump(Label target) override
+        {
+            jump(state(target));
+        }
+
+        void bind(Label label) override
+        {
+            bind(state(label));
+        }
+
+        void exit(NativeLoop::Status status) override
+        {
+            // movsd [r12], xmm0
+            if (status == NativeLoop::RETURNED_NUMBER)
+                emit({0xF2, 0x41, 0x0F, 0x11, 0x04, 0x24});
+            setStatus(status);
+            jump(epilogue);
+        }
+    };
+}
+
+NativeLoop::NativeLoop(Entry entry, void *code, size_t code_size, std::vector<Local> locals, uint32_t slot_count)
+    : entry(entry), code(code), code_size(code_size), locals(std::move(locals)), slot_count(slot_count)
+{
+}
+
+NativeLoop::~NativeLoop()
+{
+#if defined(__x86_64__) && defined(__linux__)
+    if (code != nullptr)
+        munmap(code, code_size);
+#endif
+}
+
+std::shared_ptr<NativeLoop> NativeLoop::compile(const While &stmt)
+{
+#if defined(__x86_64__) && defined(__linux__)
+    Assembler assembler;
+    LoopCompiler compiler(assembler);
+    if (!compiler.compile(stmt))
+        return nullptr;
+    auto machine_code(assembler.finish());
+
+    // written while writable, then made executable, never both
+    void *code(mmap(nullptr, machine_code.size(), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    if (code == MAP_FAILED)
+        return nullptr;
+    std::memcpy(code, machine_code.data(), machine_code.size());
+    if (mprotect(code, machine_code.size(), PROT_READ | PROT_EXEC) != 0)
+    {
+        munmap(code, machine_code.size());
+        return nullptr;
+    }
+
+    return std::shared_ptr<NativeLoop>(new NativeLoop(reinterpret_cast<Entry>(code), code, machine_code.size(),
+                                                      std::move(compiler.locals), compiler.slotCount()));
+#else
+    return nullptr;
+#endif
+}
+
+std::shared_ptr<NativeLoop> NativeLoop::wrap(Entry entry, std::vector<Local> locals, uint32_t slot_count)
+{
+    return std::shared_ptr<NativeLoop>(new NativeLoop(entry, nullptr, 0, std::move(locals), slot_count));
+}
+
+NativeLoop::Exit NativeLoop::run(Environment &environment, Value &return_value)
+{
+    // loops entered once per iteration of an interpreted loop around them shouldn't allocate
+    double small_slots[SMALL_SLOT_COUNT];
+    std::vector<double> large_slots;
+    double *slots(small_slots);
+    if (slot_count > SMALL_SLOT_COUNT)
+    {
+        large_slots.resize(slot_count);
+        slots = large_slots.data();
+    }
+
+    Value fixed_value;
+    for (const auto &local : locals)
+    {
+        const Value &value(environment.getAt(local.distance, local.slot));
+        if (!value.isNumber())
+            return Exit::DEOPTIMISED;
+        // assigning a fixed local is an error the Interpreter reports
+        if (local.is_assigned && environment.ancestor(local.distance)->getFixedAt(local.slot, fixed_value))
+            return Exit::DEOPTIMISED;
+        slots[local.index] = value.asNumber();
+    }
+
+    double result;
+    auto status(entry(slots, &result));
+    if (status == DEOPTIMISED)
+        return Exit::DEOPTIMISED;
+
+    for (const auto &local : locals)
+    {
+        if (local.is_assigned)
+            environment.ancestor(local.distance)->defineAt(local.slot, slots[local.index], false);
+    }
+
+    if (status == FINISHED)
+        return Exit::FINISHED;
+    return_value = status == RETURNED_NUMBER ? Value(result) : Value();
+    return Exit::RETURNED;
+}
@@ -0,0 +1,76 @@
+#ifndef SURPHER_NATIVE_LOOP_HPP
+#define SURPHER_NATIVE_LOOP_HPP
+
+#include <memory>
+#include <vector>
+
+#include "Environment.hpp"
+#include "Stmt.hpp"
+
+// A while loop compiled to machine code: to x86-64 by the --jit tier once it has run HOT_THRESHOLD iterations, or
+// ahead of time by surpherc. Only loops that do arithmetic, comparisons and branches on local numbers, with no calls
+// or other side effects, are compiled.
+// The locals from outside the loop are checked to hold numbers on entry, copied into machine slots, and copied back
+// once the loop is done. When the check fails, or the loop can't complete natively (a division by zero, say), none
+// of the loop's work is kept and the Interpreter runs it from where it was entered.
+class NativeLoop
+{
+public:
+    enum class Exit
+    {
+        FINISHED,
+        RETURNED,
+        DEOPTIMISED
+    };
+
+    // what the loop's code returns
+    enum Status : int32_t
+    {
+        FINISHED,
+        RETURNED_NUMBER,
+        RETURNED_NIL,
+        DEOPTIMISED
+    };
+
+    using Entry = int32_t (*)(double *slots, double *result);
+
+    // a local from outside the loop: how far up from the loop's environment it lives, and its machine slot
+    struct Local
+    {
+        uint32_t distance;
+        uint32_t slot;
+        uint32_t index;
+        bool is_assigned;
+    };
+
+    static constexpr uint32_t HOT_THRESHOLD = 1000;
+
+    // null when the loop does something the compiler doesn't handle, or the machine isn't x86-64 Linux
+    static std::shared_ptr<NativeLoop> compile(const While &stmt);
+
+    // a loop compiled ahead of time, by surpherc
+    static std::shared_ptr<NativeLoop> wrap(Entry entry, std::vector<Local> locals, uint32_t slot_count);
+
+    // runs the loop in environment; when it returns from the function, return_value is set
+    Exit run(Environment &environment, Value &return_value);
+
+    NativeLoop(const NativeLoop &) = delete;
+
+    NativeLoop &operator=(const NativeLoop &) = delete;
+
+    ~NativeLoop();
+
+private:
+    static constexpr uint32_t SMALL_SLOT_COUNT = 32;
+
+    Entry entry;
+    // the mapped pages of code compiled at run time, if that's where entry points
+    void *code;
+    size_t code_size;
+    const std::vector<Local> locals;
+    const uint32_t slot_count;
+
+    NativeLoop(Entry entry, void *code, size_t code_size, std::vector<Local> locals, uint32_t slot_count);
+};
+
+#endif // SURPHER_NATIVE_LOOP_HPP
@@ -0,0 +1,310 @@
+#include "OptimizationPass.hpp"
+
+void OptimizationPass::run(std::list<std::shared_ptr<Stmt>> &statements)
+{
+    rewrite(statements);
+}
+
+size_t OptimizationPass::countNodes(std::list<std::shared_ptr<Stmt>> &statements)
+{
+    OptimizationPass counter;
+    counter.run(statements);
+    return counter.nodes;
+}
+
+size_t OptimizationPass::countNodes(const std::shared_ptr<Expr> &expr)
+{
+    OptimizationPass counter;
+    counter.visit(expr);
+    return counter.nodes;
+}
+
+void OptimizationPass::rewrite(std::shared_ptr<Expr> &expr)
+{
+    if (!expr)
+        return;
+
+    nodes++;
+    replacement = nullptr;
+    expr->accept(*this);
+    if (replacement)
+        expr = std::move(replacement);
+    replacement = nullptr;
+}
+
+void OptimizationPass::visit(const std::shared_ptr<Expr> &expr)
+{
+    if (!expr)
+        return;
+
+    nodes++;
+    expr->accept(*this);
+    replacement = nullptr;
+}
+
+void OptimizationPass::rewrite(std::shared_ptr<Stmt> &stmt)
+{
+    if (!stmt)
+        return;
+
+    nodes++;
+    stmt_replacement = nullptr;
+    stmt->accept(*this);
+    if (stmt_replacement)
+        stmt = std::move(stmt_replacement);
+    stmt_replacement = nullptr;
+}
+
+void OptimizationPass::visit(const std::shared_ptr<Stmt> &stmt)
+{
+    if (!stmt)
+        return;
+
+    nodes++;
+    stmt->accept(*this);
+    stmt_replacement = nullptr;
+}
+
+void OptimizationPass::rewrite(std::list<std::shared_ptr<Stmt>> &statements)
+{
+    for (auto it = statements.begin(); it != statements.end();)
+    {
+        rewrite(*it);
+        if (isEmptyStatement(*it))
+            it = statements.erase(it);
+        else
+            ++it;
+    }
+}
+
+std::shared_ptr<Block> OptimizationPass::emptyStatement()
+{
+    auto block(std::make_shared<Block>(std::list<std::shared_ptr<Stmt>>{}));
+    block->is_scoped = false;
+    block->escapes = false;
+    return block;
+}
+
+bool OptimizationPass::isEmptyStatement(const std::shared_ptr<Stmt> &stmt)
+{
+    auto block(std::dynamic_pointer_cast<Block>(stmt));
+    return block && block->statements.empty();
+}
+
+Value OptimizationPass::visitBlockStmt(const std::shared_ptr<Block> &stmt)
+{
+    rewrite(stmt->statements);
+    return {};
+}
+
+Value OptimizationPass::visitExpressionStmt(const std::shared_ptr<Expression> &stmt)
+{
+    rewrite(stmt->expression);
+    return {};
+}
+
+Value OptimizationPass::visitPrintStmt(const std::shared_ptr<Print> &stmt)
+{
+    rewrite(stmt->expression);
+    return {};
+}
+
+Value OptimizationPass::visitVarStmt(const std::shared_ptr<Var> &stmt)
+{
+    for (auto &var_init : stmt->var_inits)
+        rewrite(std::get<2>(var_init));
+    return {};
+}
+
+Value OptimizationPass::visitIfStmt(const std::shared_ptr<If> &stmt)
+{
+    rewrite(stmt->condition);
+    rewrite(stmt->true_branch);
+    rewrite(stmt->else_branch);
+    return {};
+}
+
+Value OptimizationPass::visitWhileStmt(const std::shared_ptr<While> &stmt)
+{
+    rewrite(stmt->condition);
+    rewrite(stmt->body);
+    rewrite(stmt->increment);
+    return {};
+}
+
+Value OptimizationPass::visitBreakStmt(const std::shared_ptr<Break> &stmt)
+{
+    return {};
+}
+
+Value OptimizationPass::visitContinueStmt(const std::shared_ptr<Continue> &stmt)
+{
+    return {};
+}
+
+Value OptimizationPass::visitFunctionStmt(const std::shared_ptr<Function> &stmt)
+{
+    rewrite(stmt->body);
+    return {};
+}
+
+Value OptimizationPass::visitReturnStmt(const std::shared_ptr<Return> &stmt)
+{
+    rewrite(stmt->value);
+    return {};
+}
+
+Value OptimizationPass::visitClassStmt(const std::shared_ptr<Class> &stmt)
+{
+    visit(stmt->superclass);
+    for (const auto &method : stmt->instance_methods)
+        visit(std::static_pointer_cast<Stmt>(method));
+    for (const auto &method : stmt->class_methods)
+        visit(std::static_pointer_cast<Stmt>(method));
+    return {};
+}
+
+Value OptimizationPass::visitImportStmt(const std::shared_ptr<Import> &stmt)
+{
+    visit(stmt->script);
+    return {};
+}
+
+Value OptimizationPass::visitNamespaceStmt(const std::shared_ptr<Namespace> &stmt)
+{
+    rewrite(stmt->statements);
+    return {};
+}
+
+Value OptimizationPass::visitHaltStmt(const std::shared_ptr<Halt> &stmt)
+{
+    rewrite(stmt->message);
+    return {};
+}
+
+Value OptimizationPass::visitCompiledStmt(const std::shared_ptr<Compiled> &stmt)
+{
+    return {};
+}
+
+Value OptimizationPass::visitBinaryExpr(const std::shared_ptr<Binary> &expr)
+{
+    rewrite(expr->left);
+    rewrite(expr->right);
+    return {};
+}
+
+Value OptimizationPass::visitGroupExpr(const std::shared_ptr<Group> &expr)
+{
+    rewrite(expr->expr_in);
+    return {};
+}
+
+Value OptimizationPass::visitLiteralExpr(const std::shared_ptr<Literal> &expr)
+{
+    return {};
+}
+
+Value OptimizationPass::visitUnaryExpr(const std::shared_ptr<Unary> &expr)
+{
+    rewrite(expr->right);
+    return {};
+}
+
+Value OptimizationPass::visitAssignExpr(const std::shared_ptr<Assign> &expr)
+{
+    rewrite(expr->value);
+    return {};
+}
+
+Value OptimizationPass::visitVariableExpr(const std::shared_ptr<Variable> &expr)
+{
+    return {};
+}
+
+Value OptimizationPass::visitLogicalExpr(const std::shared_ptr<Logical> &expr)
+{
+    rewrite(expr->left);
+    rewrite(expr->right);
+    return {};
+}
+
+Value OptimizationPass::visitCallExpr(const std::shared_ptr<Call> &expr)
+{
+    visit(expr->callee);
+    for (auto &argument : expr->arguments)
+        rewrite(argument);
+    return {};
+}
+
+Value OptimizationPass::visitLambdaExpr(const std::shared_ptr<Lambda> &expr)
+{
+    visit(std::static_pointer_cast<Stmt>(expr->function));
+    return {};
+}
+
+Value OptimizationPass::visitTernaryExpr(const std::shared_ptr<Ternary> &expr)
+{
+    rewrite(expr->condition);
+    rewrite(expr->true_branch);
+    rewrite(expr->else_branch);
+    return {};
+}
+
+Value OptimizationPass::visitGetExpr(const std::shared_ptr<Get> &expr)
+{
+    visit(expr->object);
+    return {};
+}
+
+Value OptimizationPass::visitSetExpr(const std::shared_ptr<Set> &expr)
+{
+    visit(expr->object);
+    rewrite(expr->value);
+    return {};
+}
+
+Value OptimizationPass::visitThisExpr(const std::shared_ptr<This> &expr)
+{
+    return {};
+}
+
+Value OptimizationPass::visitSuperExpr(const std::shared_ptr<Super> &expr)
+{
+    return {};
+}
+
+Value OptimizationPass::visitArrayExpr(const std::shared_ptr<Array> &expr)
+{
+    for (auto &element : expr->expr_vector)
+        rewrite(element);
+    rewrite(expr->dynamic_size);
+    return {};
+}
+
+Value OptimizationPass::visitAccessExpr(const std::shared_ptr<Access> &expr)
+{
+    rewrite(expr->index);
+    visit(expr->arr_name);
+    return {};
+}
+
+Value OptimizationPass::visitArraySetExpr(const std::shared_ptr<ArraySet> &expr)
+{
+    visit(expr->assignee);
+    rewrite(expr->value);
+    return {};
+}
+
+Value OptimizationPass::visitCommaExpr(const std::shared_ptr<Comma> &expr)
+{
+    for (auto &expression : expr->expressions)
+        rewrite(expression);
+    return {};
+}
+
+Value OptimizationPass::visitInvariantExpr(const std::shared_ptr<Invariant> &expr)
+{
+    visit(expr->expr);
+    return {};
+}
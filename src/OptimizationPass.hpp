@@ -0,0 +1,116 @@
+#ifndef SURPHER_OPTIMIZATION_PASS_HPP
+#define SURPHER_OPTIMIZATION_PASS_HPP
+
+#include <list>
+
+#include "Expr.hpp"
+#include "Stmt.hpp"
+
+// A rewrite of the resolved tree. The default visits walk every node and change nothing; a pass overrides the
+// visits it cares about and replaces a node by setting `replacement` (or `stmt_replacement`) before returning.
+class OptimizationPass : public ExprVisitor, public StmtVisitor
+{
+    size_t nodes = 0;
+
+protected:
+    // set by a visit when the expression just visited should be replaced
+    std::shared_ptr<Expr> replacement;
+    // set by a visit when the statement just visited should be replaced; see emptyStatement
+    std::shared_ptr<Stmt> stmt_replacement;
+
+    void rewrite(std::shared_ptr<Expr> &expr);
+
+    // for positions a rewritten expression can't take, like a callee: rewrites inside but keeps the expression
+    void visit(const std::shared_ptr<Expr> &expr);
+
+    void rewrite(std::shared_ptr<Stmt> &stmt);
+
+    void visit(const std::shared_ptr<Stmt> &stmt);
+
+    // statements rewritten to emptyStatement are dropped from the list
+    virtual void rewrite(std::list<std::shared_ptr<Stmt>> &statements);
+
+    // a statement that does nothing, for places that need one; runs in the enclosing scope
+    static std::shared_ptr<Block> emptyStatement();
+
+    static bool isEmptyStatement(const std::shared_ptr<Stmt> &stmt);
+
+public:
+    virtual ~OptimizationPass() = default;
+
+    virtual void run(std::list<std::shared_ptr<Stmt>> &statements);
+
+    static size_t countNodes(std::list<std::shared_ptr<Stmt>> &statements);
+
+    static size_t countNodes(const std::shared_ptr<Expr> &expr);
+
+    Value visitBlockStmt(const std::shared_ptr<Block> &stmt) override;
+
+    Value visitExpressionStmt(const std::shared_ptr<Expression> &stmt) override;
+
+    Value visitPrintStmt(const std::shared_ptr<Print> &stmt) override;
+
+    Value visitVarStmt(const std::shared_ptr<Var> &stmt) override;
+
+    Value visitIfStmt(const std::shared_ptr<If> &stmt) override;
+
+    Value visitWhileStmt(const std::shared_ptr<While> &stmt) override;
+
+    Value visitBreakStmt(const std::shared_ptr<Break> &stmt) override;
+
+    Value visitContinueStmt(const std::shared_ptr<Continue> &stmt) override;
+
+    Value visitFunctionStmt(const std::shared_ptr<Function> &stmt) override;
+
+    Value visitReturnStmt(const std::shared_ptr<Return> &stmt) override;
+
+    Value visitClassStmt(const std::shared_ptr<Class> &stmt) override;
+
+    Value visitImportStmt(const std::shared_ptr<Import> &stmt) override;
+
+    Value visitNamespaceStmt(const std::shared_ptr<Namespace> &stmt) override;
+
+    Value visitHaltStmt(const std::shared_ptr<Halt> &stmt) override;
+
+    Value visitCompiledStmt(const std::shared_ptr<Compiled> &stmt) override;
+
+    Value visitBinaryExpr(const std::shared_ptr<Binary> &expr) override;
+
+    Value visitGroupExpr(const std::shared_ptr<Group> &expr) override;
+
+    Value visitLiteralExpr(const std::shared_ptr<Literal> &expr) override;
+
+    Value visitUnaryExpr(const std::shared_ptr<Unary> &expr) override;
+
+    Value visitAssignExpr(const std::shared_ptr<Assign> &expr) override;
+
+    Value visitVariableExpr(const std::shared_ptr<Variable> &expr) override;
+
+    Value visitLogicalExpr(const std::shared_ptr<Logical> &expr) override;
+
+    Value visitCallExpr(const std::shared_ptr<Call> &expr) override;
+
+    Value visitLambdaExpr(const std::shared_ptr<Lambda> &expr) override;
+
+    Value visitTernaryExpr(const std::shared_ptr<Ternary> &expr) override;
+
+    Value visitGetExpr(const std::shared_ptr<Get> &expr) override;
+
+    Value visitSetExpr(const std::shared_ptr<Set> &expr) override;
+
+    Value visitThisExpr(const std::shared_ptr<This> &expr) override;
+
+    Value visitSuperExpr(const std::shared_ptr<Super> &expr) override;
+
+    Value visitArrayExpr(const std::shared_ptr<Array> &expr) override;
+
+    Value visitAccessExpr(const std::shared_ptr<Access> &expr) override;
+
+    Value visitArraySetExpr(const std::shared_ptr<ArraySet> &expr) override;
+
+    Value visitCommaExpr(const std::shared_ptr<Comma> &expr) override;
+
+    Value visitInvariantExpr(const std::shared_ptr<Invariant> &expr) override;
+};
+
+#endif // SURPHER_OPTIMIZATION_PASS_HPP
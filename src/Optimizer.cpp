@@ -0,0 +1,44 @@
+#include <iostream>
+#include <vector>
+
+#include "Optimizer.hpp"
+#include "ConstantFolder.hpp"
+#include "Inliner.hpp"
+#include "LoopOptimizer.hpp"
+#include "Interpreter.hpp"
+#include "DeadCodeEliminator.hpp"
+
+Optimizer::Optimizer(Interpreter &interpreter, uint32_t level, size_t inline_budget, bool dump_constants,
+                     bool dump_passes)
+        : interpreter(interpreter), level(level), inline_budget(inline_budget), dump_constants(dump_constants),
+          dump_passes(dump_passes)
+{
+}
+
+void Optimizer::optimize(std::list<std::shared_ptr<Stmt>> &script)
+{
+    std::vector<std::pair<const char *, std::unique_ptr<OptimizationPass>>> passes;
+    if (level >= 1)
+        passes.emplace_back("constant-folding", std::make_unique<ConstantFolder>(interpreter, dump_constants));
+    if (level >= 2)
+    {
+        if (inline_budget > 0)
+            passes.emplace_back("inlining", std::make_unique<Inliner>(inline_budget));
+        passes.emplace_back("loops", std::make_unique<LoopOptimizer>(interpreter.globals));
+        passes.emplace_back("dead-code", std::make_unique<DeadCodeEliminator>());
+    }
+
+    for (auto &[name, pass] : passes)
+    {
+        if (!dump_passes)
+        {
+            pass->run(script);
+            continue;
+        }
+
+        size_t before = OptimizationPass::countNodes(script);
+        pass->run(script);
+        std::cerr << "[pass] " << name << ": " << before << " -> " << OptimizationPass::countNodes(script)
+                  << " nodes\n";
+    }
+}
@@ -0,0 +1,35 @@
+#ifndef SURPHER_OPTIMIZER_HPP
+#define SURPHER_OPTIMIZER_HPP
+
+#include <list>
+#include <memory>
+
+#include "Stmt.hpp"
+
+class Interpreter;
+
+// Runs the optimisation passes enabled at a level over a resolved script:
+//   -O0  none
+//   -O1  constant propagation and folding, dropping redundant parentheses and comma operands
+//   -O2  also inlining of small functions, loop invariant caching, bounds check elimination and dead code
+//        elimination
+class Optimizer
+{
+    Interpreter &interpreter;
+    const uint32_t level;
+    // how many nodes inlining may add to the script
+    const size_t inline_budget;
+    const bool dump_constants;
+    // print the size of the tree before and after each pass
+    const bool dump_passes;
+
+public:
+    static constexpr uint32_t MAX_LEVEL = 2;
+    static constexpr size_t DEFAULT_INLINE_BUDGET = 2000;
+
+    Optimizer(Interpreter &interpreter, uint32_t level, size_t inline_budget, bool dump_constants, bool dump_passes);
+
+    void optimize(std::list<std::shared_ptr<Stmt>> &script);
+};
+
+#endif // SURPHER_OPTIMIZER_HPP
@@ -320,15 +320,11 @@ std::shared_ptr<Stmt> Parser::forStatement()
 
     std::shared_ptr<Stmt> body(statement());
 
-    if (increment != nullptr)
-    {
-        body = std::make_shared<Block>(Block{{body, std::make_shared<Expression>(increment)}});
-    }
     if (condition == nullptr)
     {
         condition = std::make_shared<Literal>(true);
     }
-    body = std::make_shared<While>(While{condition, body});
+    body = std::make_shared<While>(condition, body, increment);
     if (initializer != nullptr)
     {
         body = std::make_shared<Block>(Block{{initializer, body}});
@@ -559,7 +555,17 @@ std::shared_ptr<Expr> Parser::pipe()
     {
         Token op(previous());
         std::shared_ptr<Expr> right(bit_wise_or());
-        expr = std::make_shared<Pipe>(expr, op, right);
+
+        // a |> f(b) is just f(a, b)
+        auto right_call(std::dynamic_pointer_cast<Call>(right));
+        if (!right_call)
+            throw error(op, "Pipe operator can only be applied to a call expression.");
+
+        std::vector<std::shared_ptr<Expr>> arguments;
+        arguments.reserve(right_call->arguments.size() + 1);
+        arguments.emplace_back(expr);
+        arguments.insert(arguments.end(), right_call->arguments.begin(), right_call->arguments.end());
+        expr = std::make_shared<Call>(right_call->callee, right_call->paren, std::move(arguments));
     }
 
     return expr;
@@ -1,11 +1,12 @@
+#include <algorithm>
 #include <functional>
 #include <memory>
 
 #include "Resolver.hpp"
-#include "Interpreter.hpp"
 #include "Error.hpp"
+#include "SurpherNamespace.hpp"
 
-Resolver::Resolver(Interpreter &interpreter) : interpreter(interpreter)
+Resolver::Resolver(std::shared_ptr<Environment> globals) : globals(std::move(globals))
 {
 }
 
@@ -20,47 +21,110 @@ void Resolver::resolve(const std::list<std::shared_ptr<Stmt>> &statements)
         resolve(s);
 }
 
-std::any Resolver::visitBlockStmt(const std::shared_ptr<Block> &stmt)
+Value Resolver::visitBlockStmt(const std::shared_ptr<Block> &stmt)
 {
+    // only a block's own statements can declare into its scope
+    stmt->is_scoped = std::any_of(stmt->statements.begin(), stmt->statements.end(), [](const auto &s)
+                                  { return std::dynamic_pointer_cast<Var>(s) || std::dynamic_pointer_cast<Function>(s) ||
+                                           std::dynamic_pointer_cast<Class>(s) || std::dynamic_pointer_cast<Namespace>(s); });
+    if (!stmt->is_scoped)
+    {
+        resolve(stmt->statements);
+        return {};
+    }
+
     beginScope();
     resolve(stmt->statements);
-    endScope();
+    auto scope(endScope());
+    stmt->slot_count = scope.slot_count;
+    stmt->escapes = scope.escapes;
+    stmt->boxed_slots = std::move(scope.boxed_slots);
     return {};
 }
 
 void Resolver::beginScope()
 {
-    scopes.push({});
+    scopes.emplace_back();
 }
 
-void Resolver::endScope()
+Resolver::Scope Resolver::endScope()
 {
-    scopes.pop();
+    auto scope(std::move(scopes.back()));
+    scopes.pop_back();
+    return scope;
 }
 
-std::any Resolver::visitVarStmt(const std::shared_ptr<Var> &stmt)
+void Resolver::captureScopes()
 {
-    for (const auto &var_init : stmt->var_inits)
+    // a namespace keeps its enclosing scopes alive, so none of them can live on the frame stack
+    for (auto &scope : scopes)
+        scope.escapes = true;
+}
+
+Value Resolver::visitVarStmt(const std::shared_ptr<Var> &stmt)
+{
+    stmt->slots.clear();
+    for (size_t i = 0; i < stmt->var_inits.size(); i++)
     {
-        declare(std::get<0>(var_init));
+        const auto &var_init(stmt->var_inits[i]);
+        const auto &name(std::get<0>(var_init));
+        stmt->slots.push_back(declare(name));
         if (std::get<2>(var_init))
             resolve(std::get<2>(var_init));
-        define(std::get<0>(var_init));
+        define(name);
+
+        bool is_constant(std::get<1>(var_init) && std::get<2>(var_init));
+        if (!scopes.empty())
+        {
+            if (is_constant)
+            {
+                auto &binding(scopes.back().bindings[name.lexeme]);
+                binding.fixed_declaration = stmt;
+                binding.fixed_index = i;
+            }
+        }
+        else
+        {
+            Binding binding;
+            binding.is_defined = true;
+            if (is_constant)
+            {
+                binding.fixed_declaration = stmt;
+                binding.fixed_index = i;
+            }
+            declareGlobal(name.lexeme, std::move(binding), std::get<1>(var_init));
+        }
     }
 
     return {};
 }
 
-void Resolver::declare(const Token &name)
+// The run time rejects a fixed declaration of a name that is already fixed, so only a name's first fixed declaration
+// can be its value, and only if nothing fixed it before this script: an earlier script or an import.
+void Resolver::declareGlobal(const std::string &name, Binding binding, bool is_fixed)
+{
+    Value value;
+    if (is_fixed && fixed_global_names.insert(name).second && !has_import && !globals->getFixed(name, value))
+        fixed_globals[name] = std::move(binding);
+    else
+        fixed_globals.erase(name);
+}
+
+int32_t Resolver::declare(const Token &name)
 {
     if (scopes.empty())
-        return;
+        return -1;
 
-    auto &scope = scopes.top();
-    if (scope.find(name.lexeme) != scope.end())
+    auto &scope = scopes.back();
+    auto elem(scope.bindings.find(name.lexeme));
+    if (elem != scope.bindings.end())
+    {
         error(name, "Already a variable with this name in this scope.");
+        return elem->second.slot;
+    }
 
-    scope[name.lexeme] = false;
+    scope.bindings[name.lexeme].slot = scope.slot_count;
+    return scope.slot_count++;
 }
 
 void Resolver::define(const Token &name)
@@ -68,51 +132,81 @@ void Resolver::define(const Token &name)
     if (scopes.empty())
         return;
 
-    scopes.top()[name.lexeme] = true;
+    scopes.back().bindings[name.lexeme].is_defined = true;
 }
 
-std::any Resolver::visitVariableExpr(const std::shared_ptr<Variable> &expr)
+Value Resolver::visitVariableExpr(const std::shared_ptr<Variable> &expr)
 {
     if (!scopes.empty())
     {
-        auto &scope = scopes.top();
-        auto elem(scope.find(expr->name.lexeme));
-        if (elem != scope.end() && !elem->second)
+        auto &scope = scopes.back();
+        auto elem(scope.bindings.find(expr->name.lexeme));
+        if (elem != scope.bindings.end() && !elem->second.is_defined)
             error(expr->name, "Can't read local variable in its own initializer.");
     }
 
-    resolveLocal(expr, expr->name);
+    if (auto binding = resolveLocal(expr->resolution, expr->name))
+    {
+        expr->fixed_declaration = binding->fixed_declaration;
+        expr->fixed_index = binding->fixed_index;
+        expr->function_declaration = binding->function;
+    }
     return {};
 }
 
-void Resolver::transferStack(std::stack<std::unordered_map<std::string, bool>> &aux_stack)
+const Resolver::Binding *Resolver::resolveLocal(Resolution &resolution, const Token &name)
 {
-    while (!aux_stack.empty())
-    {
-        scopes.emplace(aux_stack.top());
-        aux_stack.pop();
-    }
+    const Binding *binding(nullptr);
+    resolution = resolveIn(function_scopes.size(), name.lexeme, binding);
+    if (resolution.depth >= 0)
+        return binding;
+
+    resolution.slot = globals->globalIndex(name.lexeme);
+    auto fixed_global(fixed_globals.find(name.lexeme));
+    return fixed_global != fixed_globals.end() ? &fixed_global->second : nullptr;
 }
 
-void Resolver::resolveLocal(const std::shared_ptr<Expr> &expr, const Token &name)
+// Level 0 is code outside any function, level n the scopes of function_scopes[n - 1]. A name found in an outer
+// level is boxed where it is declared and copied into a slot of every function in between, so a frame never
+// needs to reach past its own function.
+Resolution Resolver::resolveIn(size_t level, const std::string &name, const Binding *&binding)
 {
-    std::stack<std::unordered_map<std::string, bool>> aux_stack;
-    uint32_t scopes_size(scopes.size());
-    for (auto i = 0; i < scopes_size; i++)
+    size_t begin(level == 0 ? 0 : function_scopes[level - 1].base);
+    size_t end(level < function_scopes.size() ? function_scopes[level].base : scopes.size());
+    for (size_t i = end; i-- > begin;)
     {
-        if (scopes.top().find(name.lexeme) != scopes.top().end())
-        {
-            interpreter.resolve(expr, i);
-            transferStack(aux_stack);
-            return;
-        }
-        else
+        auto elem(scopes[i].bindings.find(name));
+        if (elem == scopes[i].bindings.end())
+            continue;
+
+        if (level < function_scopes.size() && !elem->second.is_boxed)
         {
-            aux_stack.emplace(scopes.top());
-            scopes.pop();
+            elem->second.is_boxed = true;
+            scopes[i].boxed_slots.push_back(elem->second.slot);
         }
+        binding = &elem->second;
+        return {static_cast<int32_t>(end - 1 - i), elem->second.slot};
     }
-    transferStack(aux_stack);
+
+    if (level == 0)
+        return {};
+
+    auto &function_scope(function_scopes[level - 1]);
+    auto captured(function_scope.captured.find(name));
+    if (captured == function_scope.captured.end())
+    {
+        const Binding *source_binding(nullptr);
+        Resolution source(resolveIn(level - 1, name, source_binding));
+        if (source.depth < 0)
+            return {};
+
+        Binding copy(*source_binding);
+        copy.slot = scopes[begin].slot_count++;
+        function_scope.function->captures.push_back({source, copy.slot});
+        captured = function_scope.captured.emplace(name, std::move(copy)).first;
+    }
+    binding = &captured->second;
+    return {static_cast<int32_t>(end - 1 - begin), captured->second.slot};
 }
 
 void Resolver::resolve(const std::shared_ptr<Expr> &expr)
@@ -120,24 +214,30 @@ void Resolver::resolve(const std::shared_ptr<Expr> &expr)
     expr->accept(*this);
 }
 
-std::any Resolver::visitAssignExpr(const std::shared_ptr<Assign> &expr)
+Value Resolver::visitAssignExpr(const std::shared_ptr<Assign> &expr)
 {
     resolve(expr->value);
-    resolveLocal(expr, expr->name);
-    return {};
-}
-
-std::any Resolver::visitPipeExpr(const std::shared_ptr<Pipe> &expr)
-{
-    resolve(expr->right);
-    resolve(expr->left);
+    auto binding(resolveLocal(expr->resolution, expr->name));
+    if (binding && binding->function)
+        binding->function->is_rebound = true;
     return {};
 }
 
-std::any Resolver::visitFunctionStmt(const std::shared_ptr<Function> &stmt)
+Value Resolver::visitFunctionStmt(const std::shared_ptr<Function> &stmt)
 {
-    declare(stmt->name);
+    stmt->slot = declare(stmt->name);
     define(stmt->name);
+    if (!scopes.empty())
+    {
+        scopes.back().bindings[stmt->name.lexeme].function = stmt;
+    }
+    else
+    {
+        Binding binding;
+        binding.is_defined = true;
+        binding.function = stmt;
+        declareGlobal(stmt->name.lexeme, std::move(binding), stmt->is_fixed);
+    }
 
     resolveFunction(stmt, FunctionType::FUNCTION);
     return {};
@@ -146,26 +246,43 @@ std::any Resolver::visitFunctionStmt(const std::shared_ptr<Function> &stmt)
 void Resolver::resolveFunction(const std::shared_ptr<Function> &function, FunctionType type)
 {
     auto enclosing_function = current_function;
+    auto enclosing_loop_depth = loop_depth;
     current_function = type;
+    loop_depth = 0;
 
+    function->captures.clear();
+    function_scopes.push_back({function, scopes.size(), {}});
     beginScope();
+    if (type == FunctionType::METHOD || type == FunctionType::INITIALIZER)
+    {
+        // the receiver is passed straight into the method's frame
+        auto &binding(scopes.back().bindings["this"]);
+        binding.is_defined = true;
+        binding.slot = scopes.back().slot_count++;
+        function->param_slot = 1;
+    }
     for (const auto &param : function->params)
     {
         declare(param);
         define(param);
     }
     resolve(function->body);
-    endScope();
+    auto scope(endScope());
+    function_scopes.pop_back();
+    function->slot_count = scope.slot_count;
+    function->escapes = scope.escapes;
+    function->boxed_slots = std::move(scope.boxed_slots);
     current_function = enclosing_function;
+    loop_depth = enclosing_loop_depth;
 }
 
-std::any Resolver::visitExpressionStmt(const std::shared_ptr<Expression> &stmt)
+Value Resolver::visitExpressionStmt(const std::shared_ptr<Expression> &stmt)
 {
     resolve(stmt->expression);
     return {};
 }
 
-std::any Resolver::visitIfStmt(const std::shared_ptr<If> &stmt)
+Value Resolver::visitIfStmt(const std::shared_ptr<If> &stmt)
 {
     resolve(stmt->condition);
     resolve(stmt->true_branch);
@@ -176,29 +293,36 @@ std::any Resolver::visitIfStmt(const std::shared_ptr<If> &stmt)
     return {};
 }
 
-std::any Resolver::visitPrintStmt(const std::shared_ptr<Print> &stmt)
+Value Resolver::visitPrintStmt(const std::shared_ptr<Print> &stmt)
 {
     resolve(stmt->expression);
     return {};
 }
 
-std::any Resolver::visitBreakStmt(const std::shared_ptr<Break> &stmt)
+Value Resolver::visitBreakStmt(const std::shared_ptr<Break> &stmt)
 {
+    if (loop_depth == 0)
+        error(stmt->break_tok, "'break' must be used in loop.");
+
     return {};
 }
 
-std::any Resolver::visitImportStmt(const std::shared_ptr<Import> &stmt)
+Value Resolver::visitImportStmt(const std::shared_ptr<Import> &stmt)
 {
+    has_import = true;
     resolve(stmt->script);
     return {};
 }
 
-std::any Resolver::visitContinueStmt(const std::shared_ptr<Continue> &stmt)
+Value Resolver::visitContinueStmt(const std::shared_ptr<Continue> &stmt)
 {
+    if (loop_depth == 0)
+        error(stmt->continue_tok, "'continue' must be used in loop.");
+
     return {};
 }
 
-std::any Resolver::visitReturnStmt(const std::shared_ptr<Return> &stmt)
+Value Resolver::visitReturnStmt(const std::shared_ptr<Return> &stmt)
 {
     if (current_function == FunctionType::NONE)
         error(stmt->keyword, "Can't return from top-level code.");
@@ -213,29 +337,44 @@ std::any Resolver::visitReturnStmt(const std::shared_ptr<Return> &stmt)
     return {};
 }
 
-std::any Resolver::visitWhileStmt(const std::shared_ptr<While> &stmt)
+Value Resolver::visitWhileStmt(const std::shared_ptr<While> &stmt)
 {
     resolve(stmt->condition);
+    loop_depth++;
     resolve(stmt->body);
+    loop_depth--;
+    if (stmt->increment)
+        resolve(stmt->increment);
+
+    auto body(std::dynamic_pointer_cast<Block>(stmt->body));
+    stmt->body_scope = body && body->is_scoped && !body->escapes && body->boxed_slots.empty() ? body : nullptr;
     return {};
 }
 
-std::any Resolver::visitHaltStmt(const std::shared_ptr<Halt> &stmt)
+Value Resolver::visitHaltStmt(const std::shared_ptr<Halt> &stmt)
 {
     resolve(stmt->message);
     return {};
 }
 
-std::any Resolver::visitBinaryExpr(const std::shared_ptr<Binary> &expr)
+Value Resolver::visitCompiledStmt(const std::shared_ptr<Compiled> &stmt)
+{
+    // closures are compiled from resolved statements
+    return {};
+}
+
+Value Resolver::visitBinaryExpr(const std::shared_ptr<Binary> &expr)
 {
     resolve(expr->left);
     resolve(expr->right);
     return {};
 }
 
-std::any Resolver::visitCallExpr(const std::shared_ptr<Call> &expr)
+Value Resolver::visitCallExpr(const std::shared_ptr<Call> &expr)
 {
     resolve(expr->callee);
+    auto get(std::dynamic_pointer_cast<Get>(expr->callee));
+    expr->invoke = get && get->bound_member.isNil() ? get : nullptr;
 
     for (const auto &argument : expr->arguments)
         resolve(argument);
@@ -243,31 +382,31 @@ std::any Resolver::visitCallExpr(const std::shared_ptr<Call> &expr)
     return {};
 }
 
-std::any Resolver::visitGroupExpr(const std::shared_ptr<Group> &expr)
+Value Resolver::visitGroupExpr(const std::shared_ptr<Group> &expr)
 {
     resolve(expr->expr_in);
     return {};
 }
 
-std::any Resolver::visitLiteralExpr(const std::shared_ptr<Literal> &expr)
+Value Resolver::visitLiteralExpr(const std::shared_ptr<Literal> &expr)
 {
     return {};
 }
 
-std::any Resolver::visitLogicalExpr(const std::shared_ptr<Logical> &expr)
+Value Resolver::visitLogicalExpr(const std::shared_ptr<Logical> &expr)
 {
     resolve(expr->right);
     resolve(expr->left);
     return {};
 }
 
-std::any Resolver::visitUnaryExpr(const std::shared_ptr<Unary> &expr)
+Value Resolver::visitUnaryExpr(const std::shared_ptr<Unary> &expr)
 {
     resolve(expr->right);
     return {};
 }
 
-std::any Resolver::visitTernaryExpr(const std::shared_ptr<Ternary> &expr)
+Value Resolver::visitTernaryExpr(const std::shared_ptr<Ternary> &expr)
 {
     resolve(expr->condition);
     resolve(expr->else_branch);
@@ -275,31 +414,38 @@ std::any Resolver::visitTernaryExpr(const std::shared_ptr<Ternary> &expr)
     return {};
 }
 
-std::any Resolver::visitLambdaExpr(const std::shared_ptr<Lambda> &expr)
+Value Resolver::visitLambdaExpr(const std::shared_ptr<Lambda> &expr)
 {
-    std::list<std::shared_ptr<Stmt>> lambda_return{std::make_shared<Return>(Token("", {}, RETURN, 1), expr->body)};
-    std::shared_ptr<Function> lambda_fun = std::make_shared<Function>(expr->name, expr->params, lambda_return, false, true);
-    return visitFunctionStmt(lambda_fun);
+    std::list<std::shared_ptr<Stmt>> lambda_return{std::make_shared<Return>(Token("return", {}, RETURN, expr->name.line), expr->body)};
+    expr->function = std::make_shared<Function>(expr->name, expr->params, std::move(lambda_return), false, true);
+    resolveFunction(expr->function, FunctionType::FUNCTION);
+    return {};
 }
 
-std::any Resolver::visitNamespaceStmt(const std::shared_ptr<Namespace> &stmt)
+Value Resolver::visitNamespaceStmt(const std::shared_ptr<Namespace> &stmt)
 {
-    declare(stmt->name);
+    stmt->slot = declare(stmt->name);
     define(stmt->name);
 
+    captureScopes();
     beginScope();
     resolve(stmt->statements);
-    endScope();
+    stmt->member_slots.clear();
+    for (const auto &binding : scopes.back().bindings)
+        stmt->member_slots[binding.first] = binding.second.slot;
+    auto scope(endScope());
+    stmt->slot_count = scope.slot_count;
+    stmt->boxed_slots = std::move(scope.boxed_slots);
 
     return {};
 }
 
-std::any Resolver::visitClassStmt(const std::shared_ptr<Class> &stmt)
+Value Resolver::visitClassStmt(const std::shared_ptr<Class> &stmt)
 {
     auto enclosing_class = current_class;
     current_class = ClassType::CLASS;
 
-    declare(stmt->name);
+    stmt->slot = declare(stmt->name);
     define(stmt->name);
 
     if (stmt->superclass)
@@ -316,12 +462,11 @@ std::any Resolver::visitClassStmt(const std::shared_ptr<Class> &stmt)
         current_class = ClassType::SUBCLASS;
         resolve(stmt->superclass);
         beginScope();
-        scopes.top()["super"] = true;
+        auto &binding(scopes.back().bindings["super"]);
+        binding.is_defined = true;
+        binding.slot = scopes.back().slot_count++;
     }
 
-    beginScope();
-    scopes.top()["this"] = true;
-
     for (const auto &i : stmt->instance_methods)
     {
         if (i->is_sig)
@@ -346,8 +491,6 @@ std::any Resolver::visitClassStmt(const std::shared_ptr<Class> &stmt)
         resolveFunction(c, declaration);
     }
 
-    endScope();
-
     if (stmt->superclass)
         endScope();
 
@@ -355,20 +498,41 @@ std::any Resolver::visitClassStmt(const std::shared_ptr<Class> &stmt)
     return {};
 }
 
-std::any Resolver::visitGetExpr(const std::shared_ptr<Get> &expr)
+Value Resolver::visitGetExpr(const std::shared_ptr<Get> &expr)
 {
     resolve(expr->object);
+    bindNamespaceMember(expr);
     return {};
 }
 
-std::any Resolver::visitSetExpr(const std::shared_ptr<Set> &expr)
+// A fixed global can't be redefined and a fixed member can't be assigned, so when every link in the chain is fixed
+// the member is looked up once here. Anything else stays a lookup at run time.
+void Resolver::bindNamespaceMember(const std::shared_ptr<Get> &expr)
+{
+    Value object;
+    if (auto variable = std::dynamic_pointer_cast<Variable>(expr->object))
+    {
+        if (variable->resolution.depth >= 0 || !globals->getFixed(variable->name.lexeme, object))
+            return;
+    }
+    else if (auto get = std::dynamic_pointer_cast<Get>(expr->object))
+    {
+        object = get->bound_member;
+    }
+
+    Value member;
+    if (object.isNamespace() && object.asPointer<SurpherNamespace>()->getFixed(expr->name.lexeme, member))
+        expr->bound_member = member;
+}
+
+Value Resolver::visitSetExpr(const std::shared_ptr<Set> &expr)
 {
     resolve(expr->value);
     resolve(expr->object);
     return {};
 }
 
-std::any Resolver::visitThisExpr(const std::shared_ptr<This> &expr)
+Value Resolver::visitThisExpr(const std::shared_ptr<This> &expr)
 {
     if (current_class == ClassType::NONE)
     {
@@ -376,11 +540,11 @@ std::any Resolver::visitThisExpr(const std::shared_ptr<This> &expr)
         return {};
     }
 
-    resolveLocal(expr, expr->keyword);
+    resolveLocal(expr->resolution, expr->keyword);
     return {};
 }
 
-std::any Resolver::visitSuperExpr(const std::shared_ptr<Super> &expr)
+Value Resolver::visitSuperExpr(const std::shared_ptr<Super> &expr)
 {
     if (current_class == ClassType::NONE)
     {
@@ -391,11 +555,12 @@ std::any Resolver::visitSuperExpr(const std::shared_ptr<Super> &expr)
         error(expr->keyword, "Can't use 'super' in a class without superclass.");
     }
 
-    resolveLocal(expr, expr->keyword);
+    resolveLocal(expr->resolution, expr->keyword);
+    resolveLocal(expr->this_resolution, Token("this", {}, THIS, expr->keyword.line));
     return {};
 }
 
-std::any Resolver::visitArrayExpr(const std::shared_ptr<Array> &expr)
+Value Resolver::visitArrayExpr(const std::shared_ptr<Array> &expr)
 {
     std::for_each(expr->expr_vector.begin(), expr->expr_vector.end(), [this](const auto &entry)
                   { resolve(entry); });
@@ -405,7 +570,7 @@ std::any Resolver::visitArrayExpr(const std::shared_ptr<Array> &expr)
     return {};
 }
 
-std::any Resolver::visitAccessExpr(const std::shared_ptr<Access> &expr)
+Value Resolver::visitAccessExpr(const std::shared_ptr<Access> &expr)
 {
     resolve(expr->arr_name);
     resolve(expr->index);
@@ -413,7 +578,7 @@ std::any Resolver::visitAccessExpr(const std::shared_ptr<Access> &expr)
     return {};
 }
 
-std::any Resolver::visitArraySetExpr(const std::shared_ptr<ArraySet> &expr)
+Value Resolver::visitArraySetExpr(const std::shared_ptr<ArraySet> &expr)
 {
     resolve(expr->assignee);
     resolve(expr->value);
@@ -421,10 +586,16 @@ std::any Resolver::visitArraySetExpr(const std::shared_ptr<ArraySet> &expr)
     return {};
 }
 
-std::any Resolver::visitCommaExpr(const std::shared_ptr<Comma> &expr)
+Value Resolver::visitCommaExpr(const std::shared_ptr<Comma> &expr)
 {
     for (const auto &e : expr->expressions)
         resolve(e);
 
     return {};
 }
+
+Value Resolver::visitInvariantExpr(const std::shared_ptr<Invariant> &expr)
+{
+    resolve(expr->expr);
+    return {};
+}
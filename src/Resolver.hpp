@@ -1,14 +1,13 @@
 #ifndef SURPHER_RESOLVER_HPP
 #define SURPHER_RESOLVER_HPP
 
-#include <stack>
 #include <vector>
 #include <unordered_map>
+#include <unordered_set>
 #include <list>
 #include "Expr.hpp"
 #include "Stmt.hpp"
-
-class Interpreter;
+#include "Environment.hpp"
 
 class Resolver : ExprVisitor, StmtVisitor
 {
@@ -25,10 +24,45 @@ class Resolver : ExprVisitor, StmtVisitor
         CLASS,
         SUBCLASS
     };
-    std::stack<std::unordered_map<std::string, bool>> scopes;
-    Interpreter &interpreter;
+    struct Binding
+    {
+        bool is_defined = false;
+        uint32_t slot = 0;
+        bool is_boxed = false;
+        // a fixed var with an initialiser: the statement and which of its initialisers
+        std::shared_ptr<Var> fixed_declaration;
+        size_t fixed_index = 0;
+        // a function declared here, or a fixed one declared at the top level
+        std::shared_ptr<Function> function;
+    };
+    struct Scope
+    {
+        std::unordered_map<std::string, Binding> bindings;
+        uint32_t slot_count = 0;
+        bool escapes = false;
+        std::vector<uint32_t> boxed_slots;
+    };
+    // a function being resolved: where its scopes start in `scopes` and the outer locals it has captured so far
+    struct FunctionScope
+    {
+        std::shared_ptr<Function> function;
+        size_t base;
+        // the outer binding, with the slot it was copied into
+        std::unordered_map<std::string, Binding> captured;
+    };
+    std::vector<Scope> scopes;
+    std::vector<FunctionScope> function_scopes;
+    // fixed vars and functions declared at the top level of this script, the only globals known not to change once
+    // defined
+    std::unordered_map<std::string, Binding> fixed_globals;
+    // top-level names that have had a fixed declaration; only the first one can succeed at run time
+    std::unordered_set<std::string> fixed_global_names;
+    // an import may fix any name before the declarations after it run
+    bool has_import = false;
+    const std::shared_ptr<Environment> globals;
     FunctionType current_function = FunctionType::NONE;
     ClassType current_class = ClassType::NONE;
+    uint32_t loop_depth = 0;
 
     void resolve(const std::shared_ptr<Expr> &expr);
 
@@ -36,88 +70,98 @@ class Resolver : ExprVisitor, StmtVisitor
 
     void beginScope();
 
-    void endScope();
+    Scope endScope();
 
-    void declare(const Token &name);
+    void captureScopes();
+
+    int32_t declare(const Token &name);
 
     void define(const Token &name);
 
-    void resolveLocal(const std::shared_ptr<Expr> &expr, const Token &name);
+    void declareGlobal(const std::string &name, Binding binding, bool is_fixed);
+
+    const Binding *resolveLocal(Resolution &resolution, const Token &name);
+
+    Resolution resolveIn(size_t level, const std::string &name, const Binding *&binding);
 
     void resolveFunction(const std::shared_ptr<Function> &function, FunctionType type);
 
-    void transferStack(std::stack<std::unordered_map<std::string, bool>> &aux_stack);
+    void bindNamespaceMember(const std::shared_ptr<Get> &expr);
 
 public:
-    std::any visitBlockStmt(const std::shared_ptr<Block> &stmt) override;
+    // globals hand out the indices global variables are read through, and bind members of fixed namespaces
+    explicit Resolver(std::shared_ptr<Environment> globals);
 
-    std::any visitExpressionStmt(const std::shared_ptr<Expression> &stmt) override;
+    Value visitBlockStmt(const std::shared_ptr<Block> &stmt) override;
 
-    std::any visitPrintStmt(const std::shared_ptr<Print> &stmt) override;
+    Value visitExpressionStmt(const std::shared_ptr<Expression> &stmt) override;
 
-    std::any visitVarStmt(const std::shared_ptr<Var> &stmt) override;
+    Value visitPrintStmt(const std::shared_ptr<Print> &stmt) override;
 
-    std::any visitIfStmt(const std::shared_ptr<If> &stmt) override;
+    Value visitVarStmt(const std::shared_ptr<Var> &stmt) override;
 
-    std::any visitWhileStmt(const std::shared_ptr<While> &stmt) override;
+    Value visitIfStmt(const std::shared_ptr<If> &stmt) override;
 
-    std::any visitBreakStmt(const std::shared_ptr<Break> &stmt) override;
+    Value visitWhileStmt(const std::shared_ptr<While> &stmt) override;
 
-    std::any visitContinueStmt(const std::shared_ptr<Continue> &stmt) override;
+    Value visitBreakStmt(const std::shared_ptr<Break> &stmt) override;
 
-    std::any visitFunctionStmt(const std::shared_ptr<Function> &stmt) override;
+    Value visitContinueStmt(const std::shared_ptr<Continue> &stmt) override;
 
-    std::any visitReturnStmt(const std::shared_ptr<Return> &stmt) override;
+    Value visitFunctionStmt(const std::shared_ptr<Function> &stmt) override;
 
-    std::any visitClassStmt(const std::shared_ptr<Class> &stmt) override;
+    Value visitReturnStmt(const std::shared_ptr<Return> &stmt) override;
 
-    std::any visitImportStmt(const std::shared_ptr<Import> &stmt) override;
+    Value visitClassStmt(const std::shared_ptr<Class> &stmt) override;
 
-    std::any visitNamespaceStmt(const std::shared_ptr<Namespace> &stmt) override;
+    Value visitImportStmt(const std::shared_ptr<Import> &stmt) override;
 
-    std::any visitHaltStmt(const std::shared_ptr<Halt> &stmt) override;
+    Value visitNamespaceStmt(const std::shared_ptr<Namespace> &stmt) override;
 
-    std::any visitBinaryExpr(const std::shared_ptr<Binary> &expr) override;
+    Value visitHaltStmt(const std::shared_ptr<Halt> &stmt) override;
 
-    std::any visitGroupExpr(const std::shared_ptr<Group> &expr) override;
+    Value visitCompiledStmt(const std::shared_ptr<Compiled> &stmt) override;
 
-    std::any visitLiteralExpr(const std::shared_ptr<Literal> &expr) override;
+    Value visitBinaryExpr(const std::shared_ptr<Binary> &expr) override;
 
-    std::any visitUnaryExpr(const std::shared_ptr<Unary> &expr) override;
+    Value visitGroupExpr(const std::shared_ptr<Group> &expr) override;
 
-    std::any visitAssignExpr(const std::shared_ptr<Assign> &expr) override;
+    Value visitLiteralExpr(const std::shared_ptr<Literal> &expr) override;
 
-    std::any visitVariableExpr(const std::shared_ptr<Variable> &expr) override;
+    Value visitUnaryExpr(const std::shared_ptr<Unary> &expr) override;
 
-    std::any visitLogicalExpr(const std::shared_ptr<Logical> &expr) override;
+    Value visitAssignExpr(const std::shared_ptr<Assign> &expr) override;
 
-    std::any visitCallExpr(const std::shared_ptr<Call> &expr) override;
+    Value visitVariableExpr(const std::shared_ptr<Variable> &expr) override;
 
-    std::any visitLambdaExpr(const std::shared_ptr<Lambda> &expr) override;
+    Value visitLogicalExpr(const std::shared_ptr<Logical> &expr) override;
 
-    std::any visitTernaryExpr(const std::shared_ptr<Ternary> &expr) override;
+    Value visitCallExpr(const std::shared_ptr<Call> &expr) override;
 
-    std::any visitGetExpr(const std::shared_ptr<Get> &expr) override;
+    Value visitLambdaExpr(const std::shared_ptr<Lambda> &expr) override;
 
-    std::any visitSetExpr(const std::shared_ptr<Set> &expr) override;
+    Value visitTernaryExpr(const std::shared_ptr<Ternary> &expr) override;
 
-    std::any visitThisExpr(const std::shared_ptr<This> &expr) override;
+    Value visitGetExpr(const std::shared_ptr<Get> &expr) override;
 
-    std::any visitSuperExpr(const std::shared_ptr<Super> &expr) override;
+    Value visitSetExpr(const std::shared_ptr<Set> &expr) override;
 
-    std::any visitArrayExpr(const std::shared_ptr<Array> &expr) override;
+    Value visitThisExpr(const std::shared_ptr<This> &expr) override;
 
-    std::any visitAccessExpr(const std::shared_ptr<Access> &expr) override;
+    Value visitSuperExpr(const std::shared_ptr<Super> &expr) override;
 
-    std::any visitArraySetExpr(const std::shared_ptr<ArraySet> &expr) override;
+    Value visitArrayExpr(const std::shared_ptr<Array> &expr) override;
 
-    std::any visitCommaExpr(const std::shared_ptr<Comma> &expr) override;
+    Value visitAccessExpr(const std::shared_ptr<Access> &expr) override;
 
-    std::any visitPipeExpr(const std::shared_ptr<Pipe> &expr) override;
+    Value visitArraySetExpr(const std::shared_ptr<ArraySet> &expr) override;
 
-    void resolve(const std::list<std::shared_ptr<Stmt>> &statements);
+    Value visitCommaExpr(const std::shared_ptr<Comma> &expr) override;
 
-    explicit Resolver(Interpreter &interpreter);
+    Value visitInvariantExpr(const std::shared_ptr<Invariant> &expr) override;
+
+
+    void resolve(const std::list<std::shared_ptr<Stmt>> &statements);
 };
 
 #endif // SURPHER_RESOLVER_HPP
@@ -0,0 +1,22 @@
+#include "Shape.hpp"
+
+int32_t Shape::findField(SymbolId name) const
+{
+    auto slot_iter(field_slots.find(name));
+    if (slot_iter == field_slots.end())
+        return -1;
+
+    return slot_iter->second;
+}
+
+Ref<Shape> Shape::addField(SymbolId name)
+{
+    auto &next(transitions[name]);
+    if (!next)
+    {
+        next = makeRef<Shape>();
+        next->field_slots = field_slots;
+        next->field_slots.emplace(name, field_slots.size());
+    }
+    return next;
+}
@@ -0,0 +1,59 @@
+#ifndef SURPHER_SHAPE_HPP
+#define SURPHER_SHAPE_HPP
+
+#include <unordered_map>
+#include <string>
+
+#include "Value.hpp"
+#include "Symbol.hpp"
+
+struct SurpherFunction;
+
+// Field layout shared by every instance of a class that was given the same fields in the same order.
+// Adding a field follows a transition to a child shape, so equal layouts end up on the same Shape object.
+struct Shape : Object
+{
+    std::unordered_map<SymbolId, uint32_t> field_slots;
+    std::unordered_map<SymbolId, Ref<Shape>> transitions;
+
+    int32_t findField(SymbolId name) const;
+
+    Ref<Shape> addField(SymbolId name);
+};
+
+// Remembers the shapes seen at one property access site. A hit skips every string lookup.
+struct PropertyCache
+{
+    static constexpr size_t capacity = 4;
+
+    struct Entry
+    {
+        Ref<Shape> shape;
+        uint32_t slot = 0;
+        // set when a store adds the field: the shape the instance moves to
+        Ref<Shape> next_shape;
+        // set when a load resolved to a method rather than a field
+        SurpherFunction *method = nullptr;
+    };
+
+    Entry entries[capacity];
+    size_t size = 0;
+
+    Entry *find(const Shape *shape)
+    {
+        for (size_t i = 0; i < size; i++)
+        {
+            if (entries[i].shape.get() == shape)
+                return &entries[i];
+        }
+        return nullptr;
+    }
+
+    void insert(Entry entry)
+    {
+        if (size < capacity)
+            entries[size++] = std::move(entry);
+    }
+};
+
+#endif // SURPHER_SHAPE_HPP
@@ -4,21 +4,21 @@
 
 Block::Block(std::list<std::shared_ptr<Stmt>> statements) : statements{std::move(statements)} {}
 
-std::any Block::accept(StmtVisitor &visitor)
+Value Block::accept(StmtVisitor &visitor)
 {
     return visitor.visitBlockStmt(shared_from_this());
 }
 
 Expression::Expression(std::shared_ptr<Expr> expression) : expression{std::move(expression)} {}
 
-std::any Expression::accept(StmtVisitor &visitor)
+Value Expression::accept(StmtVisitor &visitor)
 {
     return visitor.visitExpressionStmt(shared_from_this());
 }
 
 Print::Print(std::shared_ptr<Expr> expression) : expression{std::move(expression)} {}
 
-std::any Print::accept(StmtVisitor &visitor)
+Value Print::accept(StmtVisitor &visitor)
 {
     return visitor.visitPrintStmt(shared_from_this());
 }
@@ -27,7 +27,7 @@ Var::Var(std::vector<std::tuple<Token, bool, std::shared_ptr<Expr>>> var_inits)
 {
 }
 
-std::any Var::accept(StmtVisitor &visitor)
+Value Var::accept(StmtVisitor &visitor)
 {
     return visitor.visitVarStmt(shared_from_this());
 }
@@ -38,22 +38,22 @@ If::If(std::shared_ptr<Expr> condition, std::shared_ptr<Stmt> true_branch,
 {
 }
 
-std::any If::accept(StmtVisitor &visitor)
+Value If::accept(StmtVisitor &visitor)
 {
     return visitor.visitIfStmt(shared_from_this());
 }
 
-While::While(std::shared_ptr<Expr> condition, std::shared_ptr<Stmt> body) : condition(std::move(condition)),
-                                                                            body(std::move(body))
+While::While(std::shared_ptr<Expr> condition, std::shared_ptr<Stmt> body, std::shared_ptr<Expr> increment)
+    : condition(std::move(condition)), body(std::move(body)), increment(std::move(increment))
 {
 }
 
-std::any While::accept(StmtVisitor &visitor)
+Value While::accept(StmtVisitor &visitor)
 {
     return visitor.visitWhileStmt(shared_from_this());
 }
 
-std::any Break::accept(StmtVisitor &visitor)
+Value Break::accept(StmtVisitor &visitor)
 {
     return visitor.visitBreakStmt(shared_from_this());
 }
@@ -62,7 +62,7 @@ Break::Break(Token break_tok) : break_tok{std::move(break_tok)}
 {
 }
 
-std::any Continue::accept(StmtVisitor &visitor)
+Value Continue::accept(StmtVisitor &visitor)
 {
     return visitor.visitContinueStmt(shared_from_this());
 }
@@ -79,7 +79,7 @@ Function::Function(Token name, std::vector<Token> params, std::list<std::shared_
 {
 }
 
-std::any Function::accept(StmtVisitor &visitor)
+Value Function::accept(StmtVisitor &visitor)
 {
     return visitor.visitFunctionStmt(shared_from_this());
 }
@@ -89,7 +89,7 @@ Return::Return(Token keyword, std::shared_ptr<Expr> value) : keyword(std::move(k
 {
 }
 
-std::any Return::accept(StmtVisitor &visitor)
+Value Return::accept(StmtVisitor &visitor)
 {
     return visitor.visitReturnStmt(shared_from_this());
 }
@@ -99,20 +99,20 @@ Class::Class(Token name, std::vector<std::shared_ptr<Function>> instance_methods
              bool is_fixed)
     : name(
           std::move(name)),
+      superclass(
+          std::move(
+              superclass)),
       instance_methods(
           std::move(
               instance_methods)),
       class_methods(
           std::move(
               class_methods)),
-      superclass(
-          std::move(
-              superclass)),
       is_fixed(is_fixed)
 {
 }
 
-std::any Class::accept(StmtVisitor &visitor)
+Value Class::accept(StmtVisitor &visitor)
 {
     return visitor.visitClassStmt(shared_from_this());
 }
@@ -122,24 +122,31 @@ Import::Import(std::shared_ptr<Expr> script) : script(
 {
 }
 
-std::any Import::accept(StmtVisitor &visitor)
+Value Import::accept(StmtVisitor &visitor)
 {
     return visitor.visitImportStmt(shared_from_this());
 }
 
 Namespace::Namespace(Token name, std::list<std::shared_ptr<Stmt>> statements, bool is_fixed) : name(std::move(name)),
-                                                                                               statements(std::move(statements)), is_fixed(is_fixed)
+                                                                                               is_fixed(is_fixed), statements(std::move(statements))
 {
 }
 
-std::any Namespace::accept(StmtVisitor &visitor)
+Value Namespace::accept(StmtVisitor &visitor)
 {
     return visitor.visitNamespaceStmt(shared_from_this());
 }
 
 Halt::Halt(Token keyword, std::shared_ptr<Expr> message) : keyword(std::move(keyword)), message(std::move(message)) {}
 
-std::any Halt::accept(StmtVisitor &visitor)
+Value Halt::accept(StmtVisitor &visitor)
 {
     return visitor.visitHaltStmt(shared_from_this());
 }
+
+Compiled::Compiled(std::shared_ptr<StmtCode> code) : code(std::move(code)) {}
+
+Value Compiled::accept(StmtVisitor &visitor)
+{
+    return visitor.visitCompiledStmt(shared_from_this());
+}
@@ -4,8 +4,11 @@
 #include <vector>
 #include <optional>
 #include <list>
+#include <unordered_map>
 #include "Expr.hpp"
 
+class NativeLoop;
+
 struct Block;
 struct Expression;
 struct Print;
@@ -20,99 +23,120 @@ struct Class;
 struct Import;
 struct Namespace;
 struct Halt;
+struct Compiled;
+struct StmtCode;
 
 struct StmtVisitor
 {
-    virtual std::any visitBlockStmt(const std::shared_ptr<Block> &stmt) = 0;
+    virtual Value visitBlockStmt(const std::shared_ptr<Block> &stmt) = 0;
+
+    virtual Value visitExpressionStmt(const std::shared_ptr<Expression> &stmt) = 0;
 
-    virtual std::any visitExpressionStmt(const std::shared_ptr<Expression> &stmt) = 0;
+    virtual Value visitPrintStmt(const std::shared_ptr<Print> &stmt) = 0;
 
-    virtual std::any visitPrintStmt(const std::shared_ptr<Print> &stmt) = 0;
+    virtual Value visitVarStmt(const std::shared_ptr<Var> &stmt) = 0;
 
-    virtual std::any visitVarStmt(const std::shared_ptr<Var> &stmt) = 0;
+    virtual Value visitIfStmt(const std::shared_ptr<If> &stmt) = 0;
 
-    virtual std::any visitIfStmt(const std::shared_ptr<If> &stmt) = 0;
+    virtual Value visitWhileStmt(const std::shared_ptr<While> &stmt) = 0;
 
-    virtual std::any visitWhileStmt(const std::shared_ptr<While> &stmt) = 0;
+    virtual Value visitBreakStmt(const std::shared_ptr<Break> &stmt) = 0;
 
-    virtual std::any visitBreakStmt(const std::shared_ptr<Break> &stmt) = 0;
+    virtual Value visitContinueStmt(const std::shared_ptr<Continue> &stmt) = 0;
 
-    virtual std::any visitContinueStmt(const std::shared_ptr<Continue> &stmt) = 0;
+    virtual Value visitFunctionStmt(const std::shared_ptr<Function> &stmt) = 0;
 
-    virtual std::any visitFunctionStmt(const std::shared_ptr<Function> &stmt) = 0;
+    virtual Value visitReturnStmt(const std::shared_ptr<Return> &stmt) = 0;
 
-    virtual std::any visitReturnStmt(const std::shared_ptr<Return> &stmt) = 0;
+    virtual Value visitClassStmt(const std::shared_ptr<Class> &stmt) = 0;
 
-    virtual std::any visitClassStmt(const std::shared_ptr<Class> &stmt) = 0;
+    virtual Value visitImportStmt(const std::shared_ptr<Import> &stmt) = 0;
 
-    virtual std::any visitImportStmt(const std::shared_ptr<Import> &stmt) = 0;
+    virtual Value visitNamespaceStmt(const std::shared_ptr<Namespace> &stmt) = 0;
 
-    virtual std::any visitNamespaceStmt(const std::shared_ptr<Namespace> &stmt) = 0;
+    virtual Value visitHaltStmt(const std::shared_ptr<Halt> &stmt) = 0;
 
-    virtual std::any visitHaltStmt(const std::shared_ptr<Halt> &stmt) = 0;
+    virtual Value visitCompiledStmt(const std::shared_ptr<Compiled> &stmt) = 0;
 };
 
 struct Stmt
 {
-    virtual std::any accept(StmtVisitor &visitor) = 0;
+    virtual Value accept(StmtVisitor &visitor) = 0;
 };
 
 struct Block : Stmt, public std::enable_shared_from_this<Block>
 {
-    const std::list<std::shared_ptr<Stmt>> statements;
+    std::list<std::shared_ptr<Stmt>> statements;
+    uint32_t slot_count = 0;
+    // cleared by the Resolver when the block declares nothing and runs in the enclosing scope
+    bool is_scoped = true;
+    // cleared by the Resolver when nothing can hold on to the block's scope after it exits
+    bool escapes = true;
+    std::vector<uint32_t> boxed_slots;
 
     explicit Block(std::list<std::shared_ptr<Stmt>> statements);
 
-    std::any accept(StmtVisitor &visitor) override;
+    Value accept(StmtVisitor &visitor) override;
 };
 
 struct Expression : Stmt, public std::enable_shared_from_this<Expression>
 {
-    const std::shared_ptr<Expr> expression;
+    std::shared_ptr<Expr> expression;
 
     explicit Expression(std::shared_ptr<Expr> expression);
 
-    std::any accept(StmtVisitor &visitor) override;
+    Value accept(StmtVisitor &visitor) override;
 };
 
 struct Print : Stmt, public std::enable_shared_from_this<Print>
 {
-    const std::shared_ptr<Expr> expression;
+    std::shared_ptr<Expr> expression;
 
     explicit Print(std::shared_ptr<Expr> expression);
 
-    std::any accept(StmtVisitor &visitor) override;
+    Value accept(StmtVisitor &visitor) override;
 };
 
 struct Var : Stmt, public std::enable_shared_from_this<Var>
 {
     std::vector<std::tuple<Token, bool, std::shared_ptr<Expr>>> var_inits;
+    // one per initializer, -1 for globals
+    std::vector<int32_t> slots;
 
     explicit Var(std::vector<std::tuple<Token, bool, std::shared_ptr<Expr>>> var_inits);
 
-    std::any accept(StmtVisitor &visitor) override;
+    Value accept(StmtVisitor &visitor) override;
 };
 
 struct If : Stmt, public std::enable_shared_from_this<If>
 {
-    const std::shared_ptr<Expr> condition;
-    const std::shared_ptr<Stmt> true_branch;
-    const std::shared_ptr<Stmt> else_branch;
+    std::shared_ptr<Expr> condition;
+    std::shared_ptr<Stmt> true_branch;
+    std::shared_ptr<Stmt> else_branch;
 
     If(std::shared_ptr<Expr> condition, std::shared_ptr<Stmt> true_branch,
        std::shared_ptr<Stmt> else_branch);
 
-    std::any accept(StmtVisitor &visitor) override;
+    Value accept(StmtVisitor &visitor) override;
 };
 
 struct While : Stmt, public std::enable_shared_from_this<While>
 {
-    const std::shared_ptr<Expr> condition;
-    const std::shared_ptr<Stmt> body;
-
-    While(std::shared_ptr<Expr> condition, std::shared_ptr<Stmt> body);
-
-    std::any accept(StmtVisitor &visitor) override;
+    std::shared_ptr<Expr> condition;
+    std::shared_ptr<Stmt> body;
+    // evaluated after every iteration, including one cut short by "continue"; set for desugared for loops
+    std::shared_ptr<Expr> increment;
+    // set by the Resolver when the body declares locals that nothing captures: one scope serves every iteration
+    std::shared_ptr<Block> body_scope;
+    // slots of the enclosing frame caching the loop's Invariant expressions, emptied whenever the loop is entered
+    std::vector<uint32_t> invariant_slots;
+    // with --jit: iterations run so far, and the loop's machine code once it got hot enough to compile
+    uint32_t back_edges = 0;
+    std::shared_ptr<NativeLoop> native;
+
+    While(std::shared_ptr<Expr> condition, std::shared_ptr<Stmt> body, std::shared_ptr<Expr> increment = nullptr);
+
+    Value accept(StmtVisitor &visitor) override;
 };
 
 struct Break : Stmt, public std::enable_shared_from_this<Break>
@@ -121,7 +145,7 @@ struct Break : Stmt, public std::enable_shared_from_this<Break>
 
     explicit Break(Token break_tok);
 
-    std::any accept(StmtVisitor &visitor) override;
+    Value accept(StmtVisitor &visitor) override;
 };
 
 struct Continue : Stmt, public std::enable_shared_from_this<Continue>
@@ -130,31 +154,49 @@ struct Continue : Stmt, public std::enable_shared_from_this<Continue>
 
     explicit Continue(Token continue_tok);
 
-    std::any accept(StmtVisitor &visitor) override;
+    Value accept(StmtVisitor &visitor) override;
+};
+
+// a variable a closure takes from where it is created, and the slot of the closure's frame it goes in
+struct Capture
+{
+    Resolution source;
+    uint32_t slot;
 };
 
 struct Function : Stmt, public std::enable_shared_from_this<Function>
 {
     const Token name;
     const std::vector<Token> params;
-    const std::list<std::shared_ptr<Stmt>> body;
+    std::list<std::shared_ptr<Stmt>> body;
     const bool is_sig;
     const bool is_fixed;
+    int32_t slot = -1;
+    uint32_t slot_count = 0;
+    // parameters occupy consecutive slots starting here; methods start at 1, after the receiver
+    uint32_t param_slot = 0;
+    // cleared by the Resolver when nothing can hold on to the call's frame after it returns
+    bool escapes = true;
+    // locals captured by inner closures, which hold a box rather than the value
+    std::vector<uint32_t> boxed_slots;
+    std::vector<Capture> captures;
+    // set by the Resolver when the function's name is assigned to, so calls through the name can't be inlined
+    bool is_rebound = false;
 
     Function(Token name, std::vector<Token> params, std::list<std::shared_ptr<Stmt>> body, bool is_sig,
              bool is_fixed);
 
-    std::any accept(StmtVisitor &visitor) override;
+    Value accept(StmtVisitor &visitor) override;
 };
 
 struct Return : Stmt, public std::enable_shared_from_this<Return>
 {
     const Token keyword;
-    const std::shared_ptr<Expr> value;
+    std::shared_ptr<Expr> value;
 
     Return(Token keyword, std::shared_ptr<Expr> value);
 
-    std::any accept(StmtVisitor &visitor) override;
+    Value accept(StmtVisitor &visitor) override;
 };
 
 struct Import : Stmt, public std::enable_shared_from_this<Import>
@@ -163,7 +205,7 @@ struct Import : Stmt, public std::enable_shared_from_this<Import>
 
     explicit Import(std::shared_ptr<Expr> script);
 
-    std::any accept(StmtVisitor &visitor) override;
+    Value accept(StmtVisitor &visitor) override;
 };
 
 struct Class : Stmt, public std::enable_shared_from_this<Class>
@@ -173,33 +215,49 @@ struct Class : Stmt, public std::enable_shared_from_this<Class>
     const std::vector<std::shared_ptr<Function>> instance_methods;
     const std::vector<std::shared_ptr<Function>> class_methods;
     const bool is_fixed;
+    int32_t slot = -1;
 
     Class(Token name, std::vector<std::shared_ptr<Function>> instance_methods,
           std::vector<std::shared_ptr<Function>> class_methods, std::shared_ptr<Expr> superclass,
           bool is_fixed);
 
-    std::any accept(StmtVisitor &visitor) override;
+    Value accept(StmtVisitor &visitor) override;
 };
 
 struct Namespace : Stmt, public std::enable_shared_from_this<Namespace>
 {
     const Token name;
     const bool is_fixed;
-    const std::list<std::shared_ptr<Stmt>> statements;
+    std::list<std::shared_ptr<Stmt>> statements;
+    int32_t slot = -1;
+    uint32_t slot_count = 0;
+    std::vector<uint32_t> boxed_slots;
+    std::unordered_map<std::string, uint32_t> member_slots;
 
     Namespace(Token name, std::list<std::shared_ptr<Stmt>> statements, bool is_fixed);
 
-    std::any accept(StmtVisitor &visitor) override;
+    Value accept(StmtVisitor &visitor) override;
 };
 
 struct Halt : Stmt, public std::enable_shared_from_this<Halt>
 {
     const Token keyword;
-    const std::shared_ptr<Expr> message;
+    std::shared_ptr<Expr> message;
 
     Halt(Token keyword, std::shared_ptr<Expr> message);
 
-    std::any accept(StmtVisitor &visitor) override;
+    Value accept(StmtVisitor &visitor) override;
+};
+
+// Put in place of statements by the ClosureCompiler (--closures): the Interpreter runs their closures rather than
+// visiting them
+struct Compiled : Stmt, public std::enable_shared_from_this<Compiled>
+{
+    const std::shared_ptr<StmtCode> code;
+
+    explicit Compiled(std::shared_ptr<StmtCode> code);
+
+    Value accept(StmtVisitor &visitor) override;
 };
 
 #endif // SURPHER_STMT_HPP
@@ -4,14 +4,31 @@
 #include <sstream>
 #include <vector>
 #include <fstream>
+#include <stdexcept>
 
 #include "Lexer.hpp"
 #include "Parser.hpp"
 #include "Error.hpp"
 #include "Interpreter.hpp"
 #include "Resolver.hpp"
+#include "Optimizer.hpp"
+#include "ClosureCompiler.hpp"
+#include "Compiler.hpp"
+#include "VM.hpp"
+
+enum class Backend {
+    TREE_WALK = 0,
+    BYTECODE,
+    CLOSURES
+};
 
 Interpreter interpreter;
+VM vm{interpreter};
+Backend backend = Backend::TREE_WALK;
+uint32_t optimization_level = Optimizer::MAX_LEVEL;
+size_t inline_budget = Optimizer::DEFAULT_INLINE_BUDGET;
+bool dump_constants = false;
+bool dump_passes = false;
 void run(const std::string &source);
 
 void runScript(const std::string &path) {
@@ -38,15 +55,31 @@ void run(const std::string &source) {
     Parser parser{tokens};
     std::list<std::shared_ptr<Stmt>> script {parser.parse()};
 
-    interpreter.appendScriptFront(script);
-
     if (had_error) return;
 
-    Resolver resolver(interpreter);
+    Resolver resolver(interpreter.globals);
     resolver.resolve(script);
 
     if (had_error) return;
 
+    // the compiler finds locals by name, which inlined parameters no longer have
+    size_t budget(backend == Backend::BYTECODE ? 0 : inline_budget);
+    Optimizer(interpreter, optimization_level, budget, dump_constants, dump_passes).optimize(script);
+
+    if (backend == Backend::BYTECODE) {
+        try {
+            vm.interpret(Compiler().compile(script));
+            return;
+        } catch (UnsupportedError &e) {
+            // the script uses a feature the compiler can't handle yet; fall back to the tree-walker
+        }
+    }
+
+    if (backend == Backend::CLOSURES) {
+        ClosureCompiler().run(script);
+    }
+
+    interpreter.appendScriptFront(script);
     try {
         interpreter.interpret();
     } catch (ImportError &e) {
@@ -80,11 +113,48 @@ void runRepl() {
 }
 
 int main(int argc, char *argv[]) {
-    if(argc == 1){
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; i++) {
+        std::string arg(argv[i]);
+        if (arg == "--vm") {
+            backend = Backend::BYTECODE;
+        } else if (arg == "--closures") {
+            backend = Backend::CLOSURES;
+        } else if (arg == "--jit") {
+            interpreter.jit = true;
+        } else if (arg == "--dump-constants") {
+            dump_constants = true;
+        } else if (arg == "--dump-passes") {
+            dump_passes = true;
+        } else if (arg.size() == 3 && arg.substr(0, 2) == "-O" && arg[2] >= '0' &&
+                   static_cast<uint32_t>(arg[2] - '0') <= Optimizer::MAX_LEVEL) {
+            optimization_level = arg[2] - '0';
+        } else if (arg.substr(0, 16) == "--inline-budget=") {
+            std::string budget(arg.substr(16));
+            try {
+                if (budget.empty() || budget.find_first_not_of("0123456789") != std::string::npos)
+                    throw std::invalid_argument(budget);
+                inline_budget = std::stoul(budget);
+            } catch (std::invalid_argument &) {
+                std::cerr << "Invalid inline budget " << budget << "\n";
+                return 64;
+            } catch (std::out_of_range &) {
+                std::cerr << "Inline budget " << budget << " is out of range\n";
+                return 64;
+            }
+        } else if (arg[0] == '-') {
+            std::cerr << "Unknown option " << arg << "\n";
+            return 64;
+        } else {
+            paths.emplace_back(arg);
+        }
+    }
+
+    if(paths.empty()){
         runRepl();
-    }else if(argc == 2){
-        runScript(argv[1]);
+    }else if(paths.size() == 1){
+        runScript(paths.front());
     }else{
-        std::cerr << "Usage: Surpher [path to script]*\n";
+        std::cerr << "Usage: Surpher [--vm|--closures] [--jit] [-O0|-O1|-O2] [--inline-budget=<nodes>] [--dump-constants] [--dump-passes] [path to script]*\n";
     }
 }
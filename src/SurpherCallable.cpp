@@ -1,6 +1,5 @@
 #include <utility>
 #include <fstream>
-#include <execution>
 #include <cmath>
 
 #include "SurpherCallable.hpp"
@@ -9,41 +8,42 @@
 
 using namespace std::string_literals;
 
-SurpherFunction::SurpherFunction(std::shared_ptr<Function> declaration, std::shared_ptr<Environment> closure,
-                                 bool is_initializer, bool is_partial) : is_sig(declaration->is_sig), declaration(std::move(declaration)),
-                                                                         closure(std::move(closure)), is_initializer(is_initializer),
-                                                                         is_partial(is_partial)
+SurpherFunction::SurpherFunction(std::shared_ptr<Function> declaration, std::vector<Ref<SurpherBox>> captures,
+                                 bool is_initializer, Ref<SurpherInstance> receiver)
+    : is_initializer(is_initializer), is_sig(declaration->is_sig), captures(std::move(captures)),
+      declaration(std::move(declaration)), receiver(std::move(receiver))
 {
 }
 
-std::any SurpherFunction::call(Interpreter &interpreter, const std::vector<std::any> &arguments)
+Value SurpherFunction::call(Interpreter &interpreter, const std::vector<Value> &arguments)
 {
-    auto environment{is_partial ? closure : std::make_shared<Environment>(closure)};
+    return invoke(interpreter, receiver, arguments);
+}
 
-#pragma omp parallel for
-    {
-        for (size_t i = 0; i < declaration->params.size(); i++)
-        {
-            environment->define(declaration->params[i], arguments[i], false);
-        }
-    }
+Value SurpherFunction::invoke(Interpreter &interpreter, const Ref<SurpherInstance> &instance,
+                              const std::vector<Value> &arguments)
+{
+    auto environment{interpreter.newFrame(nullptr, declaration->slot_count, declaration->escapes,
+                                          declaration->boxed_slots)};
+    for (size_t i = 0; i < captures.size(); i++)
+        environment->bindBox(declaration->captures[i].slot, captures[i]);
+
+    if (instance)
+        environment->defineAt(0, instance, true);
 
-    try
+    for (size_t i = 0; i < declaration->params.size(); i++)
     {
-        interpreter.executeBlock(declaration->body, environment);
+        environment->defineAt(declaration->param_slot + i, arguments[i], false);
     }
-    catch (ReturnError &returnVal)
-    {
-        if (is_initializer)
-            return closure->getAt(0, "this");
 
-        return returnVal.value;
-    }
+    Value return_value;
+    if (interpreter.executeBlock(declaration->body, environment) == Interpreter::Completion::RETURN)
+        return_value = interpreter.takeReturnValue();
 
     if (is_initializer)
-        return closure->getAt(0, "this");
+        return instance;
 
-    return {};
+    return return_value;
 }
 
 uint32_t SurpherFunction::arity()
@@ -59,35 +59,86 @@ std::string SurpherFunction::SurpherCallableToString()
     return "<function "s + declaration->name.lexeme + ">"s + " at: "s + self_addr.str();
 }
 
-std::shared_ptr<SurpherCallable> SurpherFunction::bind(const std::shared_ptr<SurpherInstance> &instance)
+Ref<SurpherCallable> SurpherFunction::bind(const Ref<SurpherInstance> &instance)
+{
+    return makeRef<SurpherFunction>(declaration, captures, is_initializer, instance);
+}
+
+PartialFunction::PartialFunction(Ref<SurpherFunction> function, Ref<SurpherInstance> receiver,
+                                 std::vector<Value> arguments)
+    : function(std::move(function)), receiver(std::move(receiver)), arguments(std::move(arguments))
 {
-    auto environment = std::make_shared<Environment>(closure);
-    environment->define("this", instance, true);
-    return std::make_shared<SurpherFunction>(declaration, std::move(environment), is_initializer, is_partial);
 }
 
-SurpherClass::SurpherClass(std::string name, std::unordered_map<std::string, std::shared_ptr<SurpherCallable>> instance_methods,
-                           std::unordered_map<std::string, std::shared_ptr<SurpherCallable>> class_methods,
-                           std::shared_ptr<SurpherCallable> superclass) : SurpherInstance(nullptr), name(std::move(name)), instance_methods(std::move(instance_methods)),
-                                                                          class_methods(std::move(class_methods)),
-                                                                          superclass(std::move(superclass))
+uint32_t PartialFunction::arity()
 {
+    return function->arity() - arguments.size();
 }
 
-std::any SurpherClass::call(Interpreter &interpreter, const std::vector<std::any> &arguments)
+Value PartialFunction::call(Interpreter &interpreter, const std::vector<Value> &rest)
 {
-    auto instance(std::make_shared<SurpherInstance>(std::make_shared<SurpherClass>(*this)));
-    auto initializer(findInstanceMethod("init"));
+    std::vector<Value> all_arguments(arguments);
+    all_arguments.insert(all_arguments.end(), rest.begin(), rest.end());
+    return function->invoke(interpreter, receiver, all_arguments);
+}
+
+std::string PartialFunction::SurpherCallableToString()
+{
+    void *self = this;
+    std::ostringstream self_addr;
+    self_addr << self;
+    return "<function partial-"s + function->declaration->name.lexeme + ">"s + " at: "s + self_addr.str();
+}
+
+// name and arity of each Protocol, in enum order
+static const std::pair<SymbolId, uint32_t> protocol_signatures[static_cast<size_t>(Protocol::COUNT)]{
+    {intern("__sizeOf__"), 0},
+    {intern("__equals__"), 2},
+    {intern("__toString__"), 0}};
+
+SurpherClass::SurpherClass(std::string name, std::unordered_map<std::string, Ref<SurpherCallable>> own_instance_methods,
+                           std::unordered_map<std::string, Ref<SurpherCallable>> own_class_methods,
+                           Ref<SurpherCallable> superclass) : name(std::move(name)), superclass(std::move(superclass))
+{
+    if (this->superclass != nullptr)
+    {
+        auto super_class(staticRefCast<SurpherClass>(this->superclass));
+        instance_methods = super_class->instance_methods;
+        class_methods = super_class->class_methods;
+    }
+
+    for (auto &method : own_instance_methods)
+        instance_methods[intern(method.first)] = std::move(method.second);
+    for (auto &method : own_class_methods)
+        class_methods[intern(method.first)] = std::move(method.second);
+
+    static const SymbolId init_id(intern("init"));
+    initializer = findInstanceMethod(init_id);
+
+    for (size_t i = 0; i < protocols.size(); i++)
+    {
+        auto method(findInstanceMethod(protocol_signatures[i].first));
+        if (!method)
+            continue;
+
+        auto function(staticRefCast<SurpherFunction>(method));
+        if (!function->is_sig && function->arity() == protocol_signatures[i].second)
+            protocols[i] = std::move(function);
+    }
+}
+
+Value SurpherClass::call(Interpreter &interpreter, const std::vector<Value> &arguments)
+{
+    auto instance(makeRef<SurpherInstance>(Ref<SurpherClass>(this)));
 
     if (initializer)
-        dynamic_cast<SurpherFunction *>(initializer.get())->bind(instance)->call(interpreter, arguments);
+        static_cast<SurpherFunction *>(initializer.get())->invoke(interpreter, instance, arguments);
 
     return instance;
 }
 
 uint32_t SurpherClass::arity()
 {
-    auto initializer(findInstanceMethod("init"));
     if (initializer == nullptr)
         return 0;
 
@@ -102,24 +153,39 @@ std::string SurpherClass::SurpherCallableToString()
     return "<class " + name + ">" + " at: "s + self_addr.str();
 }
 
-std::shared_ptr<SurpherCallable> SurpherClass::findInstanceMethod(const std::string &methodName)
+Ref<SurpherCallable> SurpherClass::findInstanceMethod(SymbolId method_name)
 {
-    if (instance_methods.find(methodName) != instance_methods.end())
-        return instance_methods[methodName];
+    auto method_iter(instance_methods.find(method_name));
+    if (method_iter != instance_methods.end())
+        return method_iter->second;
 
-    if (superclass != nullptr)
-        return std::dynamic_pointer_cast<SurpherClass>(superclass)->findInstanceMethod(methodName);
+    return {};
+}
+
+Ref<SurpherCallable> SurpherClass::findClassMethod(SymbolId method_name)
+{
+    auto method_iter(class_methods.find(method_name));
+    if (method_iter != class_methods.end())
+        return method_iter->second;
 
     return {};
 }
 
-std::shared_ptr<SurpherCallable> SurpherClass::findClassMethod(const std::string &methodName)
+SurpherFunction *SurpherClass::findProtocol(Protocol protocol) const
+{
+    return protocols[static_cast<size_t>(protocol)].get();
+}
+
+Value SurpherClass::get(const Token &name)
 {
-    if (class_methods.find(methodName) != class_methods.end())
-        return class_methods[methodName];
+    return get(name, intern(name.lexeme));
+}
 
-    if (superclass != nullptr)
-        return std::dynamic_pointer_cast<SurpherClass>(superclass)->findClassMethod(methodName);
+Value SurpherClass::get(const Token &name, SymbolId name_id)
+{
+    Ref<SurpherCallable> method(findClassMethod(name_id));
+    if (method != nullptr)
+        return method;
 
-    return {};
-}
\ No newline at end of file
+    throw RuntimeError(name, "Undefined class method '" + name.lexeme + "'.");
+}
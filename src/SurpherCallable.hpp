@@ -2,10 +2,10 @@
 #define SURPHER_SURPHERCALLABLE_HPP
 
 #include <vector>
-#include <any>
 #include <string>
 #include <sstream>
 #include <memory>
+#include <array>
 
 #include "Stmt.hpp"
 #include "Environment.hpp"
@@ -13,51 +13,94 @@
 
 class Interpreter;
 
-struct SurpherCallable
+struct SurpherCallable : Object
 {
+    static constexpr ValueType value_type = ValueType::CALLABLE;
+
     virtual uint32_t arity() = 0;
-    virtual std::any call(Interpreter &interpreter, const std::vector<std::any> &arguments) = 0;
+    virtual Value call(Interpreter &interpreter, const std::vector<Value> &arguments) = 0;
     virtual std::string SurpherCallableToString() = 0;
 };
 
 struct SurpherFunction : SurpherCallable
 {
     const bool is_initializer;
-    const bool is_partial;
     const bool is_sig;
-    const std::shared_ptr<Environment> closure;
+    // one box per entry of declaration->captures
+    const std::vector<Ref<SurpherBox>> captures;
     const std::shared_ptr<Function> declaration;
+    // the instance a bound method was taken from; occupies slot 0 of every call frame
+    const Ref<SurpherInstance> receiver;
+
+    SurpherFunction(std::shared_ptr<Function> declaration, std::vector<Ref<SurpherBox>> captures, bool is_initializer,
+                    Ref<SurpherInstance> receiver = {});
+    uint32_t arity() override;
+    Value call(Interpreter &interpreter, const std::vector<Value> &arguments) override;
+    Value invoke(Interpreter &interpreter, const Ref<SurpherInstance> &instance, const std::vector<Value> &arguments);
+    std::string SurpherCallableToString() override;
+
+    Ref<SurpherCallable> bind(const Ref<SurpherInstance> &instance);
+};
+
+// A function applied to fewer arguments than it takes: remembers the prefix and forwards once the rest arrive
+struct PartialFunction : SurpherCallable
+{
+    const Ref<SurpherFunction> function;
+    const Ref<SurpherInstance> receiver;
+    const std::vector<Value> arguments;
 
-    SurpherFunction(std::shared_ptr<Function> declaration, std::shared_ptr<Environment> closure, bool is_initializer, bool is_partial);
+    PartialFunction(Ref<SurpherFunction> function, Ref<SurpherInstance> receiver, std::vector<Value> arguments);
     uint32_t arity() override;
-    std::any call(Interpreter &interpreter, const std::vector<std::any> &arguments) override;
+    Value call(Interpreter &interpreter, const std::vector<Value> &rest) override;
     std::string SurpherCallableToString() override;
+};
 
-    std::shared_ptr<SurpherCallable> bind(const std::shared_ptr<SurpherInstance> &instance);
+// Methods the runtime calls on an instance's behalf. A new protocol needs an entry here and in protocol_signatures.
+enum class Protocol : uint8_t
+{
+    SIZE_OF = 0,
+    EQUALS,
+    TO_STRING,
+    COUNT
 };
 
-struct SurpherClass : SurpherCallable, SurpherInstance
+struct SurpherClass : SurpherCallable
 {
     const std::string name;
 
-    std::unordered_map<std::string, std::shared_ptr<SurpherCallable>> instance_methods;
+    // inheritance is resolved once when the class is defined: inherited methods are copied in, then overridden
+    std::unordered_map<SymbolId, Ref<SurpherCallable>> instance_methods;
+
+    std::unordered_map<SymbolId, Ref<SurpherCallable>> class_methods;
+
+    Ref<SurpherCallable> superclass;
 
-    std::unordered_map<std::string, std::shared_ptr<SurpherCallable>> class_methods;
+    Ref<SurpherCallable> initializer;
 
-    std::shared_ptr<SurpherCallable> superclass;
+    // filled from the method table when the class is defined; empty unless the method exists with the expected arity
+    std::array<Ref<SurpherFunction>, static_cast<size_t>(Protocol::COUNT)> protocols;
 
-    SurpherClass(std::string name, std::unordered_map<std::string, std::shared_ptr<SurpherCallable>> instance_methods,
-                 std::unordered_map<std::string, std::shared_ptr<SurpherCallable>> class_methods,
-                 std::shared_ptr<SurpherCallable> superclass);
+    // every instance starts out on this shape
+    Ref<Shape> root_shape{makeRef<Shape>()};
+
+    SurpherClass(std::string name, std::unordered_map<std::string, Ref<SurpherCallable>> instance_methods,
+                 std::unordered_map<std::string, Ref<SurpherCallable>> class_methods,
+                 Ref<SurpherCallable> superclass);
 
     uint32_t arity() override;
 
-    std::any call(Interpreter &interpreter, const std::vector<std::any> &arguments) override;
+    Value call(Interpreter &interpreter, const std::vector<Value> &arguments) override;
 
     std::string SurpherCallableToString() override;
 
-    std::shared_ptr<SurpherCallable> findInstanceMethod(const std::string &methodName);
+    Ref<SurpherCallable> findInstanceMethod(SymbolId method_name);
+
+    Ref<SurpherCallable> findClassMethod(SymbolId method_name);
+
+    SurpherFunction *findProtocol(Protocol protocol) const;
+
+    Value get(const Token &name);
 
-    std::shared_ptr<SurpherCallable> findClassMethod(const std::string &methodName);
+    Value get(const Token &name, SymbolId name_id);
 };
 #endif // SURPHER_SURPHERCALLABLE_HPP
@@ -7,41 +7,80 @@
 #include "Error.hpp"
 
 
-SurpherInstance::SurpherInstance(std::shared_ptr<SurpherClass> surpher_class) : surpher_class(
-        std::move(surpher_class)) {
+SurpherInstance::SurpherInstance(Ref<SurpherClass> surpher_class) : surpher_class(
+        std::move(surpher_class)), shape(this->surpher_class->root_shape) {
 }
 
+SurpherInstance::~SurpherInstance() = default;
+
 std::string SurpherInstance::SurpherInstanceToString() {
     void* self = this;
     std::ostringstream self_addr;
     self_addr << self;
-    if(surpher_class){
-        return "<" + surpher_class->name + " instance>" + " at: " + self_addr.str();
-    }else{
-        return "<" + dynamic_cast<SurpherClass *>(this)->name + " instance>" + " at: " + self_addr.str();
-    }
+    return "<" + surpher_class->name + " instance>" + " at: " + self_addr.str();
 }
 
-std::any SurpherInstance::get(const Token &name) {
-    if (fields.find(name.lexeme) != fields.end()) {
-        return fields[name.lexeme];
-    }
+Value SurpherInstance::get(const Token &name) {
+    PropertyCache cache;
+    return get(name, intern(name.lexeme), cache);
+}
 
-    if (!dynamic_cast<SurpherClass *>(this)) {
-        std::shared_ptr<SurpherCallable> method(surpher_class->findInstanceMethod(name.lexeme));
-        if (method != nullptr) return dynamic_cast<SurpherFunction *>(method.get())->bind(shared_from_this());
+Value SurpherInstance::get(const Token &name, SymbolId name_id, PropertyCache &cache) {
+    SurpherFunction *method = nullptr;
+    Value value(getUnbound(name, name_id, cache, method));
+    if (method != nullptr) return method->bind(Ref<SurpherInstance>(this));
 
-        throw RuntimeError(name, "Undefined property '" + name.lexeme + "'.");
-    } else {
-        std::shared_ptr<SurpherCallable> method(dynamic_cast<SurpherClass *>(this)->findClassMethod(name.lexeme));
-        if (method != nullptr) return method;
+    return value;
+}
+
+Value SurpherInstance::getUnbound(const Token &name, SymbolId name_id, PropertyCache &cache, SurpherFunction *&method) {
+    if (auto entry = cache.find(shape.get())) {
+        method = entry->method;
+        if (method == nullptr) return fields[entry->slot];
+        return {};
+    }
 
-        throw RuntimeError(name, "Undefined class method '" + name.lexeme + "'.");
+    auto slot(shape->findField(name_id));
+    if (slot >= 0) {
+        cache.insert({shape, static_cast<uint32_t>(slot), nullptr, nullptr});
+        return fields[slot];
     }
+
+    Ref<SurpherCallable> instance_method(surpher_class->findInstanceMethod(name_id));
+    if (instance_method != nullptr) {
+        method = static_cast<SurpherFunction *>(instance_method.get());
+        cache.insert({shape, 0, nullptr, method});
+        return {};
+    }
+
+    throw RuntimeError(name, "Undefined property '" + name.lexeme + "'.");
+}
+
+void SurpherInstance::set(const Token &name, const Value &value) {
+    PropertyCache cache;
+    set(intern(name.lexeme), value, cache);
 }
 
-void SurpherInstance::set(const Token &name, const std::any &value) {
-    if (dynamic_cast<SurpherClass *>(this)) throw RuntimeError(name, "Cannot set property to a class.");
+void SurpherInstance::set(SymbolId name_id, const Value &value, PropertyCache &cache) {
+    if (auto entry = cache.find(shape.get())) {
+        if (entry->next_shape) {
+            shape = entry->next_shape;
+            fields.push_back(value);
+        } else {
+            fields[entry->slot] = value;
+        }
+        return;
+    }
+
+    auto slot(shape->findField(name_id));
+    if (slot >= 0) {
+        cache.insert({shape, static_cast<uint32_t>(slot), nullptr, nullptr});
+        fields[slot] = value;
+        return;
+    }
 
-    fields[name.lexeme] = value;
+    auto next_shape(shape->addField(name_id));
+    cache.insert({shape, static_cast<uint32_t>(fields.size()), next_shape, nullptr});
+    shape = std::move(next_shape);
+    fields.push_back(value);
 }
@@ -4,22 +4,36 @@
 #include <unordered_map>
 #include <vector>
 #include <memory>
-#include <any>
+
+#include "Value.hpp"
+#include "Shape.hpp"
 
 struct SurpherClass;
 struct Token;
 
-struct SurpherInstance : public std::enable_shared_from_this<SurpherInstance> {
-    const std::shared_ptr<SurpherClass> surpher_class;
-    std::unordered_map<std::string, std::any> fields;
+struct SurpherInstance : Object {
+    static constexpr ValueType value_type = ValueType::INSTANCE;
+
+    const Ref<SurpherClass> surpher_class;
+    Ref<Shape> shape;
+    std::vector<Value> fields;
+
+    explicit SurpherInstance(Ref<SurpherClass> surpher_class);
 
-    explicit SurpherInstance(std::shared_ptr<SurpherClass> surpher_class);
+    ~SurpherInstance() override;
 
     virtual std::string SurpherInstanceToString();
 
-    std::any get(const Token &name);
+    Value get(const Token &name);
+
+    Value get(const Token &name, SymbolId name_id, PropertyCache &cache);
+
+    // like get, but an instance method comes back unbound through `method` instead of as the returned value
+    Value getUnbound(const Token &name, SymbolId name_id, PropertyCache &cache, SurpherFunction *&method);
+
+    void set(const Token &name, const Value &value);
 
-    void set(const Token &name, const std::any &value);
+    void set(SymbolId name_id, const Value &value, PropertyCache &cache);
 };
 
 #endif //SURPHER_SURPHERINSTANCE_HPP
@@ -7,7 +7,9 @@
 #include "Error.hpp"
 
 
-SurpherNamespace::SurpherNamespace(std::string name, std::shared_ptr<Environment> module_environment) : name(std::move(name)), module_environment(std::move(module_environment)){
+SurpherNamespace::SurpherNamespace(std::string name, std::shared_ptr<Environment> module_environment,
+                                   std::unordered_map<std::string, uint32_t> member_slots) : name(std::move(name)), module_environment(std::move(module_environment)),
+                                                                                            member_slots(std::move(member_slots)){
 
 }
 
@@ -18,10 +20,26 @@ std::string SurpherNamespace::SurpherNamespaceToString() {
     return "<namespace " + name + ">" + " at: " + self_addr.str();;
 }
 
-std::any SurpherNamespace::get(const Token &var_name) {
+Value SurpherNamespace::get(const Token &var_name) {
+    auto slot_iter(member_slots.find(var_name.lexeme));
+    if (slot_iter != member_slots.end())
+        return module_environment->getAt(0, slot_iter->second);
+
     return module_environment->get(var_name);
 }
 
-void SurpherNamespace::set(const Token &var_name, const std::any &value) {
-    module_environment->assign(var_name, value);
+bool SurpherNamespace::getFixed(const std::string &var_name, Value &value) {
+    auto slot_iter(member_slots.find(var_name));
+    if (slot_iter != member_slots.end())
+        return module_environment->getFixedAt(slot_iter->second, value);
+
+    return module_environment->getFixed(var_name, value);
+}
+
+void SurpherNamespace::set(const Token &var_name, const Value &value) {
+    auto slot_iter(member_slots.find(var_name.lexeme));
+    if (slot_iter != member_slots.end())
+        module_environment->assignAt(0, slot_iter->second, var_name, value);
+    else
+        module_environment->assign(var_name, value);
 }
@@ -2,17 +2,24 @@
 #define SURPHER_SURPHERNAMESPACE_HPP
 
 #include <memory>
+#include <unordered_map>
 #include "Environment.hpp"
 
-struct SurpherNamespace {
+struct SurpherNamespace : Object {
+    static constexpr ValueType value_type = ValueType::NAMESPACE;
+
     const std::string name;
     const std::shared_ptr<Environment> module_environment;
+    const std::unordered_map<std::string, uint32_t> member_slots;
+
+    SurpherNamespace(std::string name, std::shared_ptr<Environment> module_environment,
+                     std::unordered_map<std::string, uint32_t> member_slots = {});
 
-    SurpherNamespace(std::string name, std::shared_ptr<Environment> module_environment);
+    Value get(const Token &var_name);
 
-    std::any get(const Token &var_name);
+    void set(const Token &var_name, const Value &value);
 
-    void set(const Token &var_name, const std::any &value);
+    bool getFixed(const std::string &var_name, Value &value);
 
     std::string SurpherNamespaceToString();
 };
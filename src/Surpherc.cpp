@@ -0,0 +1,45 @@
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "Transpiler.hpp"
+
+int main(int argc, char *argv[]) {
+    std::string path, output_path;
+    for (int i = 1; i < argc; i++) {
+        std::string arg(argv[i]);
+        if (arg == "-o" && i + 1 < argc) {
+            output_path = argv[++i];
+        } else if (arg[0] == '-' || !path.empty()) {
+            path.clear();
+            break;
+        } else {
+            path = arg;
+        }
+    }
+    if (path.empty() || output_path.empty()) {
+        std::cerr << "Usage: surpherc [path to script] -o [path to C++ output]\n";
+        return 64;
+    }
+
+    std::ifstream input_file(path);
+    if (input_file.fail()) {
+        std::cerr << "Failed to open file " << path << ": " << std::endl;
+        return 66;
+    }
+    std::stringstream source_code;
+    source_code << input_file.rdbuf();
+
+    std::ostringstream program;
+    if (!Transpiler::translate(path, source_code.str(), program)) {
+        return 65;
+    }
+
+    std::ofstream output_file(output_path);
+    output_file << program.str();
+    if (output_file.fail()) {
+        std::cerr << "Failed to write file " << output_path << std::endl;
+        return 73;
+    }
+}
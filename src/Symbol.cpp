@@ -0,0 +1,36 @@
+#include <unordered_map>
+#include <deque>
+
+#include "Symbol.hpp"
+
+// function-local so that interning from other translation units' static initializers is safe
+static std::unordered_map<std::string, SymbolId> &symbolIds()
+{
+    static std::unordered_map<std::string, SymbolId> symbol_ids;
+    return symbol_ids;
+}
+
+static std::deque<std::string> &symbolNames()
+{
+    static std::deque<std::string> symbol_names;
+    return symbol_names;
+}
+
+SymbolId intern(const std::string &name)
+{
+    auto &symbol_ids(symbolIds());
+    auto id_iter(symbol_ids.find(name));
+    if (id_iter != symbol_ids.end())
+        return id_iter->second;
+
+    auto &symbol_names(symbolNames());
+    SymbolId id(symbol_names.size());
+    symbol_names.push_back(name);
+    symbol_ids.emplace(name, id);
+    return id;
+}
+
+const std::string &symbolName(SymbolId id)
+{
+    return symbolNames()[id];
+}
@@ -0,0 +1,14 @@
+#ifndef SURPHER_SYMBOL_HPP
+#define SURPHER_SYMBOL_HPP
+
+#include <cstdint>
+#include <string>
+
+// Property and method names are interned once so that lookups hash and compare small integers.
+using SymbolId = uint32_t;
+
+SymbolId intern(const std::string &name);
+
+const std::string &symbolName(SymbolId id);
+
+#endif // SURPHER_SYMBOL_HPP
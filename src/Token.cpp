@@ -2,7 +2,7 @@
 
 #include "Token.hpp"
 
-Token::Token(std::string lexeme, std::any literal, const enum TokenType &token_type,
+Token::Token(std::string lexeme, Value literal, const enum TokenType &token_type,
              const uint32_t &line) : lexeme(std::move(lexeme)), literal(std::move(literal)), token_type(token_type),
                                      line(line)
 {
@@ -3,7 +3,7 @@
 
 #include <string>
 #include <iostream>
-#include <any>
+#include "Value.hpp"
 
 enum TokenType
 {
@@ -81,12 +81,12 @@ enum TokenType
 struct Token
 {
     std::string lexeme;
-    std::any literal;
+    Value literal;
     TokenType token_type;
     uint32_t line;
 
     Token() : lexeme(""), literal(), token_type(EOF_TOKEN), line(0) {}
-    Token(std::string lexeme, std::any literal, const enum TokenType &token_type, const uint32_t &line);
+    Token(std::string lexeme, Value literal, const enum TokenType &token_type, const uint32_t &line);
 };
 
 std::ostream &operator<<(std::ostream &strm, const Token &tok);
@@ -0,0 +1,364 @@
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <unordered_set>
+
+#include "Transpiler.hpp"
+#include "LoopCompiler.hpp"
+#include "Lexer.hpp"
+#include "Parser.hpp"
+#include "Error.hpp"
+#include "Interpreter.hpp"
+#include "Resolver.hpp"
+#include "Optimizer.hpp"
+#include "ClosureCompiler.hpp"
+
+namespace
+{
+    // the loops of a script in the order a walk over the tree meets them, which is how compiled loops are matched
+    // to the loops of the script the program parses when it starts
+    class LoopFinder : public OptimizationPass
+    {
+    public:
+        std::vector<std::shared_ptr<While>> loops;
+
+        Value visitWhileStmt(const std::shared_ptr<While> &stmt) override
+        {
+            loops.push_back(stmt);
+            return OptimizationPass::visitWhileStmt(stmt);
+        }
+    };
+
+    // Emits a loop as a C++ function on doubles. Registers and temporaries are locals, and so are the machine
+    // slots, copied in on entry and back out when the loop finishes; branches are gotos. Labels nothing jumps to are
+    // left out, so the output builds cleanly with -Wall.
+    class CppEmitter : public LoopEmitter
+    {
+        // the code before each bound label, and the label
+        std::vector<std::pair<std::string, Label>> blocks;
+        std::ostringstream body;
+        std::unordered_set<Label> jump_targets;
+        bool can_deoptimise = false;
+        bool returns_number = false;
+        uint32_t depth = 0;
+        uint32_t max_depth = 0;
+
+        static std::string number(double value)
+        {
+            if (std::isnan(value))
+                return "std::numeric_limits<double>::quiet_NaN()";
+            if (std::isinf(value))
+                return value < 0 ? "-std::numeric_limits<double>::infinity()"
+                                 : "std::numeric_limits<double>::infinity()";
+
+            std::ostringstream text;
+            text.precision(17);
+            text << value;
+            auto literal(text.str());
+            if (literal.find_first_of(".e") == std::string::npos)
+                literal += ".0";
+            return literal;
+        }
+
+        static std::string comparison(TokenType op)
+        {
+            switch (op)
+            {
+            case GREATER:
+                return "r0 > r1";
+            case GREATER_EQUAL:
+                return "r0 >= r1";
+            case LESS:
+                return "r0 < r1";
+            case LESS_EQUAL:
+                return "r0 <= r1";
+            case DOUBLE_EQUAL:
+                return "r0 == r1";
+            default:
+                return "r0 != r1";
+            }
+        }
+
+        static const char *status(NativeLoop::Status status)
+        {
+            switch (status)
+            {
+            case NativeLoop::FINISHED:
+                return "NativeLoop::FINISHED";
+            case NativeLoop::RETURNED_NUMBER:
+                return "NativeLoop::RETURNED_NUMBER";
+            case NativeLoop::RETURNED_NIL:
+                return "NativeLoop::RETURNED_NIL";
+            default:
+                return "NativeLoop::DEOPTIMISED";
+            }
+        }
+
+    public:
+        void loadNumber(uint8_t reg, double value) override
+        {
+            body << "        r" << +reg << " = " << number(value) << ";\n";
+        }
+
+        void loadSlot(uint8_t reg, uint32_t index) override
+        {
+            body << "        r" << +reg << " = v" << index << ";\n";
+        }
+
+        void storeSlot(uint32_t index) override
+        {
+            body << "        v" << index << " = r0;\n";
+        }
+
+        void push() override
+        {
+            body << "        t" << depth++ << " = r0;\n";
+            max_depth = std::max(max_depth, depth);
+        }
+
+        void pop(uint8_t reg) override
+        {
+            body << "        r" << +reg << " = t" << --depth << ";\n";
+        }
+
+        void move(uint8_t to, uint8_t from) override
+        {
+            body << "        r" << +to << " = r" << +from << ";\n";
+        }
+
+        void negate() override
+        {
+            body << "        r0 = -r0;\n";
+        }
+
+        void arithmetic(TokenType op) override
+        {
+            switch (op)
+            {
+            case PLUS:
+                body << "        r0 = r0 + r1;\n";
+                break;
+            case MINUS:
+                body << "        r0 = r0 - r1;\n";
+                break;
+            case STAR:
+                body << "        r0 = r0 * r1;\n";
+                break;
+            case SLASH:
+                can_deoptimise = true;
+                body << "        if (r1 == 0)\n            goto deoptimise;\n        r0 = r0 / r1;\n";
+                break;
+            default:
+                can_deoptimise = true;
+                body << "        if (r1 == 0)\n            goto deoptimise;\n        r0 = std::fmod(r0, r1);\n";
+                break;
+            }
+        }
+
+        void jumpIfComparison(TokenType op, bool jump_if, Label target) override
+        {
+            body << "        if (" << (jump_if ? comparison(op) : "!(" + comparison(op) + ")") << ")\n"
+                 << "            goto L" << target << ";\n";
+            jump_targets.insert(target);
+        }
+
+        void jump(Label target) override
+        {
+            body << "        goto L" << target << ";\n";
+            jump_targets.insert(target);
+        }
+
+        void bind(Label label) override
+        {
+            blocks.emplace_back(body.str(), label);
+            body.str("");
+        }
+
+        void exit(NativeLoop::Status loop_status) override
+        {
+            if (loop_status == NativeLoop::RETURNED_NUMBER)
+            {
+                returns_number = true;
+                body << "        *result = r0;\n";
+            }
+            body << "        status = " << status(loop_status) << ";\n        goto done;\n";
+        }
+
+        void function(std::ostream &out, size_t number, const LoopCompiler &compiler) const
+        {
+            out << "    int32_t loop" << number << "(double *slots, double *" << (returns_number ? "result" : "")
+                << ")\n    {\n";
+            out << "        double r0, r1;\n";
+            for (uint32_t i = 0; i < max_depth; i++)
+                out << "        double t" << i << ";\n";
+            for (uint32_t i = 0; i < compiler.slotCount(); i++)
+                out << "        double v" << i << " = slots[" << i << "];\n";
+            out << "        int32_t status;\n\n";
+            for (const auto &block : blocks)
+            {
+                out << block.first;
+                if (jump_targets.count(block.second))
+                    out << "    L" << block.second << ":\n";
+            }
+            out << body.str();
+            if (can_deoptimise)
+                out << "    deoptimise:\n        return NativeLoop::DEOPTIMISED;\n";
+            out << "    done:\n";
+            for (const auto &local : compiler.locals)
+            {
+                if (local.is_assigned)
+                    out << "        slots[" << local.index << "] = v" << local.index << ";\n";
+            }
+            out << "        return status;\n    }\n\n";
+        }
+    };
+
+    bool readFile(const std::string &path, std::string &source)
+    {
+        std::ifstream input_file(path);
+        if (input_file.fail())
+        {
+            std::cerr << "Failed to open file " << path << ": " << std::endl;
+            return false;
+        }
+        std::stringstream source_code;
+        source_code << input_file.rdbuf();
+        source = source_code.str();
+        return true;
+    }
+
+    // parses, resolves and optimises a script the way Surpher does by default
+    bool load(Interpreter &interpreter, const std::string &source, std::list<std::shared_ptr<Stmt>> &script)
+    {
+        Lexer lexer(source);
+        std::vector<Token> tokens{lexer.scanTokens()};
+        Parser parser{tokens};
+        script = parser.parse();
+        if (had_error)
+            return false;
+
+        Resolver resolver(interpreter.globals);
+        resolver.resolve(script);
+        if (had_error)
+            return false;
+
+        Optimizer(interpreter, Optimizer::MAX_LEVEL, Optimizer::DEFAULT_INLINE_BUDGET, false, false).optimize(script);
+        return true;
+    }
+
+    void writeString(std::ostream &out, const std::string &text)
+    {
+        out << "    const char source[] =\n        \"";
+        for (unsigned char c : text)
+        {
+            if (c == '\n')
+            {
+                out << "\\n\"\n        \"";
+            }
+            else if (c == '"' || c == '\\')
+            {
+                out << '\\' << c;
+            }
+            else if (c < 0x20 || c >= 0x7F)
+            {
+                const char *digits = "01234567";
+                out << '\\' << digits[c >> 6] << digits[(c >> 3) & 7] << digits[c & 7];
+            }
+            else
+            {
+                out << c;
+            }
+        }
+        out << "\";\n";
+    }
+}
+
+bool Transpiler::translate(const std::string &path, const std::string &source, std::ostream &out)
+{
+    Interpreter interpreter;
+    std::list<std::shared_ptr<Stmt>> script;
+    if (!load(interpreter, source, script))
+        return false;
+
+    LoopFinder finder;
+    finder.run(script);
+
+    out << "// Generated by surpherc from " << path << "\n\n";
+    out << "#include <cmath>\n#include <limits>\n\n#include \"Transpiler.hpp\"\n\nnamespace\n{\n";
+
+    // the table main passes to run, one entry per loop
+    std::ostringstream table;
+    for (size_t i = 0; i < finder.loops.size(); i++)
+    {
+        CppEmitter emitter;
+        LoopCompiler compiler(emitter);
+        if (!compiler.compile(*finder.loops[i]))
+        {
+            table << "        {nullptr, {}, 0},\n";
+            continue;
+        }
+        emitter.function(out, i, compiler);
+
+        table << "        {loop" << i << ", {";
+        for (const auto &local : compiler.locals)
+        {
+            table << "{" << local.distance << ", " << local.slot << ", " << local.index << ", "
+                  << (local.is_assigned ? "true" : "false") << "}, ";
+        }
+        table << "}, " << compiler.slotCount() << "},\n";
+    }
+    writeString(out, source);
+    out << "}\n\nint main()\n{\n    return Transpiler::run(std::string(source, sizeof(source) - 1), {\n";
+    out << table.str();
+    out << "    });\n}\n";
+    return true;
+}
+
+int Transpiler::run(const std::string &source, const std::vector<CompiledLoop> &loops)
+{
+    Interpreter interpreter;
+    std::list<std::shared_ptr<Stmt>> script;
+    if (!load(interpreter, source, script))
+        return 65;
+
+    LoopFinder finder;
+    finder.run(script);
+    if (finder.loops.size() != loops.size())
+    {
+        std::cerr << "The compiled loops don't match the script; it was translated by a different surpherc.\n";
+        return 70;
+    }
+    for (size_t i = 0; i < loops.size(); i++)
+    {
+        if (loops[i].entry != nullptr)
+            finder.loops[i]->native = NativeLoop::wrap(loops[i].entry, loops[i].locals, loops[i].slot_count);
+    }
+
+    ClosureCompiler().run(script);
+    interpreter.appendScriptFront(script);
+
+    // an import runs the imported script first, then what is left of the one importing it
+    size_t pending(1);
+    while (pending > 0)
+    {
+        try
+        {
+            interpreter.interpret();
+            pending--;
+        }
+        catch (ImportError &e)
+        {
+            std::string imported_source;
+            std::list<std::shared_ptr<Stmt>> imported;
+            if (readFile(e.script, imported_source) && load(interpreter, imported_source, imported))
+            {
+                ClosureCompiler().run(imported);
+                interpreter.appendScriptFront(imported);
+                pending++;
+            }
+        }
+    }
+    return had_runtime_error ? 70 : 0;
+}
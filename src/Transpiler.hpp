@@ -0,0 +1,31 @@
+#ifndef SURPHER_TRANSPILER_HPP
+#define SURPHER_TRANSPILER_HPP
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "NativeLoop.hpp"
+
+// Translates a script into a C++ program that runs it on the runtime library. The loops the JIT would compile
+// become C++ functions on doubles, built by the host compiler. The rest of the script is embedded as source and run
+// on the closure backend when the program starts, with the compiled loops put in place of the interpreted ones.
+class Transpiler
+{
+public:
+    // a loop as compiled by the host compiler; entry is null for a loop that has to be interpreted
+    struct CompiledLoop
+    {
+        NativeLoop::Entry entry;
+        std::vector<NativeLoop::Local> locals;
+        uint32_t slot_count;
+    };
+
+    // writes the program for the script at path; false when the script has errors, which have been reported
+    static bool translate(const std::string &path, const std::string &source, std::ostream &out);
+
+    // what the main of a translated program calls: runs the script with its compiled loops
+    static int run(const std::string &source, const std::vector<CompiledLoop> &loops);
+};
+
+#endif // SURPHER_TRANSPILER_HPP
@@ -0,0 +1,600 @@
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <iterator>
+
+#include "VM.hpp"
+#include "Interpreter.hpp"
+#include "Error.hpp"
+#include "SurpherInstance.hpp"
+#include "SurpherNamespace.hpp"
+
+using namespace std::string_literals;
+
+static Token lineToken(uint32_t line)
+{
+    return Token("", {}, EOF_TOKEN, line);
+}
+
+VMUpvalue::VMUpvalue(Value *location) : location(location)
+{
+}
+
+VMClosure::VMClosure(VM &vm, std::shared_ptr<FunctionProto> proto) : vm(vm), proto(std::move(proto))
+{
+}
+
+uint32_t VMClosure::arity()
+{
+    return proto->arity;
+}
+
+Value VMClosure::call(Interpreter &interpreter, const std::vector<Value> &arguments)
+{
+    return vm.callClosure(*this, arguments);
+}
+
+std::string VMClosure::SurpherCallableToString()
+{
+    void *self = this;
+    std::ostringstream self_addr;
+    self_addr << self;
+    return "<function "s + proto->name + ">"s + " at: "s + self_addr.str();
+}
+
+VMPartial::VMPartial(Ref<SurpherCallable> callee, std::vector<Value> bound_arguments)
+    : callee(std::move(callee)), bound_arguments(std::move(bound_arguments))
+{
+}
+
+uint32_t VMPartial::arity()
+{
+    return callee->arity() - bound_arguments.size();
+}
+
+Value VMPartial::call(Interpreter &interpreter, const std::vector<Value> &arguments)
+{
+    std::vector<Value> all_arguments(bound_arguments);
+    all_arguments.insert(all_arguments.end(), arguments.begin(), arguments.end());
+    return callee->call(interpreter, all_arguments);
+}
+
+// the same text as a PartialFunction's, so a script prints the same on every backend
+std::string VMPartial::SurpherCallableToString()
+{
+    SurpherCallable *function(callee.get());
+    while (auto partial = dynamic_cast<VMPartial *>(function))
+        function = partial->callee.get();
+
+    std::string name;
+    if (auto closure = dynamic_cast<VMClosure *>(function))
+        name = closure->proto->name;
+    else
+        name = static_cast<SurpherFunction *>(function)->declaration->name.lexeme;
+
+    void *self = this;
+    std::ostringstream self_addr;
+    self_addr << self;
+    return "<function partial-"s + name + ">"s + " at: "s + self_addr.str();
+}
+
+VM::VM(Interpreter &interpreter) : interpreter(interpreter), stack(FRAME_STACK_SIZE), frames(64)
+{
+    stack_top = stack.data();
+}
+
+void VM::interpret(const std::vector<std::shared_ptr<FunctionProto>> &scripts)
+{
+    for (const auto &script : scripts)
+    {
+        auto closure(makeRef<VMClosure>(*this, script));
+        try
+        {
+            callClosure(*closure, {});
+        }
+        catch (RuntimeError &e)
+        {
+            runtimeError(e);
+        }
+    }
+}
+
+Value VM::callClosure(VMClosure &closure, const std::vector<Value> &arguments)
+{
+    // an offset, since the stack may move while the closure runs
+    size_t base(stack_top - stack.data());
+    size_t frame_base(frame_count);
+
+    ensureStack(arguments.size() + 1);
+    *stack_top++ = nullptr;
+    for (const auto &argument : arguments)
+        *stack_top++ = argument;
+
+    try
+    {
+        pushFrame(&closure, arguments.size(), 0);
+        return run(frame_base);
+    }
+    catch (...)
+    {
+        unwind(base, frame_base);
+        throw;
+    }
+}
+
+void VM::unwind(size_t base, size_t frame_base)
+{
+    closeUpvalues(stack.data() + base);
+    while (stack_top > stack.data() + base)
+        *--stack_top = nullptr;
+    frame_count = frame_base;
+}
+
+// Moves the stack to a larger one when fewer than count values are free above the top, and points the frames and
+// the open upvalues at the new one.
+void VM::ensureStack(size_t count)
+{
+    size_t used(stack_top - stack.data());
+    if (used + count <= stack.size())
+        return;
+
+    std::vector<Value> grown(std::max(stack.size() * 2, used + count));
+    std::move(stack.data(), stack_top, grown.data());
+    auto rebase([&](Value *pointer)
+                { return grown.data() + (pointer - stack.data()); });
+    for (size_t i = 0; i < frame_count; i++)
+        frames[i].slots = rebase(frames[i].slots);
+    for (auto upvalue(open_upvalues.get()); upvalue; upvalue = upvalue->next.get())
+        upvalue->location = rebase(upvalue->location);
+    stack_top = rebase(stack_top);
+    stack.swap(grown);
+}
+
+void VM::pushFrame(VMClosure *closure, uint32_t arg_count, uint32_t line)
+{
+    if (frame_count == FRAMES_MAX)
+        throw RuntimeError(lineToken(line), "Stack overflow.");
+    if (frame_count == frames.size())
+        frames.resize(frames.size() * 2);
+    ensureStack(FRAME_STACK_SIZE);
+
+    frames[frame_count++] = {closure, closure->proto->chunk.code.data(), stack_top - arg_count - 1};
+}
+
+void VM::callValue(uint32_t arg_count, uint32_t line)
+{
+    Value &callee(stack_top[-static_cast<int64_t>(arg_count) - 1]);
+    if (!callee.isCallable())
+        throw RuntimeError(lineToken(line), "Not a callable instance.");
+
+    Ref<SurpherCallable> callable(callee.as<SurpherCallable>());
+    auto closure(dynamic_cast<VMClosure *>(callable.get()));
+    auto surpher_fun(dynamic_cast<SurpherFunction *>(callable.get()));
+
+    if (closure || surpher_fun || dynamic_cast<VMPartial *>(callable.get()))
+    {
+        if (surpher_fun && surpher_fun->is_sig)
+            throw RuntimeError(surpher_fun->declaration->name, "Cannot invoke a function signature.");
+
+        uint32_t arity(callable->arity());
+        if (arg_count > arity)
+        {
+            throw RuntimeError(lineToken(line), "Expected " + std::to_string(arity) + " arguments but got " +
+                                                    std::to_string(arg_count) + ".");
+        }
+        else if (arg_count < arity)
+        {
+            std::vector<Value> bound_arguments(std::make_move_iterator(stack_top - arg_count),
+                                                  std::make_move_iterator(stack_top));
+            while (arg_count-- > 0)
+                *--stack_top = nullptr;
+
+            stack_top[-1] = makeRef<VMPartial>(callable, std::move(bound_arguments));
+            return;
+        }
+        else if (closure)
+        {
+            pushFrame(closure, arg_count, line);
+            return;
+        }
+    }
+    else
+    {
+        if (auto native_fun = dynamic_cast<NativeFunction *>(callable.get()))
+            native_fun->paren = Token(")", {}, RIGHT_PAREN, line);
+
+        if (arg_count != callable->arity())
+        {
+            throw RuntimeError(lineToken(line), "Expected " + std::to_string(callable->arity()) + " arguments but got " +
+                                                    std::to_string(arg_count) + ".");
+        }
+    }
+
+    std::vector<Value> arguments(stack_top - arg_count, stack_top);
+    Value result(callable->call(interpreter, arguments));
+
+    for (uint32_t i = 0; i <= arg_count; i++)
+        *--stack_top = nullptr;
+    *stack_top++ = std::move(result);
+}
+
+std::shared_ptr<VMUpvalue> VM::captureUpvalue(Value *local)
+{
+    std::shared_ptr<VMUpvalue> prev_upvalue;
+    std::shared_ptr<VMUpvalue> upvalue(open_upvalues);
+    while (upvalue && upvalue->location > local)
+    {
+        prev_upvalue = upvalue;
+        upvalue = upvalue->next;
+    }
+
+    if (upvalue && upvalue->location == local)
+        return upvalue;
+
+    auto created_upvalue(std::make_shared<VMUpvalue>(local));
+    created_upvalue->next = upvalue;
+
+    if (prev_upvalue)
+        prev_upvalue->next = created_upvalue;
+    else
+        open_upvalues = created_upvalue;
+
+    return created_upvalue;
+}
+
+void VM::closeUpvalues(Value *last)
+{
+    while (open_upvalues && open_upvalues->location >= last)
+    {
+        auto upvalue(open_upvalues);
+        upvalue->closed = std::move(*upvalue->location);
+        upvalue->location = &upvalue->closed;
+        open_upvalues = std::move(upvalue->next);
+    }
+}
+
+Value VM::run(size_t frame_base)
+{
+    CallFrame *frame;
+    const uint8_t *ip;
+    const Value *constants;
+
+#define LOAD_FRAME()                                         \
+    do                                                       \
+    {                                                        \
+        frame = &frames[frame_count - 1];                    \
+        ip = frame->ip;                                      \
+        constants = frame->closure->proto->chunk.constants.data(); \
+    } while (false)
+#define READ_BYTE() (*ip++)
+#define READ_SHORT() (ip += 2, static_cast<uint16_t>((ip[-2] << 8) | ip[-1]))
+#define READ_CONSTANT() (constants[READ_SHORT()])
+#define READ_NAME() (frame->closure->proto->chunk.names[READ_SHORT()])
+#define CURRENT_LINE() (frame->closure->proto->chunk.lines[ip - frame->closure->proto->chunk.code.data() - 1])
+#define IS_NUMBER(value) ((value).isNumber())
+#define AS_NUMBER(value) ((value).asNumber())
+#define CHECK_NUMBER_OPERANDS()                                                 \
+    if (!IS_NUMBER(stack_top[-2]) || !IS_NUMBER(stack_top[-1]))                 \
+        throw RuntimeError(lineToken(CURRENT_LINE()), "Operand must be a number.");
+#define NUMBER_OP(op)                                                           \
+    {                                                                           \
+        CHECK_NUMBER_OPERANDS();                                                \
+        AS_NUMBER(stack_top[-2]) = AS_NUMBER(stack_top[-2]) op AS_NUMBER(stack_top[-1]); \
+        *--stack_top = nullptr;                                                 \
+        break;                                                                  \
+    }
+#define INTEGER_OP(op)                                                          \
+    {                                                                           \
+        CHECK_NUMBER_OPERANDS();                                                \
+        AS_NUMBER(stack_top[-2]) = static_cast<double>(static_cast<int64_t>(AS_NUMBER(stack_top[-2])) op static_cast<int64_t>(AS_NUMBER(stack_top[-1]))); \
+        *--stack_top = nullptr;                                                 \
+        break;                                                                  \
+    }
+#define COMPARISON_OP(op)                                                       \
+    {                                                                           \
+        CHECK_NUMBER_OPERANDS();                                                \
+        bool result(AS_NUMBER(stack_top[-2]) op AS_NUMBER(stack_top[-1]));      \
+        *--stack_top = nullptr;                                                 \
+        stack_top[-1] = result;                                                 \
+        break;                                                                  \
+    }
+
+    LOAD_FRAME();
+    while (true)
+    {
+        switch (READ_BYTE())
+        {
+        case OP_CONSTANT:
+            *stack_top++ = READ_CONSTANT();
+            break;
+        case OP_NIL:
+            *stack_top++ = nullptr;
+            break;
+        case OP_TRUE:
+            *stack_top++ = true;
+            break;
+        case OP_FALSE:
+            *stack_top++ = false;
+            break;
+        case OP_POP:
+            *--stack_top = nullptr;
+            break;
+        case OP_GET_LOCAL:
+            *stack_top++ = frame->slots[READ_BYTE()];
+            break;
+        case OP_SET_LOCAL:
+            frame->slots[READ_BYTE()] = stack_top[-1];
+            break;
+        case OP_GET_UPVALUE:
+            *stack_top++ = *frame->closure->upvalues[READ_BYTE()]->location;
+            break;
+        case OP_SET_UPVALUE:
+            *frame->closure->upvalues[READ_BYTE()]->location = stack_top[-1];
+            break;
+        case OP_DEFINE_GLOBAL:
+        {
+            const auto &name(READ_NAME());
+            bool is_fixed(READ_BYTE());
+            interpreter.globals->define(name, std::move(stack_top[-1]), is_fixed);
+            *--stack_top = nullptr;
+            break;
+        }
+        case OP_GET_GLOBAL:
+            *stack_top++ = interpreter.globals->get(READ_NAME());
+            break;
+        case OP_SET_GLOBAL:
+            interpreter.globals->assign(READ_NAME(), stack_top[-1]);
+            break;
+        case OP_GET_PROPERTY:
+        {
+            const auto &name(READ_NAME());
+            Value &object(stack_top[-1]);
+
+            if (object.isInstance())
+            {
+                object = object.asPointer<SurpherInstance>()->get(name);
+            }
+            else if (object.isNamespace())
+            {
+                object = object.asPointer<SurpherNamespace>()->get(name);
+            }
+            else if (object.isCallable() && dynamic_cast<SurpherClass *>(object.asPointer<SurpherCallable>()))
+            {
+                object = static_cast<SurpherClass *>(object.asPointer<SurpherCallable>())->get(name);
+            }
+            else
+            {
+                throw RuntimeError(name, "Can only get from a module or a class instance.");
+            }
+            break;
+        }
+        case OP_SET_PROPERTY:
+        {
+            const auto &name(READ_NAME());
+            Value &object(stack_top[-2]);
+
+            if (object.isInstance())
+                object.asPointer<SurpherInstance>()->set(name, stack_top[-1]);
+            else if (object.isNamespace())
+                object.asPointer<SurpherNamespace>()->set(name, stack_top[-1]);
+            else
+                throw RuntimeError(name, "Only instances have fields.");
+
+            object = std::move(stack_top[-1]);
+            *--stack_top = nullptr;
+            break;
+        }
+        case OP_EQUAL:
+        {
+            bool result(Interpreter::isEqual(stack_top[-2], stack_top[-1]));
+            *--stack_top = nullptr;
+            stack_top[-1] = result;
+            break;
+        }
+        case OP_NOT_EQUAL:
+        {
+            bool result(!Interpreter::isEqual(stack_top[-2], stack_top[-1]));
+            *--stack_top = nullptr;
+            stack_top[-1] = result;
+            break;
+        }
+        case OP_GREATER:
+            COMPARISON_OP(>)
+        case OP_GREATER_EQUAL:
+            COMPARISON_OP(>=)
+        case OP_LESS:
+            COMPARISON_OP(<)
+        case OP_LESS_EQUAL:
+            COMPARISON_OP(<=)
+        case OP_ADD:
+        {
+            if (stack_top[-2].isString() || stack_top[-1].isString())
+            {
+                std::string result(Interpreter::stringify(stack_top[-2]) + Interpreter::stringify(stack_top[-1]));
+                *--stack_top = nullptr;
+                stack_top[-1] = std::move(result);
+                break;
+            }
+            NUMBER_OP(+)
+        }
+        case OP_SUBTRACT:
+            NUMBER_OP(-)
+        case OP_MULTIPLY:
+            NUMBER_OP(*)
+        case OP_DIVIDE:
+        {
+            CHECK_NUMBER_OPERANDS();
+            if (AS_NUMBER(stack_top[-1]) == 0)
+                throw RuntimeError(lineToken(CURRENT_LINE()), "Denominator cannot be 0.");
+            NUMBER_OP(/)
+        }
+        case OP_MODULO:
+        {
+            CHECK_NUMBER_OPERANDS();
+            if (AS_NUMBER(stack_top[-1]) == 0)
+                throw RuntimeError(lineToken(CURRENT_LINE()), "Denominator cannot be 0.");
+            AS_NUMBER(stack_top[-2]) = std::fmod(AS_NUMBER(stack_top[-2]), AS_NUMBER(stack_top[-1]));
+            *--stack_top = nullptr;
+            break;
+        }
+        case OP_LEFT_SHIFT:
+            INTEGER_OP(<<)
+        case OP_RIGHT_SHIFT:
+            INTEGER_OP(>>)
+        case OP_BIT_AND:
+            INTEGER_OP(&)
+        case OP_BIT_OR:
+            INTEGER_OP(|)
+        case OP_BIT_XOR:
+            INTEGER_OP(^)
+        case OP_NOT:
+            stack_top[-1] = !Interpreter::isTruthy(stack_top[-1]);
+            break;
+        case OP_NEGATE:
+            if (!IS_NUMBER(stack_top[-1]))
+                throw RuntimeError(lineToken(CURRENT_LINE()), "Operand must be a number.");
+            AS_NUMBER(stack_top[-1]) = -AS_NUMBER(stack_top[-1]);
+            break;
+        case OP_PRINT:
+            std::cout << Interpreter::stringify(stack_top[-1]) << std::endl;
+            *--stack_top = nullptr;
+            break;
+        case OP_JUMP:
+        {
+            uint16_t offset(READ_SHORT());
+            ip += offset;
+            break;
+        }
+        case OP_JUMP_IF_FALSE:
+        {
+            uint16_t offset(READ_SHORT());
+            if (!Interpreter::isTruthy(stack_top[-1]))
+                ip += offset;
+            break;
+        }
+        case OP_LOOP:
+        {
+            uint16_t offset(READ_SHORT());
+            ip -= offset;
+            break;
+        }
+        case OP_CALL:
+        {
+            uint8_t arg_count(READ_BYTE());
+            frame->ip = ip;
+            callValue(arg_count, CURRENT_LINE());
+            LOAD_FRAME();
+            break;
+        }
+        case OP_CLOSURE:
+        {
+            const auto &proto(frame->closure->proto->chunk.functions[READ_SHORT()]);
+            auto closure(makeRef<VMClosure>(*this, proto));
+            closure->upvalues.reserve(proto->upvalue_count);
+            for (uint32_t i = 0; i < proto->upvalue_count; i++)
+            {
+                bool is_local(READ_BYTE());
+                uint8_t index(READ_BYTE());
+                closure->upvalues.emplace_back(is_local ? captureUpvalue(frame->slots + index) : frame->closure->upvalues[index]);
+            }
+            *stack_top++ = std::move(closure);
+            break;
+        }
+        case OP_CLOSE_UPVALUE:
+            closeUpvalues(stack_top - 1);
+            *--stack_top = nullptr;
+            break;
+        case OP_RETURN:
+        {
+            Value result(std::move(stack_top[-1]));
+            closeUpvalues(frame->slots);
+            while (stack_top > frame->slots)
+                *--stack_top = nullptr;
+
+            if (--frame_count == frame_base)
+                return result;
+
+            *stack_top++ = std::move(result);
+            LOAD_FRAME();
+            break;
+        }
+        case OP_ARRAY:
+        {
+            uint16_t size(READ_SHORT());
+            SurpherArrayPtr result{makeRef<SurpherArray>(std::make_move_iterator(stack_top - size),
+                                                         std::make_move_iterator(stack_top))};
+            for (uint16_t i = 0; i < size; i++)
+                *--stack_top = nullptr;
+            *stack_top++ = std::move(result);
+            break;
+        }
+        case OP_ARRAY_ALLOC:
+        {
+            Value &actual_size(stack_top[-1]);
+            if (!IS_NUMBER(actual_size))
+                throw RuntimeError(lineToken(CURRENT_LINE()), "Size for array can only be a number.");
+            else if (AS_NUMBER(actual_size) < 0)
+                throw RuntimeError(lineToken(CURRENT_LINE()), "Size for array cannot be a negative number.");
+
+            actual_size = makeRef<SurpherArray>(static_cast<uint64_t>(AS_NUMBER(actual_size)), nullptr);
+            break;
+        }
+        case OP_ACCESS:
+        {
+            Value &index(stack_top[-2]), &arr_name(stack_top[-1]);
+            if (!arr_name.isArray())
+                throw RuntimeError(lineToken(CURRENT_LINE()), "Access operator can only be applied to an array.");
+            else if (!IS_NUMBER(index))
+                throw RuntimeError(lineToken(CURRENT_LINE()), "Index for access operator can only be a positive integer.");
+
+            auto index_cast{static_cast<uint64_t>(AS_NUMBER(index))};
+            auto arr_name_cast(arr_name.asPointer<SurpherArray>());
+            if (arr_name_cast->size() <= index_cast)
+                throw RuntimeError(lineToken(CURRENT_LINE()), "Index-out-of-bound.");
+
+            index = (*arr_name_cast)[index_cast];
+            *--stack_top = nullptr;
+            break;
+        }
+        case OP_ARRAY_SET:
+        {
+            Value &index(stack_top[-2]), &arr_name(stack_top[-1]);
+            if (!arr_name.isArray())
+                throw RuntimeError(lineToken(CURRENT_LINE()), "Access operator can only be applied to an array.");
+            else if (!IS_NUMBER(index))
+                throw RuntimeError(lineToken(CURRENT_LINE()), "Index for access operator can only be a number.");
+            else if (AS_NUMBER(index) < 0)
+                throw RuntimeError(lineToken(CURRENT_LINE()), "Index cannot be a negative number.");
+
+            auto index_cast{static_cast<uint64_t>(AS_NUMBER(index))};
+            auto arr_name_cast(arr_name.asPointer<SurpherArray>());
+            if (arr_name_cast->size() <= index_cast)
+                throw RuntimeError(lineToken(CURRENT_LINE()), "Index-out-of-bound.");
+
+            (*arr_name_cast)[index_cast] = stack_top[-3];
+            *--stack_top = nullptr;
+            *--stack_top = nullptr;
+            break;
+        }
+        case OP_HALT:
+            if (!stack_top[-1].isString())
+                throw RuntimeError(lineToken(CURRENT_LINE()), "Message after \"halt\" should be a string.");
+            throw RuntimeError(lineToken(CURRENT_LINE()), stack_top[-1].asString());
+        default:
+            throw RuntimeError(lineToken(CURRENT_LINE()), "Unknown opcode.");
+        }
+    }
+
+#undef LOAD_FRAME
+#undef READ_BYTE
+#undef READ_SHORT
+#undef READ_CONSTANT
+#undef READ_NAME
+#undef CURRENT_LINE
+#undef IS_NUMBER
+#undef AS_NUMBER
+#undef CHECK_NUMBER_OPERANDS
+#undef NUMBER_OP
+#undef INTEGER_OP
+#undef COMPARISON_OP
+}
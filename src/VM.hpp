@@ -0,0 +1,88 @@
+#ifndef SURPHER_VM_HPP
+#define SURPHER_VM_HPP
+
+#include <vector>
+#include <memory>
+
+#include "Chunk.hpp"
+#include "SurpherCallable.hpp"
+
+class Interpreter;
+class VM;
+
+struct VMUpvalue
+{
+    Value *location;
+    Value closed;
+    std::shared_ptr<VMUpvalue> next;
+
+    explicit VMUpvalue(Value *location);
+};
+
+struct VMClosure : SurpherCallable
+{
+    VM &vm;
+    const std::shared_ptr<FunctionProto> proto;
+    std::vector<std::shared_ptr<VMUpvalue>> upvalues;
+
+    VMClosure(VM &vm, std::shared_ptr<FunctionProto> proto);
+    uint32_t arity() override;
+    Value call(Interpreter &interpreter, const std::vector<Value> &arguments) override;
+    std::string SurpherCallableToString() override;
+};
+
+struct VMPartial : SurpherCallable
+{
+    const Ref<SurpherCallable> callee;
+    const std::vector<Value> bound_arguments;
+
+    VMPartial(Ref<SurpherCallable> callee, std::vector<Value> bound_arguments);
+    uint32_t arity() override;
+    Value call(Interpreter &interpreter, const std::vector<Value> &arguments) override;
+    std::string SurpherCallableToString() override;
+};
+
+class VM
+{
+    struct CallFrame
+    {
+        VMClosure *closure;
+        const uint8_t *ip;
+        Value *slots;
+    };
+
+    // both stacks grow as calls nest; the frame limit only stops runaway recursion
+    static constexpr size_t FRAMES_MAX = 1 << 20;
+    // room a new frame is guaranteed: its locals and temporaries, and the most operands one instruction pops
+    static constexpr size_t FRAME_STACK_SIZE = (UINT8_MAX + 1) + UINT16_MAX;
+
+    Interpreter &interpreter;
+    std::vector<Value> stack;
+    Value *stack_top;
+    std::vector<CallFrame> frames;
+    size_t frame_count = 0;
+    std::shared_ptr<VMUpvalue> open_upvalues;
+
+    void ensureStack(size_t count);
+
+    void callValue(uint32_t arg_count, uint32_t line);
+
+    void pushFrame(VMClosure *closure, uint32_t arg_count, uint32_t line);
+
+    std::shared_ptr<VMUpvalue> captureUpvalue(Value *local);
+
+    void closeUpvalues(Value *last);
+
+    void unwind(size_t base, size_t frame_base);
+
+    Value run(size_t frame_base);
+
+public:
+    explicit VM(Interpreter &interpreter);
+
+    Value callClosure(VMClosure &closure, const std::vector<Value> &arguments);
+
+    void interpret(const std::vector<std::shared_ptr<FunctionProto>> &scripts);
+};
+
+#endif // SURPHER_VM_HPP
@@ -0,0 +1,298 @@
+#ifndef SURPHER_VALUE_HPP
+#define SURPHER_VALUE_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <complex>
+#include <fstream>
+#include <utility>
+#include <type_traits>
+
+enum class ValueType : uint8_t
+{
+    NIL = 0,
+    BOOL,
+    NUMBER,
+    STRING,
+    ARRAY,
+    CALLABLE,
+    INSTANCE,
+    NAMESPACE,
+    FILE,
+    COMPLEX,
+    // only ever found in an environment slot, never handed to Surpher code
+    BOX
+};
+
+// Heap objects carry their own reference count so that a Value only has to hold a raw pointer.
+// Counting is not atomic: the interpreter runs Surpher code on a single thread.
+struct Object
+{
+    uint32_t ref_count = 0;
+
+    Object() = default;
+
+    Object(const Object &) {}
+
+    Object &operator=(const Object &) { return *this; }
+
+    virtual ~Object() = default;
+};
+
+inline void retain(Object *object)
+{
+    if (object)
+        object->ref_count++;
+}
+
+inline void release(Object *object)
+{
+    if (object && --object->ref_count == 0)
+        delete object;
+}
+
+template <typename T>
+class Ref
+{
+    template <typename U>
+    friend class Ref;
+
+    T *ptr = nullptr;
+
+public:
+    Ref() = default;
+
+    Ref(std::nullptr_t) {}
+
+    explicit Ref(T *ptr) : ptr(ptr) { retain(ptr); }
+
+    Ref(const Ref &other) : ptr(other.ptr) { retain(ptr); }
+
+    Ref(Ref &&other) noexcept : ptr(other.ptr) { other.ptr = nullptr; }
+
+    template <typename U, typename = std::enable_if_t<std::is_convertible_v<U *, T *>>>
+    Ref(const Ref<U> &other) : ptr(other.ptr) { retain(ptr); }
+
+    template <typename U, typename = std::enable_if_t<std::is_convertible_v<U *, T *>>>
+    Ref(Ref<U> &&other) noexcept : ptr(other.ptr) { other.ptr = nullptr; }
+
+    ~Ref() { release(ptr); }
+
+    Ref &operator=(Ref other) noexcept
+    {
+        std::swap(ptr, other.ptr);
+        return *this;
+    }
+
+    T *get() const { return ptr; }
+
+    T *operator->() const { return ptr; }
+
+    T &operator*() const { return *ptr; }
+
+    explicit operator bool() const { return ptr != nullptr; }
+
+    bool operator==(const Ref &other) const { return ptr == other.ptr; }
+
+    bool operator!=(const Ref &other) const { return ptr != other.ptr; }
+};
+
+template <typename T, typename... Args>
+Ref<T> makeRef(Args &&...args)
+{
+    return Ref<T>(new T(std::forward<Args>(args)...));
+}
+
+template <typename T, typename U>
+Ref<T> staticRefCast(const Ref<U> &ref)
+{
+    return Ref<T>(static_cast<T *>(ref.get()));
+}
+
+template <typename T, typename U>
+Ref<T> dynamicRefCast(const Ref<U> &ref)
+{
+    return Ref<T>(dynamic_cast<T *>(ref.get()));
+}
+
+// 16 bytes: a type tag next to either an inline number/bool or a pointer to a counted heap object
+class Value
+{
+    ValueType type;
+    union
+    {
+        bool boolean;
+        double number;
+        Object *object;
+    } data;
+
+public:
+    Value() : type(ValueType::NIL) { data.object = nullptr; }
+
+    Value(std::nullptr_t) : Value() {}
+
+    Value(bool boolean) : type(ValueType::BOOL) { data.boolean = boolean; }
+
+    Value(double number) : type(ValueType::NUMBER) { data.number = number; }
+
+    Value(const char *str);
+
+    Value(std::string str);
+
+    Value(std::complex<double> complex);
+
+    template <typename T>
+    Value(const Ref<T> &ref) : type(ref ? T::value_type : ValueType::NIL)
+    {
+        data.object = ref.get();
+        retain(data.object);
+    }
+
+    template <typename T>
+    Value(T *) = delete;
+
+    Value(const Value &other) : type(other.type), data(other.data)
+    {
+        if (isObject())
+            retain(data.object);
+    }
+
+    Value(Value &&other) noexcept : type(other.type), data(other.data)
+    {
+        other.type = ValueType::NIL;
+        other.data.object = nullptr;
+    }
+
+    Value &operator=(const Value &other)
+    {
+        if (other.isObject())
+            retain(other.data.object);
+        if (isObject())
+            release(data.object);
+
+        type = other.type;
+        data = other.data;
+        return *this;
+    }
+
+    Value &operator=(Value &&other) noexcept
+    {
+        if (this != &other)
+        {
+            if (isObject())
+                release(data.object);
+
+            type = other.type;
+            data = other.data;
+            other.type = ValueType::NIL;
+            other.data.object = nullptr;
+        }
+        return *this;
+    }
+
+    ~Value()
+    {
+        if (isObject())
+            release(data.object);
+    }
+
+    ValueType getType() const { return type; }
+
+    bool isObject() const { return type >= ValueType::STRING; }
+
+    bool isNil() const { return type == ValueType::NIL; }
+
+    bool isBool() const { return type == ValueType::BOOL; }
+
+    bool isNumber() const { return type == ValueType::NUMBER; }
+
+    bool isString() const { return type == ValueType::STRING; }
+
+    bool isArray() const { return type == ValueType::ARRAY; }
+
+    bool isCallable() const { return type == ValueType::CALLABLE; }
+
+    bool isInstance() const { return type == ValueType::INSTANCE; }
+
+    bool isNamespace() const { return type == ValueType::NAMESPACE; }
+
+    bool isFile() const { return type == ValueType::FILE; }
+
+    bool isComplex() const { return type == ValueType::COMPLEX; }
+
+    bool isBox() const { return type == ValueType::BOX; }
+
+    bool asBool() const { return data.boolean; }
+
+    double asNumber() const { return data.number; }
+
+    double &asNumber() { return data.number; }
+
+    const std::string &asString() const;
+
+    std::complex<double> asComplex() const;
+
+    // callers check the tag first; T must be the object type stored under it (or one of its bases)
+    template <typename T>
+    Ref<T> as() const { return Ref<T>(static_cast<T *>(data.object)); }
+
+    template <typename T>
+    T *asPointer() const { return static_cast<T *>(data.object); }
+};
+
+struct SurpherString : Object
+{
+    static constexpr ValueType value_type = ValueType::STRING;
+    const std::string str;
+
+    explicit SurpherString(std::string str) : str(std::move(str)) {}
+};
+
+struct SurpherComplex : Object
+{
+    static constexpr ValueType value_type = ValueType::COMPLEX;
+    const std::complex<double> complex;
+
+    explicit SurpherComplex(std::complex<double> complex) : complex(complex) {}
+};
+
+struct SurpherArray : Object, std::vector<Value>
+{
+    static constexpr ValueType value_type = ValueType::ARRAY;
+
+    using std::vector<Value>::vector;
+};
+
+using SurpherArrayPtr = Ref<SurpherArray>;
+
+struct SurpherFile : Object
+{
+    static constexpr ValueType value_type = ValueType::FILE;
+    std::fstream stream;
+};
+
+inline Value::Value(const char *str) : Value(std::string(str))
+{
+}
+
+inline Value::Value(std::string str) : Value(makeRef<SurpherString>(std::move(str)))
+{
+}
+
+inline Value::Value(std::complex<double> complex) : Value(makeRef<SurpherComplex>(complex))
+{
+}
+
+inline const std::string &Value::asString() const
+{
+    return static_cast<SurpherString *>(data.object)->str;
+}
+
+inline std::complex<double> Value::asComplex() const
+{
+    return static_cast<SurpherComplex *>(data.object)->complex;
+}
+
+#endif // SURPHER_VALUE_HPP
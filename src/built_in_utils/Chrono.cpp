@@ -7,7 +7,7 @@ uint32_t Clock::arity()
     return 0;
 }
 
-std::any Clock::call(Interpreter &interpreter, const std::vector<std::any> &arguments)
+Value Clock::call(Interpreter &interpreter, const std::vector<Value> &arguments)
 {
-    return std::chrono::duration<long double>{std::chrono::system_clock::now().time_since_epoch()}.count();
+    return std::chrono::duration<double>{std::chrono::system_clock::now().time_since_epoch()}.count();
 }
\ No newline at end of file
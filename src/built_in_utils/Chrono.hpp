@@ -5,5 +5,5 @@
 struct Clock : NativeFunction
 {
     uint32_t arity() override;
-    std::any call(Interpreter &interpreter, const std::vector<std::any> &arguments) override;
+    Value call(Interpreter &interpreter, const std::vector<Value> &arguments) override;
 };
\ No newline at end of file
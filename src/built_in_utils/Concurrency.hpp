@@ -5,29 +5,29 @@
 struct Thread : NativeFunction
 {
     uint32_t arity() override;
-    std::any call(Interpreter &interpreter, const std::vector<std::any> &arguments) override;
+    Value call(Interpreter &interpreter, const std::vector<Value> &arguments) override;
 };
 
 struct Join : NativeFunction
 {
     uint32_t arity() override;
-    std::any call(Interpreter &interpreter, const std::vector<std::any> &arguments) override;
+    Value call(Interpreter &interpreter, const std::vector<Value> &arguments) override;
 };
 
 struct Mutex : NativeFunction
 {
     uint32_t arity() override;
-    std::any call(Interpreter &interpreter, const std::vector<std::any> &arguments) override;
+    Value call(Interpreter &interpreter, const std::vector<Value> &arguments) override;
 };
 
 struct Lock : NativeFunction
 {
     uint32_t arity() override;
-    std::any call(Interpreter &interpreter, const std::vector<std::any> &arguments) override;
+    Value call(Interpreter &interpreter, const std::vector<Value> &arguments) override;
 };
 
 struct Unlock : NativeFunction
 {
     uint32_t arity() override;
-    std::any call(Interpreter &interpreter, const std::vector<std::any> &arguments) override;
+    Value call(Interpreter &interpreter, const std::vector<Value> &arguments) override;
 };
\ No newline at end of file
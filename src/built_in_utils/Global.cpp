@@ -5,24 +5,23 @@ uint32_t Sizeof::arity()
     return 1;
 }
 
-std::any Sizeof::call(Interpreter &interpreter, const std::vector<std::any> &arguments)
+Value Sizeof::call(Interpreter &interpreter, const std::vector<Value> &arguments)
 {
-    auto value = arguments[0];
+    const auto &value = arguments[0];
 
-    if (value.type() == typeid(SurpherArrayPtr))
+    if (value.isArray())
     {
-        auto value_cast{std::any_cast<SurpherArrayPtr>(value)};
-        return static_cast<long double>(value_cast->size());
+        return static_cast<double>(value.asPointer<SurpherArray>()->size());
     }
-    else if (value.type() == typeid(std::shared_ptr<SurpherInstance>))
+    else if (value.isInstance())
     {
-        auto value_cast{std::any_cast<std::shared_ptr<SurpherInstance>>(value)};
-        return std::any_cast<std::shared_ptr<SurpherCallable>>(value_cast->get(Token("__sizeOf__", {}, STRING, 0)))->call(interpreter, {});
+        auto value_cast{value.as<SurpherInstance>()};
+        if (auto size_of = value_cast->surpher_class->findProtocol(Protocol::SIZE_OF))
+            return size_of->invoke(interpreter, value_cast, {});
     }
-    else if (value.type() == typeid(std::string))
+    else if (value.isString())
     {
-        auto value_cast{std::any_cast<std::string &>(value)};
-        return static_cast<long double>(value_cast.size());
+        return static_cast<double>(value.asString().size());
     }
 
     throw RuntimeError(paren, "Type not supported for \"sizeOf\".");
@@ -33,13 +32,13 @@ uint32_t SysCmd::arity()
     return 1;
 }
 
-std::any SysCmd::call(Interpreter &interpreter, const std::vector<std::any> &arguments)
+Value SysCmd::call(Interpreter &interpreter, const std::vector<Value> &arguments)
 {
-    auto value = arguments[0];
-    if (value.type() != typeid(std::string))
+    const auto &value = arguments[0];
+    if (!value.isString())
         throw RuntimeError(paren, "System command must be a string.");
 
-    return std::system((std::any_cast<std::string &>(value).c_str()));
+    return static_cast<double>(std::system(value.asString().c_str()));
 }
 
 uint32_t Equals::arity()
@@ -47,34 +46,35 @@ uint32_t Equals::arity()
     return 2;
 }
 
-std::any Equals::call(Interpreter &interpreter, const std::vector<std::any> &arguments)
+Value Equals::call(Interpreter &interpreter, const std::vector<Value> &arguments)
 {
-    auto op1 = arguments[0];
-    auto op2 = arguments[1];
+    const auto &op1 = arguments[0];
+    const auto &op2 = arguments[1];
 
-    if (op1.type() != op2.type())
+    if (op1.getType() != op2.getType())
     {
         return false;
     }
 
-    if (op1.type() == typeid(long double))
+    if (op1.isNumber())
     {
-        return std::any_cast<long double &>(op1) == std::any_cast<long double &>(op2);
+        return op1.asNumber() == op2.asNumber();
     }
-    else if (op1.type() == typeid(bool))
+    else if (op1.isBool())
     {
-        return std::any_cast<bool>(op1) == std::any_cast<bool>(op2);
+        return op1.asBool() == op2.asBool();
     }
-    else if (op1.type() == typeid(std::string))
+    else if (op1.isString())
     {
-        return std::any_cast<std::string &>(op1) == std::any_cast<std::string &>(op2);
+        return op1.asString() == op2.asString();
     }
-    else if (op1.type() == typeid(std::shared_ptr<SurpherInstance>))
+    else if (op1.isInstance())
     {
-        auto op1_value{std::any_cast<std::shared_ptr<SurpherInstance>>(op1)};
-        auto op2_value{std::any_cast<std::shared_ptr<SurpherInstance>>(op2)};
-        return std::any_cast<std::shared_ptr<SurpherCallable>>(op1_value->get(Token("__equals__", {}, STRING, 0)))->call(interpreter, {op1, op2});
+        auto op1_value{op1.as<SurpherInstance>()};
+        if (auto equals = op1_value->surpher_class->findProtocol(Protocol::EQUALS))
+            return equals->invoke(interpreter, op1_value, {op1, op2});
+        throw RuntimeError(paren, "Type not supported for \"equals\".");
     }
 
     return false;
-}
\ No newline at end of file
+}
@@ -5,17 +5,17 @@
 struct Sizeof : NativeFunction
 {
     uint32_t arity() override;
-    std::any call(Interpreter &interpreter, const std::vector<std::any> &arguments) override;
+    Value call(Interpreter &interpreter, const std::vector<Value> &arguments) override;
 };
 
 struct Equals : NativeFunction
 {
     uint32_t arity() override;
-    std::any call(Interpreter &interpreter, const std::vector<std::any> &arguments) override;
+    Value call(Interpreter &interpreter, const std::vector<Value> &arguments) override;
 };
 
 struct SysCmd : NativeFunction
 {
     uint32_t arity() override;
-    std::any call(Interpreter &interpreter, const std::vector<std::any> &arguments) override;
+    Value call(Interpreter &interpreter, const std::vector<Value> &arguments) override;
 };
@@ -7,23 +7,22 @@ uint32_t FileOpen::arity()
 {
     return 2;
 }
-std::any FileOpen::call(Interpreter &interpreter, const std::vector<std::any> &arguments)
+Value FileOpen::call(Interpreter &interpreter, const std::vector<Value> &arguments)
 {
-    auto file_path = arguments[0], mode = arguments[1];
-    std::string file_path_str = std::any_cast<std::string &>(file_path);
-    std::string mode_str = std::any_cast<std::string &>(mode);
-    std::shared_ptr<std::fstream> f = std::make_shared<std::fstream>();
+    const std::string &file_path_str = arguments[0].asString();
+    const std::string &mode_str = arguments[1].asString();
+    Ref<SurpherFile> f = makeRef<SurpherFile>();
     if (mode_str == "r")
     {
-        f->open(file_path_str, std::ios::binary | std::ios::in);
+        f->stream.open(file_path_str, std::ios::binary | std::ios::in);
     }
     else if (mode_str == "w")
     {
-        f->open(file_path_str, std::ios::binary | std::ios::out);
+        f->stream.open(file_path_str, std::ios::binary | std::ios::out);
     }
     else if (mode_str == "rw")
     {
-        f->open(file_path_str, std::ios::binary | std::ios::in | std::ios::out);
+        f->stream.open(file_path_str, std::ios::binary | std::ios::in | std::ios::out);
     }
     else
     {
@@ -38,29 +37,29 @@ uint32_t Write::arity()
     return 2;
 }
 
-std::any Write::call(Interpreter &interpreter, const std::vector<std::any> &arguments)
+Value Write::call(Interpreter &interpreter, const std::vector<Value> &arguments)
 {
-    if (arguments[0].type() == typeid(std::shared_ptr<std::fstream>) && (arguments[1].type() == typeid(std::string) || arguments[1].type() == typeid(SurpherArrayPtr)))
+    if (arguments[0].isFile() && (arguments[1].isString() || arguments[1].isArray()))
     {
-        auto any_file_ptr = arguments[0], any_data = arguments[1];
-        auto file_ptr = std::any_cast<std::shared_ptr<std::fstream>>(any_file_ptr);
+        const auto &any_data = arguments[1];
+        auto file_ptr = arguments[0].asPointer<SurpherFile>();
 
-        if (any_data.type() == typeid(std::string))
+        if (any_data.isString())
         {
-            *file_ptr << std::any_cast<std::string &>(any_data);
+            file_ptr->stream << any_data.asString();
         }
         else
         {
-            auto arg_arr = *std::any_cast<SurpherArrayPtr>(any_data);
-            if (std::find_if(arg_arr.begin(), arg_arr.end(), [](const std::any &a)
-                             { return a.type() != typeid(long double); }) == arg_arr.end())
+            const auto &arg_arr = *any_data.asPointer<SurpherArray>();
+            if (std::find_if(arg_arr.begin(), arg_arr.end(), [](const Value &a)
+                             { return !a.isNumber(); }) == arg_arr.end())
             {
                 char buffer[arg_arr.size()];
                 for (size_t i = 0; i < arg_arr.size(); i++)
                 {
-                    buffer[i] = static_cast<char>(std::any_cast<long double &>(arg_arr[i]));
+                    buffer[i] = static_cast<char>(arg_arr[i].asNumber());
                 }
-                file_ptr->write(buffer, arg_arr.size());
+                file_ptr->stream.write(buffer, arg_arr.size());
             }
         }
     }
@@ -77,15 +76,14 @@ uint32_t ReadAll::arity()
     return 1;
 }
 
-std::any ReadAll::call(Interpreter &interpreter, const std::vector<std::any> &arguments)
+Value ReadAll::call(Interpreter &interpreter, const std::vector<Value> &arguments)
 {
-    if (arguments[0].type() == typeid(std::shared_ptr<std::fstream>))
+    if (arguments[0].isFile())
     {
-        auto any_file_ptr = arguments[0];
-        auto file_ptr = std::any_cast<std::shared_ptr<std::fstream>>(any_file_ptr);
+        auto file_ptr = arguments[0].asPointer<SurpherFile>();
 
         std::ostringstream out_buf;
-        out_buf << file_ptr->rdbuf();
+        out_buf << file_ptr->stream.rdbuf();
 
         return out_buf.str();
     }
@@ -97,21 +95,18 @@ uint32_t ReadSome::arity()
     return 2;
 }
 
-std::any ReadSome::call(Interpreter &interpreter, const std::vector<std::any> &arguments)
+Value ReadSome::call(Interpreter &interpreter, const std::vector<Value> &arguments)
 {
-    if (arguments[0].type() == typeid(std::shared_ptr<std::fstream>) && arguments[1].type() == typeid(long double))
+    if (arguments[0].isFile() && arguments[1].isNumber())
     {
-        auto any_file_ptr = arguments[0];
-        auto file_ptr = std::any_cast<std::shared_ptr<std::fstream>>(any_file_ptr);
+        auto file_ptr = arguments[0].asPointer<SurpherFile>();
 
-        auto any_size = arguments[1];
-        auto size = std::any_cast<long double &>(any_size);
-        auto size_int = static_cast<int64_t>(size);
+        auto size_int = static_cast<int64_t>(arguments[1].asNumber());
 
         char buffer[size_int];
-        file_ptr->read(buffer, size_int);
+        file_ptr->stream.read(buffer, size_int);
 
-        return std::string{buffer};
+        return std::string(buffer, file_ptr->stream.gcount());
     }
     throw RuntimeError(paren, "Invalid usage of \"fileReadSome\". Usage: fileReadSome(<file path>, size).");
 }
@@ -121,14 +116,13 @@ uint32_t FileClose::arity()
     return 1;
 }
 
-std::any FileClose::call(Interpreter &interpreter, const std::vector<std::any> &arguments)
+Value FileClose::call(Interpreter &interpreter, const std::vector<Value> &arguments)
 {
-    if (arguments[0].type() == typeid(std::shared_ptr<std::fstream>))
+    if (arguments[0].isFile())
     {
-        auto any_file_ptr = arguments[0];
-        auto file_ptr = std::any_cast<std::shared_ptr<std::fstream>>(any_file_ptr);
+        auto file_ptr = arguments[0].asPointer<SurpherFile>();
 
-        file_ptr->close();
+        file_ptr->stream.close();
 
         return {};
     }
@@ -140,12 +134,11 @@ uint32_t Input::arity()
     return 1;
 }
 
-std::any Input::call(Interpreter &interpreter, const std::vector<std::any> &arguments)
+Value Input::call(Interpreter &interpreter, const std::vector<Value> &arguments)
 {
-    if (arguments[0].type() == typeid(std::string))
+    if (arguments[0].isString())
     {
-        auto any_message = arguments[0];
-        auto message = std::any_cast<std::string &>(any_message);
+        const auto &message = arguments[0].asString();
         std::string ret;
 
         std::cout << message;
@@ -7,35 +7,35 @@
 struct Input : NativeFunction
 {
     uint32_t arity() override;
-    std::any call(Interpreter &interpreter, const std::vector<std::any> &arguments) override;
+    Value call(Interpreter &interpreter, const std::vector<Value> &arguments) override;
 };
 
 struct FileOpen : NativeFunction
 {
     uint32_t arity() override;
-    std::any call(Interpreter &interpreter, const std::vector<std::any> &arguments) override;
+    Value call(Interpreter &interpreter, const std::vector<Value> &arguments) override;
 };
 
 struct Write : NativeFunction
 {
     uint32_t arity() override;
-    std::any call(Interpreter &interpreter, const std::vector<std::any> &arguments) override;
+    Value call(Interpreter &interpreter, const std::vector<Value> &arguments) override;
 };
 
 struct ReadAll : NativeFunction
 {
     uint32_t arity() override;
-    std::any call(Interpreter &interpreter, const std::vector<std::any> &arguments) override;
+    Value call(Interpreter &interpreter, const std::vector<Value> &arguments) override;
 };
 
 struct ReadSome : NativeFunction
 {
     uint32_t arity() override;
-    std::any call(Interpreter &interpreter, const std::vector<std::any> &arguments) override;
+    Value call(Interpreter &interpreter, const std::vector<Value> &arguments) override;
 };
 
 struct FileClose : NativeFunction
 {
     uint32_t arity() override;
-    std::any call(Interpreter &interpreter, const std::vector<std::any> &arguments) override;
+    Value call(Interpreter &interpreter, const std::vector<Value> &arguments) override;
 };
\ No newline at end of file
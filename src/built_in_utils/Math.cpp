@@ -9,15 +9,15 @@ uint32_t Floor::arity()
     return 1;
 }
 
-std::any Floor::call(Interpreter &interpreter, const std::vector<std::any> &arguments)
+Value Floor::call(Interpreter &interpreter, const std::vector<Value> &arguments)
 {
-    auto value = arguments[0];
-    if (value.type() != typeid(long double))
+    const auto &value = arguments[0];
+    if (!value.isNumber())
     {
         throw RuntimeError(paren, "\"floor\" can only be applied to a numeric.");
     }
 
-    return std::floor(std::any_cast<long double &>(value));
+    return std::floor(value.asNumber());
 }
 
 uint32_t Ceil::arity()
@@ -25,15 +25,15 @@ uint32_t Ceil::arity()
     return 1;
 }
 
-std::any Ceil::call(Interpreter &interpreter, const std::vector<std::any> &arguments)
+Value Ceil::call(Interpreter &interpreter, const std::vector<Value> &arguments)
 {
-    auto value = arguments[0];
-    if (value.type() != typeid(long double))
+    const auto &value = arguments[0];
+    if (!value.isNumber())
     {
         throw RuntimeError(paren, "\"ceil\" can only be applied to a numeric.");
     }
 
-    return std::ceil(std::any_cast<long double &>(value));
+    return std::ceil(value.asNumber());
 }
 
 uint32_t AbsoluteValue::arity()
@@ -41,20 +41,20 @@ uint32_t AbsoluteValue::arity()
     return 1;
 }
 
-std::any AbsoluteValue::call(Interpreter &interpreter, const std::vector<std::any> &arguments)
+Value AbsoluteValue::call(Interpreter &interpreter, const std::vector<Value> &arguments)
 {
-    auto value = arguments[0];
-    if (value.type() != typeid(long double) && value.type() != typeid(std::complex<long double>))
+    const auto &value = arguments[0];
+    if (!value.isNumber() && !value.isComplex())
     {
         throw RuntimeError(paren, "\"abs\" can only be applied to a numeric.");
     }
 
-    if (value.type() == typeid(long double))
+    if (value.isNumber())
     {
-        return std::abs(std::any_cast<long double &>(value));
+        return std::abs(value.asNumber());
     }
 
-    return std::abs(std::any_cast<std::complex<long double> &>(value));
+    return std::abs(value.asComplex());
 }
 
 uint32_t Infinity::arity()
@@ -62,9 +62,9 @@ uint32_t Infinity::arity()
     return 0;
 }
 
-std::any Infinity::call(Interpreter &interpreter, const std::vector<std::any> &arguments)
+Value Infinity::call(Interpreter &interpreter, const std::vector<Value> &arguments)
 {
-    return std::numeric_limits<long double>::infinity();
+    return std::numeric_limits<double>::infinity();
 }
 
 uint32_t Power::arity()
@@ -72,16 +72,16 @@ uint32_t Power::arity()
     return 2;
 }
 
-std::any Power::call(Interpreter &interpreter, const std::vector<std::any> &arguments)
+Value Power::call(Interpreter &interpreter, const std::vector<Value> &arguments)
 {
-    auto num = arguments[0];
-    auto pow = arguments[1];
-    if (num.type() != typeid(long double) || pow.type() != typeid(long double))
+    const auto &num = arguments[0];
+    const auto &pow = arguments[1];
+    if (!num.isNumber() || !pow.isNumber())
     {
         throw RuntimeError(paren, "\"pow\" can only be applied to numerics.");
     }
 
-    return std::pow(std::any_cast<long double &>(num), std::any_cast<long double &>(pow));
+    return std::pow(num.asNumber(), pow.asNumber());
 }
 
 uint32_t Sin::arity()
@@ -89,15 +89,15 @@ uint32_t Sin::arity()
     return 1;
 }
 
-std::any Sin::call(Interpreter &interpreter, const std::vector<std::any> &arguments)
+Value Sin::call(Interpreter &interpreter, const std::vector<Value> &arguments)
 {
-    auto value = arguments[0];
-    if (value.type() != typeid(long double))
+    const auto &value = arguments[0];
+    if (!value.isNumber())
     {
         throw RuntimeError(paren, "\"sin\" can only be applied to a numeric.");
     }
 
-    return std::sin(std::any_cast<long double &>(value));
+    return std::sin(value.asNumber());
 }
 
 uint32_t Cos::arity()
@@ -105,15 +105,15 @@ uint32_t Cos::arity()
     return 1;
 }
 
-std::any Cos::call(Interpreter &interpreter, const std::vector<std::any> &arguments)
+Value Cos::call(Interpreter &interpreter, const std::vector<Value> &arguments)
 {
-    auto value = arguments[0];
-    if (value.type() != typeid(long double))
+    const auto &value = arguments[0];
+    if (!value.isNumber())
     {
         throw RuntimeError(paren, "\"cos\" can only be applied to a numeric.");
     }
 
-    return std::cos(std::any_cast<long double &>(value));
+    return std::cos(value.asNumber());
 }
 
 uint32_t Tan::arity()
@@ -121,15 +121,15 @@ uint32_t Tan::arity()
     return 1;
 }
 
-std::any Tan::call(Interpreter &interpreter, const std::vector<std::any> &arguments)
+Value Tan::call(Interpreter &interpreter, const std::vector<Value> &arguments)
 {
-    auto value = arguments[0];
-    if (value.type() != typeid(long double))
+    const auto &value = arguments[0];
+    if (!value.isNumber())
     {
         throw RuntimeError(paren, "\"tan\" can only be applied to a numeric.");
     }
 
-    return std::tan(std::any_cast<long double &>(value));
+    return std::tan(value.asNumber());
 }
 
 uint32_t ComplexNumber::arity()
@@ -137,16 +137,16 @@ uint32_t ComplexNumber::arity()
     return 2;
 }
 
-std::any ComplexNumber::call(Interpreter &interpreter, const std::vector<std::any> &arguments)
+Value ComplexNumber::call(Interpreter &interpreter, const std::vector<Value> &arguments)
 {
-    auto real = arguments[0];
-    auto img = arguments[1];
-    if (real.type() != typeid(long double) || img.type() != typeid(long double))
+    const auto &real = arguments[0];
+    const auto &img = arguments[1];
+    if (!real.isNumber() || !img.isNumber())
     {
         throw RuntimeError(paren, "\"complexNum\" can only be applied to numerics.");
     }
 
-    return std::complex(std::any_cast<long double &>(real), std::any_cast<long double &>(img));
+    return std::complex(real.asNumber(), img.asNumber());
 }
 
 uint32_t ComplexAdd::arity()
@@ -154,16 +154,16 @@ uint32_t ComplexAdd::arity()
     return 2;
 }
 
-std::any ComplexAdd::call(Interpreter &interpreter, const std::vector<std::any> &arguments)
+Value ComplexAdd::call(Interpreter &interpreter, const std::vector<Value> &arguments)
 {
-    auto op1 = arguments[0];
-    auto op2 = arguments[1];
-    if (op1.type() != typeid(std::complex<long double>) || op2.type() != typeid(std::complex<long double>))
+    const auto &op1 = arguments[0];
+    const auto &op2 = arguments[1];
+    if (!op1.isComplex() || !op2.isComplex())
     {
         throw RuntimeError(paren, "\"complexAdd\" can only be applied to complex numbers.");
     }
 
-    return std::any_cast<std::complex<long double> &>(op1) + std::any_cast<std::complex<long double> &>(op2);
+    return op1.asComplex() + op2.asComplex();
 }
 
 uint32_t ComplexSub::arity()
@@ -171,16 +171,16 @@ uint32_t ComplexSub::arity()
     return 2;
 }
 
-std::any ComplexSub::call(Interpreter &interpreter, const std::vector<std::any> &arguments)
+Value ComplexSub::call(Interpreter &interpreter, const std::vector<Value> &arguments)
 {
-    auto op1 = arguments[0];
-    auto op2 = arguments[1];
-    if (op1.type() != typeid(std::complex<long double>) || op2.type() != typeid(std::complex<long double>))
+    const auto &op1 = arguments[0];
+    const auto &op2 = arguments[1];
+    if (!op1.isComplex() || !op2.isComplex())
     {
         throw RuntimeError(paren, "\"complexSub\" can only be applied to complex numbers.");
     }
 
-    return std::any_cast<std::complex<long double> &>(op1) - std::any_cast<std::complex<long double> &>(op2);
+    return op1.asComplex() - op2.asComplex();
 }
 
 uint32_t ComplexMul::arity()
@@ -188,16 +188,16 @@ uint32_t ComplexMul::arity()
     return 2;
 }
 
-std::any ComplexMul::call(Interpreter &interpreter, const std::vector<std::any> &arguments)
+Value ComplexMul::call(Interpreter &interpreter, const std::vector<Value> &arguments)
 {
-    auto op1 = arguments[0];
-    auto op2 = arguments[1];
-    if (op1.type() != typeid(std::complex<long double>) || op2.type() != typeid(std::complex<long double>))
+    const auto &op1 = arguments[0];
+    const auto &op2 = arguments[1];
+    if (!op1.isComplex() || !op2.isComplex())
     {
         throw RuntimeError(paren, "\"complexMul\" can only be applied to complex numbers.");
     }
 
-    return std::any_cast<std::complex<long double> &>(op1) * std::any_cast<std::complex<long double> &>(op2);
+    return op1.asComplex() * op2.asComplex();
 }
 
 uint32_t ComplexDiv::arity()
@@ -205,18 +205,18 @@ uint32_t ComplexDiv::arity()
     return 2;
 }
 
-std::any ComplexDiv::call(Interpreter &interpreter, const std::vector<std::any> &arguments)
+Value ComplexDiv::call(Interpreter &interpreter, const std::vector<Value> &arguments)
 {
-    auto op1 = arguments[0];
-    auto op2 = arguments[1];
-    if (op1.type() != typeid(std::complex<long double>) || op2.type() != typeid(std::complex<long double>))
+    const auto &op1 = arguments[0];
+    const auto &op2 = arguments[1];
+    if (!op1.isComplex() || !op2.isComplex())
     {
         throw RuntimeError(paren, "\"complexDiv\" can only be applied to complex numbers.");
     }
-    else if (std::any_cast<std::complex<long double> &>(op2) == std::complex<long double>(0, 0))
+    else if (op2.asComplex() == std::complex<double>(0, 0))
     {
         throw RuntimeError(paren, "\"complexDiv\"'s denominator cannot be 0.");
     }
 
-    return std::any_cast<std::complex<long double> &>(op1) / std::any_cast<std::complex<long double> &>(op2);
+    return op1.asComplex() / op2.asComplex();
 }
\ No newline at end of file
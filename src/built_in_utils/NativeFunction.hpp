@@ -4,9 +4,6 @@
 #include "../SurpherNamespace.hpp"
 #include "../Error.hpp"
 
-using SurpherArray = std::vector<std::any>;
-using SurpherArrayPtr = std::shared_ptr<std::vector<std::any>>;
-
 struct NativeFunction : SurpherCallable
 {
     Token paren;
@@ -18,7 +15,7 @@ struct NativeFunction : SurpherCallable
     {
         throw RuntimeError(paren, "Unimplemented native function.");
     }
-    virtual std::any call(Interpreter &interpreter, const std::vector<std::any> &arguments) override
+    virtual Value call(Interpreter &interpreter, const std::vector<Value> &arguments) override
     {
         throw RuntimeError(paren, "Unimplemented native function.");
     }
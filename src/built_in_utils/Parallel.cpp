@@ -0,0 +1,133 @@
+#include <thread>
+#include <algorithm>
+
+#include "Parallel.hpp"
+
+static constexpr size_t chunk_size = 1 << 16;
+
+static size_t workerCount()
+{
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// Runs kernel(begin, end, chunk_index) over [0, size) in chunk_size pieces. Chunks are dealt to the
+// workers round-robin; each chunk's result goes to its own slot, so the caller combines them in order.
+template <typename Kernel>
+static void forEachChunk(size_t size, Kernel kernel)
+{
+    size_t chunk_count((size + chunk_size - 1) / chunk_size);
+    size_t worker_count(std::min(workerCount(), chunk_count));
+    if (worker_count <= 1)
+    {
+        for (size_t chunk = 0; chunk < chunk_count; chunk++)
+            kernel(chunk * chunk_size, std::min(size, (chunk + 1) * chunk_size), chunk);
+        return;
+    }
+
+    std::vector<std::thread> workers;
+    workers.reserve(worker_count);
+    for (size_t worker = 0; worker < worker_count; worker++)
+    {
+        workers.emplace_back([=, &kernel]()
+                             {
+            for (size_t chunk = worker; chunk < chunk_count; chunk += worker_count)
+                kernel(chunk * chunk_size, std::min(size, (chunk + 1) * chunk_size), chunk); });
+    }
+    for (auto &worker : workers)
+        worker.join();
+}
+
+static SurpherArray &numericArray(const Value &value, const Token &paren, const std::string &usage)
+{
+    if (!value.isArray())
+        throw RuntimeError(paren, usage);
+
+    auto &array(*value.asPointer<SurpherArray>());
+    if (!std::all_of(array.begin(), array.end(), [](const Value &element)
+                     { return element.isNumber(); }))
+        throw RuntimeError(paren, usage);
+
+    return array;
+}
+
+uint32_t ParallelSum::arity()
+{
+    return 1;
+}
+
+Value ParallelSum::call(Interpreter &interpreter, const std::vector<Value> &arguments)
+{
+    const auto &array(numericArray(arguments[0], paren, "Invalid usage of \"sum\". Usage: sum(<array of numbers>)."));
+
+    std::vector<double> partial_sums((array.size() + chunk_size - 1) / chunk_size);
+    forEachChunk(array.size(), [&](size_t begin, size_t end, size_t chunk)
+                 {
+        double sum = 0;
+        for (size_t i = begin; i < end; i++)
+            sum += array[i].asNumber();
+        partial_sums[chunk] = sum; });
+
+    double sum = 0;
+    for (double partial_sum : partial_sums)
+        sum += partial_sum;
+    return sum;
+}
+
+uint32_t ParallelDot::arity()
+{
+    return 2;
+}
+
+Value ParallelDot::call(Interpreter &interpreter, const std::vector<Value> &arguments)
+{
+    const std::string usage("Invalid usage of \"dot\". Usage: dot(<array of numbers>, <array of numbers of the same size>).");
+    const auto &left(numericArray(arguments[0], paren, usage));
+    const auto &right(numericArray(arguments[1], paren, usage));
+    if (left.size() != right.size())
+        throw RuntimeError(paren, usage);
+
+    std::vector<double> partial_sums((left.size() + chunk_size - 1) / chunk_size);
+    forEachChunk(left.size(), [&](size_t begin, size_t end, size_t chunk)
+                 {
+        double sum = 0;
+        for (size_t i = begin; i < end; i++)
+            sum += left[i].asNumber() * right[i].asNumber();
+        partial_sums[chunk] = sum; });
+
+    double sum = 0;
+    for (double partial_sum : partial_sums)
+        sum += partial_sum;
+    return sum;
+}
+
+uint32_t ParallelScale::arity()
+{
+    return 2;
+}
+
+Value ParallelScale::call(Interpreter &interpreter, const std::vector<Value> &arguments)
+{
+    const std::string usage("Invalid usage of \"scale\". Usage: scale(<array of numbers>, <number>).");
+    auto &elements(numericArray(arguments[0], paren, usage));
+    if (!arguments[1].isNumber())
+        throw RuntimeError(paren, usage);
+
+    // numbers are stored inline in a Value, so writing them from several threads touches no refcounts
+    double factor(arguments[1].asNumber());
+    forEachChunk(elements.size(), [&](size_t begin, size_t end, size_t)
+                 {
+        for (size_t i = begin; i < end; i++)
+            elements[i].asNumber() *= factor; });
+
+    return arguments[0];
+}
+
+uint32_t ParallelThreads::arity()
+{
+    return 0;
+}
+
+Value ParallelThreads::call(Interpreter &interpreter, const std::vector<Value> &arguments)
+{
+    return static_cast<double>(workerCount());
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "NativeFunction.hpp"
+
+// Data-parallel kernels over numeric arrays. They never run Surpher code on the worker threads, and
+// they split work into fixed-size chunks combined in order, so results don't depend on the core count.
+struct ParallelSum : NativeFunction
+{
+    uint32_t arity() override;
+    Value call(Interpreter &interpreter, const std::vector<Value> &arguments) override;
+};
+
+struct ParallelDot : NativeFunction
+{
+    uint32_t arity() override;
+    Value call(Interpreter &interpreter, const std::vector<Value> &arguments) override;
+};
+
+struct ParallelScale : NativeFunction
+{
+    uint32_t arity() override;
+    Value call(Interpreter &interpreter, const std::vector<Value> &arguments) override;
+};
+
+struct ParallelThreads : NativeFunction
+{
+    uint32_t arity() override;
+    Value call(Interpreter &interpreter, const std::vector<Value> &arguments) override;
+};
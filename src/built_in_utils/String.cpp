@@ -7,15 +7,15 @@ uint32_t Ascii::arity()
     return 1;
 }
 
-std::any Ascii::call(Interpreter &interpreter, const std::vector<std::any> &arguments)
+Value Ascii::call(Interpreter &interpreter, const std::vector<Value> &arguments)
 {
-    auto any_value = arguments[0];
-    if (any_value.type() == typeid(std::string))
+    const auto &any_value = arguments[0];
+    if (any_value.isString())
     {
-        auto value = std::any_cast<const std::string &>(any_value);
+        const auto &value = any_value.asString();
         if (value.size() == 1)
         {
-            return static_cast<long double>(value[0]);
+            return static_cast<double>(value[0]);
         }
     }
 
@@ -27,16 +27,16 @@ uint32_t ToNumber::arity()
     return 1;
 }
 
-std::any ToNumber::call(Interpreter &interpreter, const std::vector<std::any> &arguments)
+Value ToNumber::call(Interpreter &interpreter, const std::vector<Value> &arguments)
 {
-    auto any_value = arguments[0];
-    if (any_value.type() == typeid(std::string))
+    const auto &any_value = arguments[0];
+    if (any_value.isString())
     {
-        auto value = std::any_cast<const std::string &>(any_value);
-        long double ret;
+        const auto &value = any_value.asString();
+        double ret;
         try
         {
-            ret = std::stold(value);
+            ret = std::stod(value);
             return ret;
         }
         catch (const std::exception &e)
@@ -53,17 +53,17 @@ uint32_t ToString::arity()
     return 1;
 }
 
-std::any ToString::call(Interpreter &interpreter, const std::vector<std::any> &arguments)
+Value ToString::call(Interpreter &interpreter, const std::vector<Value> &arguments)
 {
-    auto value = arguments[0];
+    const auto &value = arguments[0];
 
-    if (value.type() == typeid(nullptr))
+    if (value.isNil())
     {
         return std::string("nil");
     }
-    else if (value.type() == typeid(long double &))
+    else if (value.isNumber())
     {
-        auto double_val(std::any_cast<long double &>(value));
+        auto double_val(value.asNumber());
         std::string num_str(std::to_string(double_val));
         if (std::floor(double_val) == double_val)
         {
@@ -76,22 +76,24 @@ std::any ToString::call(Interpreter &interpreter, const std::vector<std::any> &a
         }
         return num_str;
     }
-    else if (value.type() == typeid(std::string))
+    else if (value.isString())
     {
-        return std::any_cast<const std::string &>(value);
+        return value;
     }
-    else if (value.type() == typeid(bool))
+    else if (value.isBool())
     {
-        return std::any_cast<bool>(value) ? "true" : "false";
+        return value.asBool() ? "true" : "false";
     }
-    else if (value.type() == typeid(std::shared_ptr<SurpherInstance>))
+    else if (value.isInstance())
     {
-        auto value_cast{std::any_cast<std::shared_ptr<SurpherInstance>>(value)};
-        return std::any_cast<std::shared_ptr<SurpherCallable>>(value_cast->get(Token("__toString__", {}, STRING, 0)))->call(interpreter, {});
+        auto value_cast{value.as<SurpherInstance>()};
+        if (auto to_string = value_cast->surpher_class->findProtocol(Protocol::TO_STRING))
+            return to_string->invoke(interpreter, value_cast, {});
+        throw RuntimeError(paren, "Type not supported for \"tostring\".");
     }
-    else if (value.type() == typeid(SurpherArrayPtr))
+    else if (value.isArray())
     {
-        auto expr_vector{std::any_cast<SurpherArrayPtr>(value)};
+        auto expr_vector{value.as<SurpherArray>()};
         if (expr_vector->empty())
         {
             return std::string("[]");
@@ -100,7 +102,12 @@ std::any ToString::call(Interpreter &interpreter, const std::vector<std::any> &a
         std::ostringstream str_builder;
         str_builder << "[";
         for (const auto &expr : *expr_vector)
-            str_builder << std::any_cast<const std::string &>(call(interpreter, {expr})) << ", ";
+        {
+            auto element_str{call(interpreter, {expr})};
+            if (!element_str.isString())
+                throw RuntimeError(paren, "Type not supported for \"tostring\".");
+            str_builder << element_str.asString() << ", ";
+        }
         auto expr_vector_str{str_builder.str()};
 
         expr_vector_str.pop_back();
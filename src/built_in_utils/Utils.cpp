@@ -1,68 +1,78 @@
 #include "Utils.hpp"
 
 /*
-std::shared_ptr<SurpherNamespace> Concurrency()
+Ref<SurpherNamespace> Concurrency()
 {
     std::shared_ptr<Environment> new_environment = std::make_shared<Environment>();
-    new_environment->define("thread", std::shared_ptr<SurpherCallable>(new Thread()), true);
-    new_environment->define("join", std::shared_ptr<SurpherCallable>(new Join()), true);
-    new_environment->define("mutex", std::shared_ptr<SurpherCallable>(new Mutex()), true);
-    new_environment->define("lock", std::shared_ptr<SurpherCallable>(new Lock()), true);
-    new_environment->define("unlock", std::shared_ptr<SurpherCallable>(new Unlock()), true);
-    return std::make_shared<SurpherNamespace>("Concurrency", new_environment);
+    new_environment->define("thread", makeRef<Thread>(), true);
+    new_environment->define("join", makeRef<Join>(), true);
+    new_environment->define("mutex", makeRef<Mutex>(), true);
+    new_environment->define("lock", makeRef<Lock>(), true);
+    new_environment->define("unlock", makeRef<Unlock>(), true);
+    return makeRef<SurpherNamespace>("Concurrency", new_environment);
 }
 */
 
-std::shared_ptr<SurpherNamespace> Chrono()
+Ref<SurpherNamespace> Chrono()
 {
     std::shared_ptr<Environment> new_environment = std::make_shared<Environment>();
-    new_environment->define("clock", std::shared_ptr<SurpherCallable>(new Clock()), true);
-    return std::make_shared<SurpherNamespace>("Chrono", new_environment);
+    new_environment->define("clock", makeRef<Clock>(), true);
+    return makeRef<SurpherNamespace>("Chrono", new_environment);
 }
 
-std::shared_ptr<SurpherNamespace> IO()
+Ref<SurpherNamespace> IO()
 {
     std::shared_ptr<Environment> new_environment = std::make_shared<Environment>();
-    new_environment->define("fileOpen", std::shared_ptr<SurpherCallable>(new FileOpen()), true);
-    new_environment->define("fileWrite", std::shared_ptr<SurpherCallable>(new Write()), true);
-    new_environment->define("fileReadAll", std::shared_ptr<SurpherCallable>(new ReadAll()), true);
-    new_environment->define("fileReadSome", std::shared_ptr<SurpherCallable>(new ReadSome()), true);
-    new_environment->define("fileClose", std::shared_ptr<SurpherCallable>(new FileClose()), true);
-    new_environment->define("input", std::shared_ptr<SurpherCallable>(new Input()), true);
-    return std::make_shared<SurpherNamespace>("IO", new_environment);
+    new_environment->define("fileOpen", makeRef<FileOpen>(), true);
+    new_environment->define("fileWrite", makeRef<Write>(), true);
+    new_environment->define("fileReadAll", makeRef<ReadAll>(), true);
+    new_environment->define("fileReadSome", makeRef<ReadSome>(), true);
+    new_environment->define("fileClose", makeRef<FileClose>(), true);
+    new_environment->define("input", makeRef<Input>(), true);
+    return makeRef<SurpherNamespace>("IO", new_environment);
 }
 
-std::shared_ptr<SurpherNamespace> String()
+Ref<SurpherNamespace> String()
 {
     std::shared_ptr<Environment> new_environment = std::make_shared<Environment>();
-    new_environment->define("ascii", std::shared_ptr<SurpherCallable>(new Ascii()), true);
-    new_environment->define("toNumber", std::shared_ptr<SurpherCallable>(new ToNumber()), true);
-    new_environment->define("toString", std::shared_ptr<SurpherCallable>(new ToString()), true);
-    return std::make_shared<SurpherNamespace>("String", new_environment);
+    new_environment->define("ascii", makeRef<Ascii>(), true);
+    new_environment->define("toNumber", makeRef<ToNumber>(), true);
+    new_environment->define("toString", makeRef<ToString>(), true);
+    return makeRef<SurpherNamespace>("String", new_environment);
 }
 
-std::shared_ptr<SurpherNamespace> Math()
+Ref<SurpherNamespace> Math()
 {
     std::shared_ptr<Environment> new_environment = std::make_shared<Environment>();
-    new_environment->define("complexNum", std::shared_ptr<SurpherCallable>(new ComplexNumber()), true);
-    new_environment->define("complexAdd", std::shared_ptr<SurpherCallable>(new ComplexAdd()), true);
-    new_environment->define("complexSub", std::shared_ptr<SurpherCallable>(new ComplexSub()), true);
-    new_environment->define("complexMul", std::shared_ptr<SurpherCallable>(new ComplexMul()), true);
-    new_environment->define("complexDiv", std::shared_ptr<SurpherCallable>(new ComplexDiv()), true);
-    new_environment->define("floor", std::shared_ptr<SurpherCallable>(new Floor()), true);
-    new_environment->define("ceil", std::shared_ptr<SurpherCallable>(new Ceil()), true);
-    new_environment->define("abs", std::shared_ptr<SurpherCallable>(new AbsoluteValue()), true);
-    new_environment->define("inf", std::shared_ptr<SurpherCallable>(new Infinity()), true);
-    new_environment->define("pow", std::shared_ptr<SurpherCallable>(new Power()), true);
-    new_environment->define("sin", std::shared_ptr<SurpherCallable>(new Sin()), true);
-    new_environment->define("cos", std::shared_ptr<SurpherCallable>(new Cos()), true);
-    new_environment->define("tan", std::shared_ptr<SurpherCallable>(new Tan()), true);
-    return std::make_shared<SurpherNamespace>("Math", new_environment);
+    new_environment->define("complexNum", makeRef<ComplexNumber>(), true);
+    new_environment->define("complexAdd", makeRef<ComplexAdd>(), true);
+    new_environment->define("complexSub", makeRef<ComplexSub>(), true);
+    new_environment->define("complexMul", makeRef<ComplexMul>(), true);
+    new_environment->define("complexDiv", makeRef<ComplexDiv>(), true);
+    new_environment->define("floor", makeRef<Floor>(), true);
+    new_environment->define("ceil", makeRef<Ceil>(), true);
+    new_environment->define("abs", makeRef<AbsoluteValue>(), true);
+    new_environment->define("inf", makeRef<Infinity>(), true);
+    new_environment->define("pow", makeRef<Power>(), true);
+    new_environment->define("sin", makeRef<Sin>(), true);
+    new_environment->define("cos", makeRef<Cos>(), true);
+    new_environment->define("tan", makeRef<Tan>(), true);
+    return makeRef<SurpherNamespace>("Math", new_environment);
+}
+
+Ref<SurpherNamespace> Parallel()
+{
+    std::shared_ptr<Environment> new_environment = std::make_shared<Environment>();
+    new_environment->define("sum", makeRef<ParallelSum>(), true);
+    new_environment->define("dot", makeRef<ParallelDot>(), true);
+    new_environment->define("scale", makeRef<ParallelScale>(), true);
+    new_environment->define("threads", makeRef<ParallelThreads>(), true);
+    return makeRef<SurpherNamespace>("Parallel", new_environment);
 }
 
 void glodbalFunctionSetup(Environment &environment)
 {
-    environment.define("sizeOf", std::shared_ptr<SurpherCallable>(new Sizeof()), true);
-    environment.define("systemCall", std::shared_ptr<SurpherCallable>(new SysCmd()), true);
-    environment.define("equals", std::shared_ptr<SurpherCallable>(new Equals()), true);
+    environment.define("sizeOf", makeRef<Sizeof>(), true);
+    environment.define("systemCall", makeRef<SysCmd>(), true);
+    environment.define("equals", makeRef<Equals>(), true);
 }
\ No newline at end of file
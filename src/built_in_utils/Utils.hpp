@@ -6,16 +6,19 @@
 #include "Chrono.hpp"
 #include "String.hpp"
 #include "Math.hpp"
+#include "Parallel.hpp"
 #include "../Environment.hpp"
 
-std::shared_ptr<SurpherNamespace> IO();
+Ref<SurpherNamespace> IO();
 
-std::shared_ptr<SurpherNamespace> Math();
+Ref<SurpherNamespace> Math();
 
-std::shared_ptr<SurpherNamespace> Chrono();
+Ref<SurpherNamespace> Chrono();
 
-//std::shared_ptr<SurpherNamespace> Concurrency();
+//Ref<SurpherNamespace> Concurrency();
 
-std::shared_ptr<SurpherNamespace> String();
+Ref<SurpherNamespace> String();
+
+Ref<SurpherNamespace> Parallel();
 
 void glodbalFunctionSetup(Environment& environment);
\ No newline at end of file